@@ -17,6 +17,13 @@ class IScene
     virtual ~IScene() = default;
 
     // Lifecycle
+    // Resource creation (buffers, textures, meshes). May run on a background thread:
+    // must only use Device::create* and the scene's own objects, never pipeline state
+    virtual void load()
+    {
+    }
+    // Pipeline state setup (clear color, shaders, bindings, viewport). Runs on the render thread
+    // after load(), and again every time the scene becomes current
     virtual void init()
     {
     }
@@ -0,0 +1,195 @@
+#include "MeshScene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// Constant buffer structure
+struct CBMesh
+{
+    glm::mat4 worldViewProj;
+    glm::mat4 world;
+};
+
+static swr::VSOutput meshVS( const swr::VertexInputView &input, const swr::ShaderContext &ctx )
+{
+    const CBMesh *cb = ctx.vsCB<CBMesh>( 0 );
+    glm::vec3 position = input.readFloat3( swr::Semantic::POSITION0 );
+    glm::vec3 normal = input.readFloat3( swr::Semantic::NORMAL0 );
+
+    // Простое освещение по Ламберту от фиксированного направленного источника
+    glm::vec3 n = glm::normalize( glm::vec3( cb->world * glm::vec4( normal, 0.0f ) ) );
+    const glm::vec3 lightDir = glm::normalize( glm::vec3( 0.4f, 0.8f, 0.6f ) );
+    float ndl = std::max( glm::dot( n, lightDir ), 0.0f );
+
+    swr::VSOutput out;
+    out.position = cb->worldViewProj * glm::vec4( position, 1.0f );
+    out.color = glm::vec3( 0.8f, 0.75f, 0.7f ) * ( 0.2f + 0.8f * ndl );
+    return out;
+}
+
+static glm::vec4 meshPS( const swr::PSInput &in, const swr::ShaderContext &ctx )
+{
+    return glm::vec4( in.color, 1.0f );
+}
+
+// Именованные шейдеры: захват кадра ссылается на них, swr_replay берёт их из реестра
+static const swr::ShaderRegistration meshVSRegistration( "Mesh.VS", meshVS );
+static const swr::ShaderRegistration meshPSRegistration( "Mesh.PS", meshPS );
+
+MeshScene::MeshScene( std::shared_ptr<swr::Device> dev, std::string path )
+    : IScene( std::move( dev ) ), meshPath( std::move( path ) )
+{
+}
+
+void MeshScene::load()
+{
+    auto t0 = std::chrono::steady_clock::now();
+    try
+    {
+        // .swrm отображается в память без копирования, остальное импортируется как OBJ
+        const std::string ext = meshPath.size() >= 5 ? meshPath.substr( meshPath.size() - 5 ) : std::string();
+        if( ext == ".swrm" )
+            mesh = swr::loadMesh( *device, meshPath );
+        else
+            mesh = swr::createMesh( *device, swr::importObj( meshPath ) );
+    }
+    catch( const std::exception &e )
+    {
+        std::cerr << "MeshScene: " << e.what() << std::endl;
+        mesh = swr::Mesh{};
+        return;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << "Loaded " << meshPath << ": " << mesh.vertexCount << " vertices, " << mesh.indexCount / 3
+              << " triangles in " << std::chrono::duration<double, std::milli>( t1 - t0 ).count() << " ms"
+              << std::endl;
+
+    constantBuffer = device->createBuffer( sizeof( CBMesh ), 1, swr::BufferFormat::Unknown );
+}
+
+void MeshScene::init()
+{
+    device->OM().setClearColor( glm::vec4( 0.1f, 0.1f, 0.12f, 1.0f ) );
+    // Меш не загрузился: остаётся пустой кадр
+    if( !constantBuffer )
+        return;
+
+    device->IA().setVertexBuffer( mesh.vertexBuffer );
+    device->IA().setIndexBuffer( mesh.indexBuffer );
+    device->IA().setInputLayout( mesh.inputLayout );
+    device->IA().setPrimitiveTopology( swr::PrimitiveTopology::TriangleList );
+    device->VS().setConstantBuffer( 0, constantBuffer );
+
+    device->VS().setNamedVertexShader( "Mesh.VS" );
+    device->PS().setNamedPixelShader( "Mesh.PS" );
+}
+
+void MeshScene::prepareFrame( float dt )
+{
+    if( animate && !dragging )
+        yaw += angularSpeed * dt;
+
+    device->RS().setWireframe( wireframe );
+    device->RS().setCullBackface( cullBackface );
+    swr::Viewport vp{
+        0,    0,   static_cast<int>( device->deviceFrameWidth() ), static_cast<int>( device->deviceFrameHeight() ),
+        0.0f, 1.0f };
+    device->RS().setViewport( vp );
+
+    if( !constantBuffer )
+        return;
+
+    // Камера облетает центр ограничивающего объёма на расстоянии, вмещающем весь меш
+    glm::vec3 center = ( mesh.boundsMin + mesh.boundsMax ) * 0.5f;
+    float radius = std::max( glm::length( mesh.boundsMax - mesh.boundsMin ) * 0.5f, 1e-3f );
+    const int width = static_cast<int>( device->deviceFrameWidth() );
+    const int height = static_cast<int>( std::max<size_t>( 1, device->deviceFrameHeight() ) );
+    // В стерео каждый глаз получает половину кадра
+    const int viewWidth = stereo ? std::max( width / 2, 1 ) : width;
+    float aspect = static_cast<float>( viewWidth ) / static_cast<float>( height );
+    glm::vec3 eyeDir( std::cos( pitch ) * std::sin( yaw ), std::sin( pitch ), std::cos( pitch ) * std::cos( yaw ) );
+    glm::vec3 eye = center + eyeDir * radius * 2.5f;
+    glm::mat4 view = glm::lookAt( eye, center, glm::vec3( 0.0f, 1.0f, 0.0f ) );
+    glm::mat4 proj = glm::perspective( glm::radians( 45.0f ), aspect, radius * 0.5f, radius * 5.0f );
+
+    CBMesh cb;
+    cb.world = glm::mat4( 1.0f );
+    cb.worldViewProj = proj * view * cb.world;
+    if( stereo )
+    {
+        // VS выдаёт мировую позицию, вид и проекцию глаза применяет устройство.
+        // Глаза смещены вдоль правого вектора камеры и смотрят параллельно
+        cb.worldViewProj = cb.world;
+        const glm::vec3 right = glm::normalize( glm::cross( center - eye, glm::vec3( 0.0f, 1.0f, 0.0f ) ) );
+        const glm::vec3 offset = right * radius * 0.06f;
+        stereoViews.resize( 2 );
+        for( int e = 0; e < 2; ++e )
+        {
+            const glm::vec3 shift = e == 0 ? -offset : offset;
+            stereoViews[e].viewProj =
+                proj * glm::lookAt( eye + shift, center + shift, glm::vec3( 0.0f, 1.0f, 0.0f ) );
+            stereoViews[e].viewport = { e * viewWidth, 0, e == 0 ? viewWidth : width - viewWidth, height, 0.0f, 1.0f };
+        }
+    }
+    constantBuffer->uploadData( &cb, 1 );
+}
+
+void MeshScene::renderFrame()
+{
+    if( !mesh.indexBuffer || !mesh.indexCount )
+        return;
+    // Оба глаза за один draw: VS выполняется один раз на вершину
+    if( stereo )
+        device->setViews( stereoViews );
+    device->drawIndexed( mesh.indexCount, 0, 0 );
+    if( stereo )
+        device->setViews( {} );
+}
+
+void MeshScene::handleKeyEvent( SDL_KeyboardEvent &ke )
+{
+    if( ke.key == SDLK_W )
+    {
+        wireframe = !wireframe;
+        std::cout << "Wireframe: " << ( wireframe ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_C )
+    {
+        cullBackface = !cullBackface;
+        std::cout << "Cull backface: " << ( cullBackface ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_A )
+    {
+        animate = !animate;
+        std::cout << "Animation: " << ( animate ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_V )
+    {
+        stereo = !stereo;
+        std::cout << "Stereo: " << ( stereo ? "ON" : "OFF" ) << std::endl;
+    }
+}
+
+void MeshScene::handleMouseBtnEvent( SDL_MouseButtonEvent &mbe )
+{
+    if( mbe.button == SDL_BUTTON_LEFT )
+        dragging = mbe.down;
+}
+
+void MeshScene::handleMouseMoveEvent( SDL_MouseMotionEvent &mme )
+{
+    if( !dragging )
+        return;
+    yaw += mme.xrel * 0.01f;
+    pitch = glm::clamp( pitch + mme.yrel * 0.01f, -1.5f, 1.5f );
+}
+
+void MeshScene::onResize( int width, int height )
+{
+    swr::Viewport vp{ 0, 0, width, height, 0.0f, 1.0f };
+    device->RS().setViewport( vp );
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "IScene.h"
+#include "swrMesh.h"
+
+// Сцена просмотра меша из файла (.swrm через mmap или .obj с импортом на лету)
+class MeshScene : public IScene
+{
+  public:
+    MeshScene( std::shared_ptr<swr::Device> dev, std::string path );
+    ~MeshScene() override = default;
+
+    void load() override;
+    void init() override;
+    void prepareFrame( float dt ) override;
+    void renderFrame() override;
+
+    void handleKeyEvent( SDL_KeyboardEvent &ke ) override;
+    void handleMouseBtnEvent( SDL_MouseButtonEvent &mbe ) override;
+    void handleMouseMoveEvent( SDL_MouseMotionEvent &mme ) override;
+    void onResize( int width, int height ) override;
+
+  private:
+    std::string meshPath;
+    swr::Mesh mesh;
+    std::shared_ptr<swr::Buffer> constantBuffer;
+
+    bool wireframe = false;
+    bool cullBackface = false;
+    bool animate = true;
+    bool stereo = false; // Стереопара за один draw (Device::setViews)
+    std::vector<swr::ViewDesc> stereoViews; // Левый и правый глаз, задаются в prepareFrame
+    bool dragging = false;
+    float yaw = 0.0f;   // radians
+    float pitch = 0.3f; // radians
+    float angularSpeed = 0.5f; // radians per second
+};
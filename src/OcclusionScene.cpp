@@ -0,0 +1,187 @@
+#include "OcclusionScene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+    // Constant buffer structure
+    struct CBObject
+    {
+        glm::mat4 worldViewProj;
+        glm::mat4 world;
+        glm::vec4 color;
+    };
+
+    constexpr int kGridX = 6;
+    constexpr int kGridY = 3;
+    constexpr float kSphereRadius = 0.7f;
+
+    swr::VSOutput objectVS( const swr::VertexInputView &input, const swr::ShaderContext &ctx )
+    {
+        const CBObject *cb = ctx.vsCB<CBObject>( 0 );
+        glm::vec3 position = input.readFloat3( swr::Semantic::POSITION0 );
+        glm::vec3 normal = input.readFloat3( swr::Semantic::NORMAL0 );
+
+        glm::vec3 n = glm::normalize( glm::vec3( cb->world * glm::vec4( normal, 0.0f ) ) );
+        const glm::vec3 lightDir = glm::normalize( glm::vec3( 0.4f, 0.8f, 0.6f ) );
+        float ndl = std::max( glm::dot( n, lightDir ), 0.0f );
+
+        swr::VSOutput out;
+        out.position = cb->worldViewProj * glm::vec4( position, 1.0f );
+        out.color = glm::vec3( cb->color ) * ( 0.2f + 0.8f * ndl );
+        return out;
+    }
+
+    glm::vec4 objectPS( const swr::PSInput &in, const swr::ShaderContext &ctx )
+    {
+        return glm::vec4( in.color, 1.0f );
+    }
+
+    // Именованные шейдеры: захват кадра ссылается на них, swr_replay берёт их из реестра
+    const swr::ShaderRegistration objectVSRegistration( "Occlusion.VS", objectVS );
+    const swr::ShaderRegistration objectPSRegistration( "Occlusion.PS", objectPS );
+} // unnamed namespace
+
+OcclusionScene::OcclusionScene( std::shared_ptr<swr::Device> dev ) : IScene( std::move( dev ) )
+{
+}
+
+void OcclusionScene::load()
+{
+    // ~3000 треугольников на сферу — заметно дороже, чем 12 треугольников прокси.
+    // Цепочка LOD: дальние сферы рисуются упрощёнными
+    sphereMesh = swr::createLodMesh( *device, swr::createSphereMeshData( kSphereRadius, 48, 32 ) );
+    boxMesh = swr::createMesh( *device, swr::createBoxMeshData( glm::vec3( -1.0f ), glm::vec3( 1.0f ) ) );
+
+    objects.clear();
+    for( int y = 0; y < kGridY; ++y )
+    {
+        for( int x = 0; x < kGridX; ++x )
+        {
+            Object obj;
+            obj.position = glm::vec3( ( static_cast<float>( x ) - ( kGridX - 1 ) * 0.5f ) * 1.8f,
+                                      0.8f + static_cast<float>( y ) * 1.6f, -6.0f );
+            obj.color = glm::vec3( 0.4f + 0.6f * static_cast<float>( x ) / kGridX, 0.5f,
+                                   0.4f + 0.6f * static_cast<float>( y ) / kGridY );
+            obj.query = device->createOcclusionQuery();
+            objects.push_back( obj );
+        }
+    }
+}
+
+void OcclusionScene::init()
+{
+    device->OM().setClearColor( glm::vec4( 0.08f, 0.09f, 0.1f, 1.0f ) );
+
+    device->IA().setPrimitiveTopology( swr::PrimitiveTopology::TriangleList );
+    device->RS().setWireframe( false );
+    device->RS().setCullBackface( false );
+
+    device->VS().setNamedVertexShader( "Occlusion.VS" );
+    device->PS().setNamedPixelShader( "Occlusion.PS" );
+}
+
+void OcclusionScene::prepareFrame( float dt )
+{
+    if( animate )
+        time += dt;
+    wallOffset = std::sin( time * 0.6f ) * 5.0f;
+
+    const int fw = static_cast<int>( device->deviceFrameWidth() );
+    const int fh = static_cast<int>( device->deviceFrameHeight() );
+    device->RS().setViewport( { 0, 0, fw, fh, 0.0f, 1.0f } );
+
+    const float aspect = static_cast<float>( fw ) / static_cast<float>( std::max( fh, 1 ) );
+    glm::mat4 proj = glm::perspective( glm::radians( 55.0f ), aspect, 0.5f, 50.0f );
+    const glm::vec3 eye( 0.0f, 2.0f, 6.0f );
+    glm::mat4 view = glm::lookAt( eye, glm::vec3( 0.0f, 1.6f, -4.0f ), glm::vec3( 0.0f, 1.0f, 0.0f ) );
+    viewProj = proj * view;
+    // Ошибка LOD — не больше пикселя на экране; при выключенных LOD всегда уровень 0
+    lodView = swr::makeLodView( eye, proj, static_cast<float>( fh ), lodEnabled ? 1.0f : 0.0f );
+}
+
+void OcclusionScene::setObjectConstants( const glm::mat4 &world, const glm::vec3 &color )
+{
+    const CBObject cb{ viewProj * world, world, glm::vec4( color, 1.0f ) };
+    device->VS().setConstants( 0, device->pushConstants( cb ) );
+}
+
+void OcclusionScene::drawMesh( const swr::Mesh &mesh, const glm::mat4 &world, const glm::vec3 &color )
+{
+    setObjectConstants( world, color );
+    device->IA().setVertexBuffer( mesh.vertexBuffer );
+    device->IA().setIndexBuffer( mesh.indexBuffer );
+    device->IA().setInputLayout( mesh.inputLayout );
+    device->drawIndexed( mesh.indexCount, 0, 0 );
+}
+
+void OcclusionScene::renderFrame()
+{
+    // Окклюдер рисуется первым: стена перед сферами
+    glm::mat4 wall = glm::translate( glm::mat4( 1.0f ), glm::vec3( wallOffset, 2.4f, -2.0f ) ) *
+                     glm::scale( glm::mat4( 1.0f ), glm::vec3( 3.5f, 2.6f, 0.2f ) );
+    drawMesh( boxMesh, wall, glm::vec3( 0.6f, 0.6f, 0.65f ) );
+
+    if( occlusionCulling )
+    {
+        // Прокси: ограничивающий куб сферы, без записи цвета (PS не вызывается) и глубины
+        swr::BlendState noColor;
+        noColor.writeMask = 0;
+        swr::DepthState noDepthWrite;
+        noDepthWrite.depthWrite = false;
+        device->OM().setBlendState( noColor );
+        device->OM().setDepthState( noDepthWrite );
+        for( const Object &obj : objects )
+        {
+            glm::mat4 proxy = glm::translate( glm::mat4( 1.0f ), obj.position ) *
+                              glm::scale( glm::mat4( 1.0f ), glm::vec3( kSphereRadius ) );
+            device->beginQuery( obj.query );
+            drawMesh( boxMesh, proxy, obj.color );
+            device->endQuery( obj.query );
+        }
+        device->OM().setBlendState( swr::BlendState{} );
+        device->OM().setDepthState( swr::DepthState{} );
+    }
+
+    lodTriangles = 0;
+    for( const Object &obj : objects )
+    {
+        if( occlusionCulling )
+            device->setPredication( obj.query );
+        const glm::mat4 world = glm::translate( glm::mat4( 1.0f ), obj.position );
+        setObjectConstants( world, obj.color );
+        const size_t level = swr::drawLodMesh( *device, sphereMesh, world, lodView );
+        lodTriangles += sphereMesh.levels[level].indexCount / 3;
+    }
+    device->setPredication( nullptr );
+}
+
+void OcclusionScene::handleKeyEvent( SDL_KeyboardEvent &ke )
+{
+    if( ke.key == SDLK_Q )
+    {
+        occlusionCulling = !occlusionCulling;
+        std::cout << "Occlusion culling: " << ( occlusionCulling ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_O )
+    {
+        lodEnabled = !lodEnabled;
+        std::cout << "Sphere LOD: " << ( lodEnabled ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_A )
+    {
+        animate = !animate;
+        std::cout << "Animation: " << ( animate ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_P )
+    {
+        const swr::PipelineStatistics &st = device->pipelineStatistics();
+        std::cout << "Spheres skipped: " << st.predicatedDraws << "/" << objects.size()
+                  << ", primitives: " << st.primitives << ", PS invocations: " << st.psInvocations
+                  << ", sphere LOD triangles: " << lodTriangles << std::endl;
+    }
+}
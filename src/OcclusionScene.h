@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "IScene.h"
+#include "swrMesh.h"
+#include "swrMeshLod.h"
+
+// Сцена для запросов окклюзии: за движущейся стеной стоят тяжёлые сферы. Для каждой сферы рисуется
+// прокси-куб без записи цвета и глубины внутри запроса, а сама сфера — с предикатом по его результату
+class OcclusionScene : public IScene
+{
+  public:
+    explicit OcclusionScene( std::shared_ptr<swr::Device> dev );
+    ~OcclusionScene() override = default;
+
+    void load() override;
+    void init() override;
+    void prepareFrame( float dt ) override;
+    void renderFrame() override;
+
+    void handleKeyEvent( SDL_KeyboardEvent &ke ) override;
+
+  private:
+    void setObjectConstants( const glm::mat4 &world, const glm::vec3 &color );
+    void drawMesh( const swr::Mesh &mesh, const glm::mat4 &world, const glm::vec3 &color );
+
+    struct Object
+    {
+        glm::vec3 position;
+        glm::vec3 color;
+        std::shared_ptr<swr::OcclusionQuery> query;
+    };
+
+    swr::LodMesh sphereMesh;
+    swr::Mesh boxMesh;
+    std::vector<Object> objects;
+    glm::mat4 viewProj{ 1.0f };
+    swr::LodView lodView;
+    float wallOffset = 0.0f;
+    float time = 0.0f;
+
+    bool occlusionCulling = true;
+    bool animate = true;
+    bool lodEnabled = true;
+    size_t lodTriangles = 0; // Треугольники сфер в выбранных LOD за последний кадр (включая пропущенные по предикату)
+};
@@ -1,6 +1,19 @@
 #include "SceneManager.h"
 #include "IScene.h"
 
+#include <chrono>
+#include <iostream>
+
+SceneManager::~SceneManager()
+{
+    // std::future from std::async blocks in its destructor; finish loads before the scenes are released
+    for( Slot &slot : slots )
+    {
+        if( slot.loading.valid() )
+            slot.loading.wait();
+    }
+}
+
 void SceneManager::registerScene( const std::string &name, Factory f )
 {
     auto it = registry.find( name );
@@ -8,56 +21,179 @@ void SceneManager::registerScene( const std::string &name, Factory f )
     if( it == registry.end() )
     {
         order.push_back( name );
+        slots.emplace_back();
         if( currentIndex == -1 )
             currentIndex = 0;
     }
 }
 
+int SceneManager::indexOf( const std::string &name ) const
+{
+    for( size_t i = 0; i < order.size(); ++i )
+    {
+        if( order[i] == name )
+            return static_cast<int>( i );
+    }
+    return -1;
+}
+
 bool SceneManager::setCurrentScene( const std::string &name, std::shared_ptr<swr::Device> dev )
 {
-    auto it = registry.find( name );
-    if( it == registry.end() )
+    const int index = indexOf( name );
+    if( index == -1 )
     {
         return false;
     }
-    // update index
-    for( size_t i = 0; i < order.size(); ++i )
+    device = std::move( dev );
+    Slot &slot = slots[index];
+    if( slot.loading.valid() )
+        collect( index, true );
+    if( !slot.scene )
     {
-        if( order[i] == name )
-        {
-            currentIndex = static_cast<int>( i );
-            break;
-        }
+        slot.scene = registry[name]( device );
+        if( !slot.scene )
+            return false;
+        slot.scene->load();
     }
-    current = it->second( std::move( dev ) );
-    return current != nullptr;
+    currentIndex = index;
+    pendingIndex = -1;
+    trimCache();
+    return true;
 }
 
 IScene *SceneManager::getCurrent() const
 {
-    return current.get();
+    if( currentIndex < 0 || currentIndex >= static_cast<int>( slots.size() ) )
+        return nullptr;
+    return slots[currentIndex].scene.get();
 }
 
 bool SceneManager::switchNext( std::shared_ptr<swr::Device> dev )
 {
     if( order.empty() )
         return false;
-    int next = currentIndex;
+    device = std::move( dev );
+    int next = pendingIndex != -1 ? pendingIndex : currentIndex;
     if( next == -1 )
         next = 0;
     else
         next = ( next + 1 ) % static_cast<int>( order.size() );
-    return setCurrentScene( order[next], std::move( dev ) );
+    return requestScene( next );
 }
 
 bool SceneManager::switchPrev( std::shared_ptr<swr::Device> dev )
 {
     if( order.empty() )
         return false;
-    int prev = currentIndex;
+    device = std::move( dev );
+    int prev = pendingIndex != -1 ? pendingIndex : currentIndex;
     if( prev == -1 )
         prev = 0;
     else
         prev = ( prev - 1 + static_cast<int>( order.size() ) ) % static_cast<int>( order.size() );
-    return setCurrentScene( order[prev], std::move( dev ) );
+    return requestScene( prev );
+}
+
+bool SceneManager::requestScene( int index )
+{
+    if( index == currentIndex && getCurrent() )
+    {
+        // Back to the scene on screen: cancel the pending switch
+        pendingIndex = -1;
+        trimCache();
+        return false;
+    }
+    pendingIndex = index;
+    Slot &slot = slots[index];
+    slot.failed = false;
+    if( slot.scene )
+        return true; // Already prewarmed: switches on the next update()
+    if( !slot.loading.valid() )
+        startLoad( index );
+    std::cout << "Loading scene " << order[index] << "..." << std::endl;
+    return true;
+}
+
+void SceneManager::startLoad( int index )
+{
+    Factory factory = registry[order[index]];
+    std::shared_ptr<swr::Device> dev = device;
+    slots[index].loading = std::async( std::launch::async, [factory, dev]() {
+        std::unique_ptr<IScene> scene = factory( dev );
+        if( scene )
+            scene->load();
+        return scene;
+    } );
+}
+
+void SceneManager::collect( int index, bool wait )
+{
+    Slot &slot = slots[index];
+    if( !wait && slot.loading.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+        return;
+    try
+    {
+        slot.scene = slot.loading.get();
+    }
+    catch( const std::exception &e )
+    {
+        std::cerr << "Failed to load " << order[index] << " scene: " << e.what() << std::endl;
+    }
+    slot.failed = !slot.scene;
+    if( slot.failed && index == pendingIndex )
+        pendingIndex = -1;
+}
+
+bool SceneManager::update()
+{
+    for( size_t i = 0; i < slots.size(); ++i )
+    {
+        if( slots[i].loading.valid() )
+            collect( static_cast<int>( i ), false );
+    }
+
+    bool switched = false;
+    if( pendingIndex != -1 && slots[pendingIndex].scene )
+    {
+        currentIndex = pendingIndex;
+        pendingIndex = -1;
+        switched = true;
+    }
+    trimCache();
+    return switched;
+}
+
+void SceneManager::setPrewarm( bool enabled, std::shared_ptr<swr::Device> dev )
+{
+    prewarm = enabled;
+    device = std::move( dev );
+    trimCache();
+}
+
+bool SceneManager::isWanted( int index ) const
+{
+    if( index == currentIndex || index == pendingIndex )
+        return true;
+    if( !prewarm || currentIndex == -1 )
+        return false;
+    const int count = static_cast<int>( order.size() );
+    return index == ( currentIndex + 1 ) % count || index == ( currentIndex - 1 + count ) % count;
+}
+
+void SceneManager::trimCache()
+{
+    for( size_t i = 0; i < slots.size(); ++i )
+    {
+        const int index = static_cast<int>( i );
+        Slot &slot = slots[i];
+        if( !isWanted( index ) )
+        {
+            // Loads in flight are not cancelled: the result is dropped once collected
+            slot.scene.reset();
+        }
+        else if( !slot.scene && !slot.loading.valid() && !slot.failed && device && index != currentIndex )
+        {
+            startLoad( index );
+        }
+    }
 }
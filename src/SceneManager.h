@@ -1,29 +1,73 @@
 #pragma once
 
 #include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "swrDevice.h"
 class IScene;
 
+// Scenes are created and loaded (factory + IScene::load) on a background thread, so switching does not
+// stall the render loop: the current scene keeps rendering until the requested one is ready.
+// All methods must be called from the render thread
 class SceneManager
 {
   public:
     using Factory = std::function<std::unique_ptr<IScene>( std::shared_ptr<swr::Device> )>;
 
+    SceneManager() = default;
+    SceneManager( const SceneManager & ) = delete;
+    SceneManager &operator=( const SceneManager & ) = delete;
+    // Waits for background loads still in flight
+    ~SceneManager();
+
     void registerScene( const std::string &name, Factory f );
+    // Synchronous: creates and loads the scene on the calling thread (e.g. at startup).
+    // The caller then calls init() on the new current scene
     bool setCurrentScene( const std::string &name, std::shared_ptr<swr::Device> dev );
     IScene *getCurrent() const;
 
-    // Switch to next/previous scene in registration order
+    // Request next/previous scene in registration order (relative to a pending request, if any).
+    // Loading is asynchronous; the switch happens in a later update()
     bool switchNext( std::shared_ptr<swr::Device> dev );
     bool switchPrev( std::shared_ptr<swr::Device> dev );
 
+    // Call once per frame. Collects finished loads and makes the requested scene current once it is ready.
+    // Returns true if the current scene changed: the caller must call init() and onResize() on it
+    bool update();
+    bool isLoading() const
+    {
+        return pendingIndex != -1;
+    }
+
+    // Keep the next/previous scenes (registration order) loaded in the background, so switching to them is instant
+    void setPrewarm( bool enabled, std::shared_ptr<swr::Device> dev );
+
   private:
+    struct Slot
+    {
+        std::unique_ptr<IScene> scene;                 // Loaded, ready to become current
+        std::future<std::unique_ptr<IScene>> loading; // Background load in flight
+        bool failed = false;                           // Last load failed: no automatic (prewarm) retries
+    };
+
+    int indexOf( const std::string &name ) const;
+    bool requestScene( int index );
+    void startLoad( int index );
+    // Moves a finished load into its slot (wait = block until it finishes)
+    void collect( int index, bool wait );
+    bool isWanted( int index ) const;
+    // Releases scenes that are no longer current, pending or prewarmed; starts prewarm loads
+    void trimCache();
+
     std::unordered_map<std::string, Factory> registry;
     std::vector<std::string> order;
-    std::unique_ptr<IScene> current;
+    std::vector<Slot> slots; // Parallel to order
+    std::shared_ptr<swr::Device> device;
     int currentIndex = -1;
+    int pendingIndex = -1;
+    bool prewarm = false;
 };
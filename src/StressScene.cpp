@@ -0,0 +1,261 @@
+#include "StressScene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+    // Constant buffer structure
+    struct CBObject
+    {
+        glm::mat4 worldViewProj;
+        glm::vec4 color;
+    };
+
+    constexpr float kFieldSize = 200.0f;   // Сторона квадрата, по которому разбросаны объекты
+    constexpr float kMovingFraction = 0.1f; // Доля движущихся объектов
+
+    double elapsedMs( std::chrono::steady_clock::time_point since )
+    {
+        return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - since ).count();
+    }
+
+    // Слот 0 — таблица CBObject, запись выбирается номером экземпляра (в прямом пути таблица из одной записи)
+    swr::VSOutput objectVS( const swr::VertexInputView &input, const swr::ShaderContext &ctx )
+    {
+        const CBObject *cb = ctx.vsCB<CBObject>( 0 ) + ctx.instanceId();
+        glm::vec3 position = input.readFloat3( swr::Semantic::POSITION0 );
+        glm::vec3 normal = input.readFloat3( swr::Semantic::NORMAL0 );
+
+        // Объекты только переносятся и масштабируются равномерно — нормаль в мировом пространстве та же
+        const glm::vec3 lightDir = glm::normalize( glm::vec3( 0.4f, 0.8f, 0.6f ) );
+        float ndl = std::max( glm::dot( normal, lightDir ), 0.0f );
+
+        swr::VSOutput out;
+        out.position = cb->worldViewProj * glm::vec4( position, 1.0f );
+        out.color = glm::vec3( cb->color ) * ( 0.3f + 0.7f * ndl );
+        return out;
+    }
+
+    glm::vec4 objectPS( const swr::PSInput &in, const swr::ShaderContext &ctx )
+    {
+        return glm::vec4( in.color, 1.0f );
+    }
+
+    // Именованные шейдеры: захват кадра ссылается на них, swr_replay берёт их из реестра
+    const swr::ShaderRegistration objectVSRegistration( "Stress.VS", objectVS );
+    const swr::ShaderRegistration objectPSRegistration( "Stress.PS", objectPS );
+} // unnamed namespace
+
+StressScene::StressScene( std::shared_ptr<swr::Device> dev, size_t objectCount )
+    : IScene( std::move( dev ) ), targetObjectCount( objectCount )
+{
+}
+
+void StressScene::load()
+{
+    cubeMesh = swr::createMesh( *device, swr::createBoxMeshData( glm::vec3( -0.5f ), glm::vec3( 0.5f ) ) );
+    drawArgs = device->createBuffer( sizeof( swr::DrawIndexedArguments ), targetObjectCount,
+                                     swr::BufferFormat::Unknown );
+
+    // Детерминированное случайное поле объектов
+    std::mt19937 rng( 12345 );
+    std::uniform_real_distribution<float> pos( -kFieldSize * 0.5f, kFieldSize * 0.5f );
+    std::uniform_real_distribution<float> unit( 0.0f, 1.0f );
+    objects.clear();
+    objects.reserve( targetObjectCount );
+    for( size_t i = 0; i < targetObjectCount; ++i )
+    {
+        Object obj;
+        obj.scale = 0.4f + unit( rng ) * 1.2f;
+        obj.position = glm::vec3( pos( rng ), obj.scale * 0.5f + unit( rng ) * 3.0f, pos( rng ) );
+        obj.color = glm::vec3( 0.3f + 0.7f * unit( rng ), 0.3f + 0.7f * unit( rng ), 0.3f + 0.7f * unit( rng ) );
+        obj.phase = unit( rng ) < kMovingFraction ? unit( rng ) * 6.2831853f : -1.0f;
+        objects.push_back( obj );
+    }
+
+    std::vector<swr::AABB> bounds;
+    bounds.reserve( objects.size() );
+    for( const Object &obj : objects )
+        bounds.push_back( objectBounds( obj ) );
+    auto t0 = std::chrono::steady_clock::now();
+    bvh.build( bounds );
+    std::cout << "StressScene: " << objects.size() << " objects, BVH " << bvh.nodeCount() << " nodes built in "
+              << elapsedMs( t0 ) << " ms" << std::endl;
+}
+
+void StressScene::init()
+{
+    device->OM().setClearColor( glm::vec4( 0.55f, 0.65f, 0.8f, 1.0f ) );
+
+    device->IA().setVertexBuffer( cubeMesh.vertexBuffer );
+    device->IA().setIndexBuffer( cubeMesh.indexBuffer );
+    device->IA().setInputLayout( cubeMesh.inputLayout );
+    device->IA().setPrimitiveTopology( swr::PrimitiveTopology::TriangleList );
+    device->RS().setWireframe( false );
+    device->RS().setCullBackface( false );
+
+    device->VS().setNamedVertexShader( "Stress.VS" );
+    device->PS().setNamedPixelShader( "Stress.PS" );
+}
+
+swr::AABB StressScene::objectBounds( const Object &obj ) const
+{
+    const glm::vec3 half( obj.scale * 0.5f );
+    return { obj.position - half, obj.position + half };
+}
+
+void StressScene::prepareFrame( float dt )
+{
+    if( animate )
+        time += dt;
+
+    // Движущиеся объекты подпрыгивают; дерево обновляется refit'ом, перестраивается только при деградации
+    auto t0 = std::chrono::steady_clock::now();
+    for( uint32_t i = 0; i < objects.size(); ++i )
+    {
+        Object &obj = objects[i];
+        if( obj.phase < 0.0f )
+            continue;
+        obj.position.y = obj.scale * 0.5f + 1.5f + 1.5f * std::sin( time * 2.0f + obj.phase );
+        bvh.update( i, objectBounds( obj ) );
+    }
+    bvh.refit();
+    if( bvh.needsRebuild() )
+    {
+        std::vector<swr::AABB> bounds;
+        bounds.reserve( objects.size() );
+        for( const Object &obj : objects )
+            bounds.push_back( objectBounds( obj ) );
+        bvh.build( bounds );
+    }
+    updateMs = elapsedMs( t0 );
+
+    const int fw = static_cast<int>( device->deviceFrameWidth() );
+    const int fh = static_cast<int>( device->deviceFrameHeight() );
+    device->RS().setViewport( { 0, 0, fw, fh, 0.0f, 1.0f } );
+
+    // Камера облетает поле по кругу и смотрит по касательной
+    const float aspect = static_cast<float>( fw ) / static_cast<float>( std::max( fh, 1 ) );
+    const float angle = time * 0.05f;
+    const float radius = kFieldSize * 0.3f;
+    glm::vec3 eye( std::cos( angle ) * radius, 8.0f, std::sin( angle ) * radius );
+    glm::vec3 forward( -std::sin( angle ), -0.15f, std::cos( angle ) );
+    glm::mat4 view = glm::lookAt( eye, eye + forward, glm::vec3( 0.0f, 1.0f, 0.0f ) );
+    glm::mat4 proj = glm::perspective( glm::radians( 60.0f ), aspect, 0.5f, 120.0f );
+    viewProj = proj * view;
+}
+
+void StressScene::renderFrame()
+{
+    auto t0 = std::chrono::steady_clock::now();
+    visible.clear();
+    cullStats = swr::BVHQueryStats{};
+    if( frustumCulling )
+    {
+        bvh.cull( swr::Frustum::fromMatrix( viewProj ), visible, &cullStats );
+    }
+    else
+    {
+        for( uint32_t i = 0; i < objects.size(); ++i )
+            visible.push_back( i );
+    }
+    cullMs = elapsedMs( t0 );
+
+    t0 = std::chrono::steady_clock::now();
+    auto makeConstants = [&]( uint32_t id ) {
+        const Object &obj = objects[id];
+        glm::mat4 world = glm::translate( glm::mat4( 1.0f ), obj.position ) *
+                          glm::scale( glm::mat4( 1.0f ), glm::vec3( obj.scale ) );
+        return CBObject{ viewProj * world, glm::vec4( obj.color, 1.0f ) };
+    };
+    if( indirectDraws )
+    {
+        // Результат отсечения записывается как таблица констант и записи аргументов; номер экземпляра
+        // записи выбирает строку таблицы. Устройство исполняет все записи одним вызовом
+        swr::ConstantAllocation table = device->allocateConstants( visible.size() * sizeof( CBObject ) );
+        CBObject *rows = static_cast<CBObject *>( table.data );
+        auto *args = static_cast<swr::DrawIndexedArguments *>( drawArgs->map( 0, visible.size() ) );
+        for( uint32_t i = 0; i < visible.size(); ++i )
+        {
+            rows[i] = makeConstants( visible[i] );
+            args[i] = { static_cast<uint32_t>( cubeMesh.indexCount ), 1, 0, 0, i };
+        }
+        drawArgs->unmap();
+        device->VS().setConstants( 0, table.binding );
+    }
+    else
+    {
+        // Константы каждого draw — в своём участке кольца устройства (без копий при отложенном затенении)
+        objectConstants.clear();
+        for( uint32_t id : visible )
+            objectConstants.push_back( device->pushConstants( makeConstants( id ) ) );
+    }
+    auto drawVisible = [&]() {
+        if( indirectDraws )
+        {
+            device->multiDrawIndexedIndirect( drawArgs, 0, visible.size() );
+            return;
+        }
+        for( const swr::ConstantBinding &binding : objectConstants )
+        {
+            device->VS().setConstants( 0, binding );
+            device->drawIndexed( cubeMesh.indexCount, 0, 0 );
+        }
+    };
+    if( zPrepass )
+    {
+        // Проход глубины без PS, затем затенение только пикселей, глубина которых совпала с ближайшей.
+        // Глубина обоих проходов считается одинаково, поэтому равенство точное
+        device->PS().setPixelShader( nullptr );
+        drawVisible();
+        swr::DepthState equal;
+        equal.func = swr::DepthFunc::Equal;
+        equal.depthWrite = false;
+        device->OM().setDepthState( equal );
+        device->PS().setNamedPixelShader( "Stress.PS" );
+        drawVisible();
+        device->OM().setDepthState( swr::DepthState{} );
+    }
+    else
+    {
+        drawVisible();
+    }
+    drawMs = elapsedMs( t0 );
+    drawnObjects = visible.size();
+}
+
+void StressScene::handleKeyEvent( SDL_KeyboardEvent &ke )
+{
+    if( ke.key == SDLK_F )
+    {
+        frustumCulling = !frustumCulling;
+        std::cout << "Frustum culling: " << ( frustumCulling ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_I )
+    {
+        indirectDraws = !indirectDraws;
+        std::cout << "Indirect multi-draw: " << ( indirectDraws ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_Z )
+    {
+        zPrepass = !zPrepass;
+        std::cout << "Z-prepass: " << ( zPrepass ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_A )
+    {
+        animate = !animate;
+        std::cout << "Animation: " << ( animate ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_P )
+    {
+        std::cout << "Drawn " << drawnObjects << "/" << objects.size() << " objects; update+refit " << updateMs
+                  << " ms, cull " << cullMs << " ms (" << cullStats.nodesVisited << " nodes), draw " << drawMs
+                  << " ms" << std::endl;
+    }
+}
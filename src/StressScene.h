@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "IScene.h"
+#include "swrBVH.h"
+#include "swrMesh.h"
+
+// Нагрузочная сцена: десятки тысяч кубов, часть из них движется. Перед отрисовкой объекты отсекаются
+// пирамидой видимости через BVH (движущиеся обновляются refit'ом, без перестройки дерева)
+class StressScene : public IScene
+{
+  public:
+    explicit StressScene( std::shared_ptr<swr::Device> dev, size_t objectCount = 20000 );
+    ~StressScene() override = default;
+
+    void load() override;
+    void init() override;
+    void prepareFrame( float dt ) override;
+    void renderFrame() override;
+
+    void handleKeyEvent( SDL_KeyboardEvent &ke ) override;
+
+  private:
+    struct Object
+    {
+        glm::vec3 position;
+        glm::vec3 color;
+        float scale;
+        float phase;  // Фаза движения; < 0 — объект неподвижен
+    };
+
+    swr::AABB objectBounds( const Object &obj ) const;
+
+    size_t targetObjectCount;
+    swr::Mesh cubeMesh;
+    std::shared_ptr<swr::Buffer> drawArgs; // Записи multiDrawIndexedIndirect, по одной на видимый объект
+    std::vector<Object> objects;
+    swr::BVH bvh;
+    std::vector<uint32_t> visible;
+    std::vector<swr::ConstantBinding> objectConstants; // Константы видимых объектов (draw на объект)
+    glm::mat4 viewProj{ 1.0f };
+    float time = 0.0f;
+
+    bool frustumCulling = true;
+    bool animate = true;
+    bool indirectDraws = true; // Видимые объекты одним multiDrawIndexedIndirect вместо draw на объект
+    bool zPrepass = false;     // Сначала только глубина, затем PS лишь для видимых пикселей (DepthFunc::Equal)
+
+    // Статистика последнего кадра
+    double updateMs = 0.0;
+    double cullMs = 0.0;
+    double drawMs = 0.0;
+    size_t drawnObjects = 0;
+    swr::BVHQueryStats cullStats;
+};
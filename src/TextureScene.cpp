@@ -0,0 +1,372 @@
+#include "TextureScene.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "swrBlockCompression.h"
+
+namespace
+{
+    // Local vertex structure for this scene
+    struct VertexPCT
+    {
+        glm::vec3 position;
+        glm::vec3 color;
+        glm::vec2 texcoord;
+    };
+
+    // Constant buffer structure
+    struct CBObject
+    {
+        glm::mat4 worldViewProj;
+    };
+
+    // Константы PS пола: преобразование в пространство карты теней
+    struct CBShadow
+    {
+        glm::mat4 lightViewProj;
+    };
+
+    constexpr size_t kRenderTextureSize = 256;
+    constexpr size_t kCheckerSize = 256;
+    constexpr size_t kShadowMapSize = 512;
+    constexpr float kShadowBias = 0.002f; // В единицах глубины NDC
+    constexpr float kShadowLight = 0.4f;  // Освещённость в тени
+
+    // Пол — квадрат y = 0, текстура повторяется kFloorRepeat раз. Отсечения по ближней плоскости нет,
+    // поэтому пол целиком лежит перед камерой (z < 4)
+    constexpr float kFloorHalfWidth = 20.0f;
+    constexpr float kFloorNear = 2.0f;
+    constexpr float kFloorFar = -38.0f;
+    constexpr float kFloorRepeat = 20.0f;
+
+    // Мировая позиция точки пола по её texcoord (PS получает только texcoord и цвет)
+    glm::vec3 floorPosition( const glm::vec2 &uv )
+    {
+        const float x = -kFloorHalfWidth + uv.x * ( 2.0f * kFloorHalfWidth / kFloorRepeat );
+        const float z = kFloorFar + uv.y * ( ( kFloorNear - kFloorFar ) / kFloorRepeat );
+        return glm::vec3( x, 0.0f, z );
+    }
+
+    swr::VSOutput sceneVS( const swr::VertexInputView &input, const swr::ShaderContext &ctx )
+    {
+        const CBObject *cb = ctx.vsCB<CBObject>( 0 );
+        swr::VSOutput out;
+        out.position = cb->worldViewProj * glm::vec4( input.readFloat3( swr::Semantic::POSITION0 ), 1.0f );
+        out.color = input.readFloat3( swr::Semantic::COLOR0 );
+        out.texcoord = input.readFloat2( swr::Semantic::TEXCOORD0 );
+        return out;
+    }
+
+    glm::vec4 colorPS( const swr::PSInput &in, const swr::ShaderContext &ctx )
+    {
+        return glm::vec4( in.color, 1.0f );
+    }
+
+    glm::vec4 texturedPS( const swr::PSInput &in, const swr::ShaderContext &ctx )
+    {
+        return ctx.sample( 0, 0, in ) * glm::vec4( in.color, 1.0f );
+    }
+
+    glm::vec4 shadowedFloorPS( const swr::PSInput &in, const swr::ShaderContext &ctx )
+    {
+        const glm::vec4 color = ctx.sample( 0, 0, in ) * glm::vec4( in.color, 1.0f );
+        const CBShadow *cb = ctx.psCB<CBShadow>( 0 );
+        const glm::vec4 clip = cb->lightViewProj * glm::vec4( floorPosition( in.texcoord ), 1.0f );
+        const glm::vec3 ndc = glm::vec3( clip ) / clip.w;
+        // В карте теней — z в NDC, как в буфере глубины; вне карты (clamp к очищенному краю) тени нет
+        const float occluder = ctx.sampleLevel( 1, 1, glm::vec2( ndc.x * 0.5f + 0.5f, 0.5f - ndc.y * 0.5f ), 0.0f ).r;
+        const float light = ndc.z - kShadowBias > occluder ? kShadowLight : 1.0f;
+        return glm::vec4( glm::vec3( color ) * light, color.a );
+    }
+
+    // Альфа 0.5; для Premultiplied цвет заранее умножается на альфу
+    constexpr float kGlassAlpha = 0.5f;
+
+    glm::vec4 glassPS( const swr::PSInput &in, const swr::ShaderContext &ctx )
+    {
+        return glm::vec4( in.color, kGlassAlpha );
+    }
+
+    glm::vec4 glassPremultipliedPS( const swr::PSInput &in, const swr::ShaderContext &ctx )
+    {
+        return glm::vec4( in.color * kGlassAlpha, kGlassAlpha );
+    }
+
+    // Именованные шейдеры: захват кадра ссылается на них, swr_replay берёт их из реестра
+    const swr::ShaderRegistration sceneVSRegistration( "Texture.VS", sceneVS );
+    const swr::ShaderRegistration colorPSRegistration( "Texture.ColorPS", colorPS );
+    const swr::ShaderRegistration texturedPSRegistration( "Texture.TexturedPS", texturedPS );
+    const swr::ShaderRegistration shadowedFloorPSRegistration( "Texture.ShadowedFloorPS", shadowedFloorPS );
+    const swr::ShaderRegistration glassPSRegistration( "Texture.GlassPS", glassPS );
+    const swr::ShaderRegistration glassPremultipliedPSRegistration( "Texture.GlassPremultipliedPS",
+                                                                    glassPremultipliedPS );
+
+    const char *filterName( swr::TextureFilter f )
+    {
+        switch( f )
+        {
+        case swr::TextureFilter::Point:
+            return "POINT";
+        case swr::TextureFilter::Bilinear:
+            return "BILINEAR";
+        case swr::TextureFilter::Trilinear:
+            return "TRILINEAR";
+        }
+        return "?";
+    }
+
+    const char *blendName( swr::BlendMode m )
+    {
+        switch( m )
+        {
+        case swr::BlendMode::Opaque:
+            return "OPAQUE";
+        case swr::BlendMode::Alpha:
+            return "ALPHA";
+        case swr::BlendMode::Additive:
+            return "ADDITIVE";
+        case swr::BlendMode::Premultiplied:
+            return "PREMULTIPLIED";
+        }
+        return "?";
+    }
+} // unnamed namespace
+
+TextureScene::TextureScene( std::shared_ptr<swr::Device> dev ) : IScene( std::move( dev ) )
+{
+}
+
+void TextureScene::load()
+{
+    auto makeVB = [this]( const std::vector<VertexPCT> &vertices ) {
+        auto vb = device->createBuffer( sizeof( VertexPCT ), vertices.size(), swr::BufferFormat::Unknown );
+        vb->uploadData( vertices.data(), vertices.size() );
+        return vb;
+    };
+
+    triangleVB = makeVB( {
+        { { 0.0f, 0.6f, 0.0f }, { 1, 0, 0 }, { 0, 0 } },
+        { { 0.6f, -0.6f, 0.0f }, { 0, 1, 0 }, { 0, 0 } },
+        { { -0.6f, -0.6f, 0.0f }, { 0, 0, 1 }, { 0, 0 } },
+    } );
+
+    // Пол с многократно повторённой текстурой — дальние участки сильно уменьшены и требуют мипов
+    const float x0 = -kFloorHalfWidth, x1 = kFloorHalfWidth, zNear = kFloorNear, zFar = kFloorFar, t = kFloorRepeat;
+    floorVB = makeVB( {
+        { { x0, 0.0f, zFar }, { 1, 1, 1 }, { 0, 0 } },
+        { { x0, 0.0f, zNear }, { 1, 1, 1 }, { 0, t } },
+        { { x1, 0.0f, zNear }, { 1, 1, 1 }, { t, t } },
+        { { x0, 0.0f, zFar }, { 1, 1, 1 }, { 0, 0 } },
+        { { x1, 0.0f, zNear }, { 1, 1, 1 }, { t, t } },
+        { { x1, 0.0f, zFar }, { 1, 1, 1 }, { t, 0 } },
+    } );
+
+    // Вертикальный экран, на который выводится результат render-to-texture
+    screenVB = makeVB( {
+        { { -1.0f, 0.0f, 0.0f }, { 1, 1, 1 }, { 0, 1 } },
+        { { 1.0f, 0.0f, 0.0f }, { 1, 1, 1 }, { 1, 1 } },
+        { { 1.0f, 2.0f, 0.0f }, { 1, 1, 1 }, { 1, 0 } },
+        { { -1.0f, 0.0f, 0.0f }, { 1, 1, 1 }, { 0, 1 } },
+        { { 1.0f, 2.0f, 0.0f }, { 1, 1, 1 }, { 1, 0 } },
+        { { -1.0f, 2.0f, 0.0f }, { 1, 1, 1 }, { 0, 0 } },
+    } );
+
+    // Стекло: вертикальная полоса перед экраном
+    glassVB = makeVB( {
+        { { -1.4f, 0.3f, 0.6f }, { 0.2f, 0.6f, 1.0f }, { 0, 0 } },
+        { { 0.2f, 0.3f, 0.6f }, { 0.2f, 0.6f, 1.0f }, { 0, 0 } },
+        { { 0.2f, 1.4f, 0.6f }, { 1.0f, 0.4f, 0.8f }, { 0, 0 } },
+        { { -1.4f, 0.3f, 0.6f }, { 0.2f, 0.6f, 1.0f }, { 0, 0 } },
+        { { 0.2f, 1.4f, 0.6f }, { 1.0f, 0.4f, 0.8f }, { 0, 0 } },
+        { { -1.4f, 1.4f, 0.6f }, { 1.0f, 0.4f, 0.8f }, { 0, 0 } },
+    } );
+
+    swr::InputLayoutDesc layoutDesc;
+    layoutDesc.elements = {
+        { swr::Semantic::POSITION0, swr::InputFormat::R32G32B32_FLOAT, offsetof( VertexPCT, position ) },
+        { swr::Semantic::COLOR0, swr::InputFormat::R32G32B32_FLOAT, offsetof( VertexPCT, color ) },
+        { swr::Semantic::TEXCOORD0, swr::InputFormat::R32G32_FLOAT, offsetof( VertexPCT, texcoord ) },
+    };
+    layoutDesc.stride = sizeof( VertexPCT );
+    inputLayout = device->createInputLayout( layoutDesc );
+
+    // Процедурная шахматная текстура с полной цепочкой мипов
+    swr::TextureDesc checkerDesc;
+    checkerDesc.width = kCheckerSize;
+    checkerDesc.height = kCheckerSize;
+    checkerDesc.mipLevels = 0;
+    checkerDesc.format = swr::BufferFormat::R8G8B8A8_UNORM;
+    checkerDesc.bindFlags = swr::TextureBindShaderResource;
+    checkerTexture = device->createTexture2D( checkerDesc );
+    std::vector<uint8_t> texels( kCheckerSize * kCheckerSize * 4 );
+    for( size_t y = 0; y < kCheckerSize; ++y )
+    {
+        for( size_t x = 0; x < kCheckerSize; ++x )
+        {
+            bool odd = ( ( x / 32 ) ^ ( y / 32 ) ) & 1;
+            uint8_t *p = &texels[( y * kCheckerSize + x ) * 4];
+            p[0] = odd ? 230 : 40;
+            p[1] = odd ? 200 : 40;
+            p[2] = odd ? 120 : 60;
+            p[3] = 255;
+        }
+    }
+    checkerTexture->uploadData( texels.data() );
+    checkerTexture->generateMips();
+
+    // Сжатая копия: 8x меньше памяти, распаковка блоков при выборке
+    checkerDesc.format = swr::BufferFormat::BC1_UNORM;
+    checkerTextureBC1 = device->createTexture2D( checkerDesc );
+    checkerTextureBC1->uploadData(
+        swr::compressImage( swr::BufferFormat::BC1_UNORM, texels.data(), kCheckerSize, kCheckerSize ).data() );
+    checkerTextureBC1->generateMips();
+
+    // Цель рендеринга; мипы перестраиваются автоматически при переключении цели
+    swr::TextureDesc rtDesc;
+    rtDesc.width = kRenderTextureSize;
+    rtDesc.height = kRenderTextureSize;
+    rtDesc.mipLevels = 0;
+    rtDesc.format = swr::BufferFormat::R8G8B8A8_UNORM;
+    rtDesc.bindFlags = swr::TextureBindShaderResource | swr::TextureBindRenderTarget;
+    renderTexture = device->createTexture2D( rtDesc );
+
+    // Карта теней: цель только глубины, после прохода читается в PS пола
+    swr::TextureDesc shadowDesc;
+    shadowDesc.width = kShadowMapSize;
+    shadowDesc.height = kShadowMapSize;
+    shadowDesc.format = swr::BufferFormat::D32_FLOAT;
+    shadowDesc.bindFlags = swr::TextureBindShaderResource | swr::TextureBindDepthStencil;
+    shadowMap = device->createTexture2D( shadowDesc );
+}
+
+void TextureScene::init()
+{
+    device->OM().setClearColor( glm::vec4( 0.05f, 0.05f, 0.08f, 1.0f ) );
+
+    device->IA().setInputLayout( inputLayout );
+    device->IA().setPrimitiveTopology( swr::PrimitiveTopology::TriangleList );
+    device->VS().setNamedVertexShader( "Texture.VS" );
+    device->RS().setWireframe( false );
+    device->RS().setCullBackface( false );
+}
+
+void TextureScene::prepareFrame( float dt )
+{
+    if( animate )
+        angle += dt;
+    swr::SamplerState sampler;
+    sampler.filter = filter;
+    device->PS().setSampler( 0, sampler );
+
+    swr::SamplerState shadowSampler;
+    shadowSampler.filter = swr::TextureFilter::Point;
+    shadowSampler.addressU = swr::TextureAddressMode::Clamp;
+    shadowSampler.addressV = swr::TextureAddressMode::Clamp;
+    device->PS().setSampler( 1, shadowSampler );
+}
+
+void TextureScene::drawQuad( const std::shared_ptr<swr::Buffer> &quad, const glm::mat4 &worldViewProj )
+{
+    device->VS().setConstants( 0, device->pushConstants( CBObject{ worldViewProj } ) );
+    device->IA().setVertexBuffer( quad );
+    device->draw( quad->elementCount(), 0 );
+}
+
+void TextureScene::renderFrame()
+{
+    const glm::vec4 backgroundColor = device->OM().clearColor();
+    const glm::mat4 screenWorld =
+        glm::rotate( glm::mat4( 1.0f ), std::sin( angle * 0.5f ) * 0.6f, glm::vec3( 0.0f, 1.0f, 0.0f ) );
+    // Направленный свет сверху слева сзади: ортографическая проекция вокруг экрана
+    const glm::mat4 lightViewProj =
+        glm::ortho( -3.0f, 3.0f, -3.0f, 3.0f, 0.1f, 20.0f ) *
+        glm::lookAt( glm::vec3( -3.0f, 5.0f, -2.0f ), glm::vec3( 0.0f, 0.8f, 0.0f ), glm::vec3( 0.0f, 1.0f, 0.0f ) );
+
+    // Проход 0: карта теней. PS не задан — растеризатор пишет только глубину, без интерполяции атрибутов
+    if( shadows )
+    {
+        device->OM().setRenderTarget( shadowMap );
+        device->clear();
+        device->RS().setViewport(
+            { 0, 0, static_cast<int>( kShadowMapSize ), static_cast<int>( kShadowMapSize ), 0.0f, 1.0f } );
+        device->PS().setPixelShader( nullptr );
+        drawQuad( screenVB, lightViewProj * screenWorld );
+    }
+
+    // Проход 1: вращающийся треугольник в текстуру
+    device->OM().setRenderTarget( renderTexture );
+    device->OM().setClearColor( glm::vec4( 0.2f, 0.2f, 0.25f, 1.0f ) );
+    device->clear();
+    device->RS().setViewport(
+        { 0, 0, static_cast<int>( kRenderTextureSize ), static_cast<int>( kRenderTextureSize ), 0.0f, 1.0f } );
+    device->PS().setNamedPixelShader( "Texture.ColorPS" );
+    drawQuad( triangleVB, glm::rotate( glm::mat4( 1.0f ), angle, glm::vec3( 0.0f, 0.0f, 1.0f ) ) );
+
+    // Проход 2: сцена в задний буфер, текстура из прохода 1 уже разрешена и имеет мипы
+    device->OM().setRenderTarget( nullptr );
+    device->OM().setClearColor( backgroundColor );
+    const int fw = static_cast<int>( device->deviceFrameWidth() );
+    const int fh = static_cast<int>( device->deviceFrameHeight() );
+    device->RS().setViewport( { 0, 0, fw, fh, 0.0f, 1.0f } );
+
+    const float aspect = static_cast<float>( fw ) / static_cast<float>( std::max( fh, 1 ) );
+    glm::mat4 proj = glm::perspective( glm::radians( 60.0f ), aspect, 0.1f, 100.0f );
+    glm::mat4 view = glm::lookAt( glm::vec3( 0.0f, 1.5f, 4.0f ), glm::vec3( 0.0f, 0.8f, 0.0f ),
+                                  glm::vec3( 0.0f, 1.0f, 0.0f ) );
+
+    device->PS().setNamedPixelShader( shadows ? "Texture.ShadowedFloorPS" : "Texture.TexturedPS" );
+    device->PS().setShaderResource( 0, compressedFloor ? checkerTextureBC1 : checkerTexture );
+    device->PS().setShaderResource( 1, shadowMap );
+    device->PS().setConstants( 0, device->pushConstants( CBShadow{ lightViewProj } ) );
+    drawQuad( floorVB, proj * view );
+
+    device->PS().setNamedPixelShader( "Texture.TexturedPS" );
+    device->PS().setShaderResource( 0, renderTexture );
+    drawQuad( screenVB, proj * view * screenWorld );
+
+    // Прозрачное рисуется последним
+    swr::BlendState blend;
+    blend.mode = glassBlend;
+    device->OM().setBlendState( blend );
+    device->PS().setNamedPixelShader( glassBlend == swr::BlendMode::Premultiplied ? "Texture.GlassPremultipliedPS"
+                                                                                 : "Texture.GlassPS" );
+    drawQuad( glassVB, proj * view );
+    device->OM().setBlendState( swr::BlendState{} );
+}
+
+void TextureScene::handleKeyEvent( SDL_KeyboardEvent &ke )
+{
+    if( ke.key == SDLK_F )
+    {
+        filter = filter == swr::TextureFilter::Point      ? swr::TextureFilter::Bilinear
+                 : filter == swr::TextureFilter::Bilinear ? swr::TextureFilter::Trilinear
+                                                          : swr::TextureFilter::Point;
+        std::cout << "Filter: " << filterName( filter ) << std::endl;
+    }
+    else if( ke.key == SDLK_B )
+    {
+        glassBlend = static_cast<swr::BlendMode>( ( static_cast<int>( glassBlend ) + 1 ) % 4 );
+        std::cout << "Blend: " << blendName( glassBlend ) << std::endl;
+    }
+    else if( ke.key == SDLK_A )
+    {
+        animate = !animate;
+        std::cout << "Animation: " << ( animate ? "ON" : "OFF" ) << std::endl;
+    }
+    else if( ke.key == SDLK_C )
+    {
+        compressedFloor = !compressedFloor;
+        const auto &tex = compressedFloor ? checkerTextureBC1 : checkerTexture;
+        std::cout << "Floor texture: " << ( compressedFloor ? "BC1" : "RGBA8" ) << ", " << tex->memorySize() / 1024
+                  << " KiB" << std::endl;
+    }
+    else if( ke.key == SDLK_S )
+    {
+        shadows = !shadows;
+        std::cout << "Shadows: " << ( shadows ? "ON" : "OFF" ) << std::endl;
+    }
+}
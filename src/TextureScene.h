@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+
+#include "IScene.h"
+
+// Сцена с текстурами: треугольник рендерится в текстуру (render-to-texture), затем она и
+// процедурная шахматная текстура с мипами выводятся на плоскостях в перспективе.
+// Экран отбрасывает тень на пол через карту теней (текстура глубины, проход без PS).
+// Перед экраном — полупрозрачное стекло для проверки режимов смешивания OM
+class TextureScene : public IScene
+{
+  public:
+    explicit TextureScene( std::shared_ptr<swr::Device> dev );
+    ~TextureScene() override = default;
+
+    void load() override;
+    void init() override;
+    void prepareFrame( float dt ) override;
+    void renderFrame() override;
+
+    void handleKeyEvent( SDL_KeyboardEvent &ke ) override;
+
+  private:
+    void drawQuad( const std::shared_ptr<swr::Buffer> &quad, const glm::mat4 &worldViewProj );
+
+    swr::TextureFilter filter = swr::TextureFilter::Trilinear;
+    swr::BlendMode glassBlend = swr::BlendMode::Alpha;
+    bool animate = true;
+    bool compressedFloor = false;
+    bool shadows = true;
+    float angle = 0.0f; // radians
+
+    std::shared_ptr<swr::Buffer> triangleVB;
+    std::shared_ptr<swr::Buffer> floorVB;
+    std::shared_ptr<swr::Buffer> screenVB;
+    std::shared_ptr<swr::Buffer> glassVB;
+    std::shared_ptr<swr::InputLayout> inputLayout;
+    std::shared_ptr<swr::Texture2D> checkerTexture;
+    std::shared_ptr<swr::Texture2D> checkerTextureBC1; // Та же текстура в BC1 (клавиша C)
+    std::shared_ptr<swr::Texture2D> renderTexture;
+    std::shared_ptr<swr::Texture2D> shadowMap; // D32_FLOAT: глубина экрана с точки зрения источника света
+};
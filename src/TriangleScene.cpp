@@ -20,15 +20,43 @@ struct CBScene
     float padding[3]; // For alignment
 };
 
-TriangleScene::TriangleScene( std::shared_ptr<swr::Device> dev ) : IScene( std::move( dev ) )
+// Vertex shader that reads angle from constant buffer
+static swr::VSOutput triangleVS( const swr::VertexInputView &input, const swr::ShaderContext &ctx )
 {
+    // Read angle from constant buffer slot 0
+    const CBScene *cb = ctx.vsCB<CBScene>( 0 );
+    float angle = cb ? cb->angle : 0.0f;
+
+    // Read vertex attributes by semantic
+    glm::vec3 position = input.readFloat3( swr::Semantic::POSITION0 );
+    glm::vec3 color = input.readFloat3( swr::Semantic::COLOR0 );
+
+    // Простая вращательная анимация вокруг оси Z, основанная на angle
+    float c = std::cos( angle );
+    float s = std::sin( angle );
+    glm::vec3 rotated{ position.x * c - position.y * s, position.x * s + position.y * c, position.z };
+
+    swr::VSOutput out;
+    out.position = glm::vec4( rotated, 1.0f );
+    out.color = color;
+    return out;
 }
 
-void TriangleScene::init()
+static glm::vec4 trianglePS( const swr::PSInput &in, const swr::ShaderContext &ctx )
 {
-    // Set clear color to blue with full opacity
-    device->OM().setClearColor( glm::vec4( 0.0f, 0.0f, 1.0f, 1.0f ) );
+    return glm::vec4( in.color, 1.0f );
+}
+
+// Шейдеры сцены доступны по имени: захват кадра ссылается на них, swr_replay берёт их из реестра
+static const swr::ShaderRegistration triangleVSRegistration( "Triangle.VS", triangleVS );
+static const swr::ShaderRegistration trianglePSRegistration( "Triangle.PS", trianglePS );
+
+TriangleScene::TriangleScene( std::shared_ptr<swr::Device> dev ) : IScene( std::move( dev ) )
+{
+}
 
+void TriangleScene::load()
+{
     // Setup vertices using local VertexPC structure
     std::vector<VertexPC> vertices = {
         { { 0.0f, 0.5f, 0.0f }, { 1, 0, 0 } },
@@ -53,6 +81,12 @@ void TriangleScene::init()
     constantBuffer = device->createBuffer( sizeof( CBScene ), 1, swr::BufferFormat::Unknown );
     CBScene cbData{ angle, { 0.0f, 0.0f, 0.0f } };
     constantBuffer->uploadData( &cbData, 1 );
+}
+
+void TriangleScene::init()
+{
+    // Set clear color to blue with full opacity
+    device->OM().setClearColor( glm::vec4( 0.0f, 0.0f, 1.0f, 1.0f ) );
 
     // Set IA stage
     device->IA().setVertexBuffer( vb );
@@ -62,33 +96,8 @@ void TriangleScene::init()
     // Bind constant buffer to VS slot 0
     device->VS().setConstantBuffer( 0, constantBuffer );
 
-    // Define vertex shader that reads angle from constant buffer
-    swr::VertexShader vs = []( const swr::VertexInputView &input, const swr::ShaderContext &ctx ) -> swr::VSOutput {
-        // Read angle from constant buffer slot 0
-        const CBScene *cb = ctx.vsCB<CBScene>( 0 );
-        float angle = cb ? cb->angle : 0.0f;
-
-        // Read vertex attributes by semantic
-        glm::vec3 position = input.readFloat3( swr::Semantic::POSITION0 );
-        glm::vec3 color = input.readFloat3( swr::Semantic::COLOR0 );
-
-        // Простая вращательная анимация вокруг оси Z, основанная на angle
-        float c = std::cos( angle );
-        float s = std::sin( angle );
-        glm::vec3 rotated{ position.x * c - position.y * s, position.x * s + position.y * c, position.z };
-
-        swr::VSOutput out;
-        out.position = glm::vec4( rotated, 1.0f );
-        out.color = color;
-        return out;
-    };
-    device->VS().setVertexShader( vs );
-
-    // Define pixel shader with ShaderContext parameter
-    swr::PixelShader ps = []( const swr::PSInput &in, const swr::ShaderContext &ctx ) -> glm::vec4 {
-        return glm::vec4( in.color, 1.0f );
-    };
-    device->PS().setPixelShader( ps );
+    device->VS().setNamedVertexShader( "Triangle.VS" );
+    device->PS().setNamedPixelShader( "Triangle.PS" );
 
     // Default full viewport
     swr::Viewport vp{
@@ -197,13 +206,10 @@ void TriangleScene::handleKeyEvent( SDL_KeyboardEvent &ke )
     }
     else if( ke.key == SDLK_O )
     {
-        // Flip winding by swapping vertices 1 and 2
-        std::vector<VertexPC> vertices( 3 );
-        const VertexPC *vbData = static_cast<const VertexPC *>( vb->data() );
-        vertices[0] = vbData[0];
-        vertices[1] = vbData[2]; // Swap
-        vertices[2] = vbData[1]; // Swap
-        vb->uploadData( vertices.data(), vertices.size() );
+        // Flip winding by swapping vertices 1 and 2 in place (only these two are marked dirty)
+        VertexPC *vbData = static_cast<VertexPC *>( vb->map( 1, 2, swr::MapMode::ReadWrite ) );
+        std::swap( vbData[0], vbData[1] );
+        vb->unmap();
         std::cout << "Winding flipped (O). With cull ON, triangle will toggle visibility." << std::endl;
     }
 }
@@ -11,6 +11,7 @@ class TriangleScene : public IScene
     explicit TriangleScene( std::shared_ptr<swr::Device> dev );
     ~TriangleScene() override = default;
 
+    void load() override;
     void init() override;
     void prepareFrame( float dt ) override;
     void renderFrame() override;
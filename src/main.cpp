@@ -1,13 +1,94 @@
 #include <SDL3/SDL.h>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 #include "IScene.h"
+#include "MeshScene.h"
+#include "OcclusionScene.h"
 #include "SceneManager.h"
+#include "StressScene.h"
+#include "TextureScene.h"
 #include "TriangleScene.h"
 #include "swrDevice.h"
+#include "swrDynamicResolution.h"
+#include "swrFrameStats.h"
+
+static void printUsage( const char *exe )
+{
+    std::cerr << "Usage: " << exe << " [options] [mesh.swrm|mesh.obj]\n"
+              << "  --scene NAME     start scene (Triangle, Texture, Occlusion, Stress, Mesh)\n"
+              << "  --no-vsync       present without waiting for vsync\n"
+              << "  --frames N       exit after N frames\n"
+              << "  --fixed-dt SEC   advance animation by a fixed timestep instead of the measured one\n"
+              << "  --benchmark N    same as --no-vsync --frames N --fixed-dt 0.016667\n"
+              << "  --memory-budget MB  fail resource creation beyond MB megabytes\n"
+              << "  --capture N      capture frame N to frame_N.swrc for swr_replay (F12 captures the next frame)"
+              << std::endl;
+}
 
 int main( int argc, char *argv[] )
 {
+    std::string meshPath;
+    std::string startScene;
+    bool vsync = true;
+    long maxFrames = 0;          // 0 — без ограничения
+    double fixedDt = 0.0;        // 0 — измеренное время кадра
+    long memoryBudgetMb = 0;     // 0 — без ограничения
+    long captureFrameNumber = 0; // Номер кадра (с 1) для захвата, 0 — без захвата
+    for( int i = 1; i < argc; ++i )
+    {
+        const std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        char *end = nullptr;
+        bool valid = true;
+        if( arg == "--scene" && value )
+        {
+            startScene = argv[++i];
+        }
+        else if( arg == "--no-vsync" )
+        {
+            vsync = false;
+        }
+        else if( ( arg == "--frames" || arg == "--benchmark" ) && value )
+        {
+            maxFrames = std::strtol( argv[++i], &end, 10 );
+            valid = maxFrames > 0 && *end == '\0';
+            if( arg == "--benchmark" )
+            {
+                vsync = false;
+                fixedDt = 1.0 / 60.0;
+            }
+        }
+        else if( arg == "--fixed-dt" && value )
+        {
+            fixedDt = std::strtod( argv[++i], &end );
+            valid = fixedDt > 0.0 && *end == '\0';
+        }
+        else if( arg == "--memory-budget" && value )
+        {
+            memoryBudgetMb = std::strtol( argv[++i], &end, 10 );
+            valid = memoryBudgetMb > 0 && *end == '\0';
+        }
+        else if( arg == "--capture" && value )
+        {
+            captureFrameNumber = std::strtol( argv[++i], &end, 10 );
+            valid = captureFrameNumber > 0 && *end == '\0';
+        }
+        else
+        {
+            valid = arg[0] != '-' && meshPath.empty();
+            meshPath = arg;
+        }
+        if( !valid )
+        {
+            printUsage( argv[0] );
+            return 1;
+        }
+    }
+
     // Initialize SDL
     if( !SDL_Init( SDL_INIT_VIDEO ) )
     {
@@ -36,7 +117,12 @@ int main( int argc, char *argv[] )
     }
 
     // Enable adaptive VSync if possible (fallback to normal vsync)
-    if( !SDL_SetRenderVSync( renderer, SDL_RENDERER_VSYNC_ADAPTIVE ) )
+    if( !vsync )
+    {
+        // Бенчмарк: кадры не ждут обновления экрана, время кадра — реальная пропускная способность
+        SDL_SetRenderVSync( renderer, 0 );
+    }
+    else if( !SDL_SetRenderVSync( renderer, SDL_RENDERER_VSYNC_ADAPTIVE ) )
     {
         // Fallback to standard vsync interval 1
         SDL_SetRenderVSync( renderer, 1 );
@@ -66,15 +152,33 @@ int main( int argc, char *argv[] )
 
     // Create software rendering device
     std::shared_ptr<swr::Device> device = swr::Device::create( outW, outH );
+    device->setMemoryBudget( static_cast<size_t>( memoryBudgetMb ) << 20 );
 
     // Scene system setup
     SceneManager sceneManager;
     sceneManager.registerScene( "Triangle", []( std::shared_ptr<swr::Device> dev ) {
         return std::make_unique<TriangleScene>( std::move( dev ) );
     } );
-    if( !sceneManager.setCurrentScene( "Triangle", device ) )
+    sceneManager.registerScene( "Texture", []( std::shared_ptr<swr::Device> dev ) {
+        return std::make_unique<TextureScene>( std::move( dev ) );
+    } );
+    sceneManager.registerScene( "Occlusion", []( std::shared_ptr<swr::Device> dev ) {
+        return std::make_unique<OcclusionScene>( std::move( dev ) );
+    } );
+    sceneManager.registerScene( "Stress", []( std::shared_ptr<swr::Device> dev ) {
+        return std::make_unique<StressScene>( std::move( dev ) );
+    } );
+    if( !meshPath.empty() )
+    {
+        sceneManager.registerScene( "Mesh", [meshPath]( std::shared_ptr<swr::Device> dev ) {
+            return std::make_unique<MeshScene>( std::move( dev ), meshPath );
+        } );
+    }
+    if( startScene.empty() )
+        startScene = meshPath.empty() ? "Triangle" : "Mesh";
+    if( !sceneManager.setCurrentScene( startScene, device ) )
     {
-        std::cerr << "Failed to create Triangle scene" << std::endl;
+        std::cerr << "Failed to create " << startScene << " scene" << std::endl;
         SDL_DestroyTexture( texture );
         SDL_DestroyRenderer( renderer );
         SDL_DestroyWindow( window );
@@ -82,6 +186,10 @@ int main( int argc, char *argv[] )
         return 1;
     }
     sceneManager.getCurrent()->init();
+    // Соседние сцены грузятся в фоне заранее — переключение стрелками мгновенное (клавиша L).
+    // В прогоне с фиксированным числом кадров фоновая загрузка исказила бы замеры
+    bool prewarmScenes = maxFrames == 0;
+    sceneManager.setPrewarm( prewarmScenes, device );
 
     // Main loop
     bool running = true;
@@ -93,17 +201,44 @@ int main( int argc, char *argv[] )
     Uint64 perfFreq = SDL_GetPerformanceFrequency();
     Uint64 lastCounter = SDL_GetPerformanceCounter();
 
+    // Динамическое разрешение: масштаб подстраивается под время рендеринга (клавиша D)
+    bool dynamicResolution = false;
+    swr::DynamicResolutionController resolutionController;
+    device->setUpscaleSharpness( 0.5f );
+    double titleTimer = 0.0;
+
+    // Времена кадров для сводки при выходе: полный кадр (включая present) и только рендеринг
+    swr::FrameTimeStats frameStats, renderStats;
+    long frameCount = 0;
+    bool captureNext = false; // F12: захват следующего кадра
+    if( maxFrames > 0 )
+    {
+        frameStats.reserve( static_cast<size_t>( maxFrames ) );
+        renderStats.reserve( static_cast<size_t>( maxFrames ) );
+    }
+
     while( running )
     {
         // Compute delta time in seconds
         Uint64 now = SDL_GetPerformanceCounter();
         double dtSec = static_cast<double>( now - lastCounter ) / static_cast<double>( perfFreq );
         lastCounter = now;
-        // Clamp dt to avoid huge steps on hitches
-        if( dtSec < 0.0 )
-            dtSec = 0.0; // just in case
-        if( dtSec > 0.1 )
-            dtSec = 0.1; // cap ~100ms
+        // Первый интервал включает инициализацию, а не кадр
+        if( frameCount > 0 )
+            frameStats.add( dtSec * 1000.0 );
+        if( fixedDt > 0.0 )
+        {
+            // Фиксированный шаг: анимация воспроизводима независимо от скорости машины
+            dtSec = fixedDt;
+        }
+        else
+        {
+            // Clamp dt to avoid huge steps on hitches
+            if( dtSec < 0.0 )
+                dtSec = 0.0; // just in case
+            if( dtSec > 0.1 )
+                dtSec = 0.1; // cap ~100ms
+        }
 
         while( SDL_PollEvent( &event ) )
         {
@@ -138,30 +273,65 @@ int main( int argc, char *argv[] )
             else if( event.type == SDL_EVENT_KEY_DOWN )
             {
                 SDL_KeyboardEvent &ke = event.key;
-                // Переключение сцен по стрелкам
+                // Переключение сцен по стрелкам: загрузка в фоне, до готовности рисуется текущая сцена
                 if( ke.key == SDLK_RIGHT )
                 {
-                    if( sceneManager.switchNext( device ) )
-                    {
-                        if( auto *scene = sceneManager.getCurrent() )
-                        {
-                            scene->init();
-                            scene->onResize( static_cast<int>( device->deviceFrameWidth() ),
-                                             static_cast<int>( device->deviceFrameHeight() ) );
-                        }
-                    }
+                    sceneManager.switchNext( device );
                 }
                 else if( ke.key == SDLK_LEFT )
                 {
-                    if( sceneManager.switchPrev( device ) )
-                    {
-                        if( auto *scene = sceneManager.getCurrent() )
-                        {
-                            scene->init();
-                            scene->onResize( static_cast<int>( device->deviceFrameWidth() ),
-                                             static_cast<int>( device->deviceFrameHeight() ) );
-                        }
-                    }
+                    sceneManager.switchPrev( device );
+                }
+                else if( ke.key == SDLK_L )
+                {
+                    prewarmScenes = !prewarmScenes;
+                    sceneManager.setPrewarm( prewarmScenes, device );
+                    std::cout << "Scene prewarm: " << ( prewarmScenes ? "ON" : "OFF" ) << std::endl;
+                }
+                else if( ke.key == SDLK_D )
+                {
+                    dynamicResolution = !dynamicResolution;
+                    resolutionController.reset();
+                    device->setRenderScale( 1.0f );
+                    std::cout << "Dynamic resolution: " << ( dynamicResolution ? "ON" : "OFF" ) << std::endl;
+                }
+                else if( ke.key == SDLK_M )
+                {
+                    // Переключение 4x MSAA заднего буфера
+                    device->setSampleCount( device->sampleCount() == 1 ? 4 : 1 );
+                    std::cout << "MSAA: " << device->sampleCount() << "x" << std::endl;
+                }
+                else if( ke.key == SDLK_T )
+                {
+                    // Тайловая раскладка заднего буфера (тайлы 4x4) вместо построчной
+                    const bool tiled = device->framebufferLayout() == swr::SurfaceLayout::Tiled;
+                    device->setFramebufferLayout( tiled ? swr::SurfaceLayout::Linear : swr::SurfaceLayout::Tiled );
+                    std::cout << "Framebuffer layout: " << ( tiled ? "linear" : "tiled 4x4" ) << std::endl;
+                }
+                else if( ke.key == SDLK_H )
+                {
+                    // fp16: задний буфер RGBA16F и цвет вершин после VS в half
+                    const bool half = device->backBufferFormat() == swr::SurfaceFormat::RGBA16F;
+                    device->setBackBufferFormat( half ? swr::SurfaceFormat::RGBA32F : swr::SurfaceFormat::RGBA16F );
+                    device->setHalfVaryings( !half );
+                    std::cout << "Half precision color: " << ( half ? "OFF" : "ON" ) << std::endl;
+                }
+                else if( ke.key == SDLK_G )
+                {
+                    // Буфер видимости: PS один раз на видимый пиксель вместо каждого прошедшего тест глубины
+                    device->setVisibilityBuffer( !device->visibilityBuffer() );
+                    std::cout << "Visibility buffer: " << ( device->visibilityBuffer() ? "ON" : "OFF" ) << std::endl;
+                }
+                else if( ke.key == SDLK_F12 )
+                {
+                    captureNext = true;
+                }
+                else if( ke.key == SDLK_R )
+                {
+                    // Инкрементальный рендеринг: перерисовываются и выгружаются только изменившиеся тайлы
+                    device->setIncrementalRendering( !device->incrementalRendering() );
+                    std::cout << "Incremental rendering: " << ( device->incrementalRendering() ? "ON" : "OFF" )
+                              << std::endl;
                 }
                 else
                 {
@@ -183,7 +353,31 @@ int main( int argc, char *argv[] )
             }
         }
 
+        // Загруженная в фоне сцена становится текущей между кадрами
+        if( sceneManager.update() )
+        {
+            if( auto *scene = sceneManager.getCurrent() )
+            {
+                scene->init();
+                scene->onResize( static_cast<int>( device->deviceFrameWidth() ),
+                                 static_cast<int>( device->deviceFrameHeight() ) );
+            }
+        }
+
+        // Время рендеринга меряется без present: ожидание vsync не должно влиять на разрешение
+        const Uint64 renderStart = SDL_GetPerformanceCounter();
+
+        // Захват кадра: команды и ресурсы кадра пишутся в файл для воспроизведения в swr_replay
+        std::string capturePath;
+        if( captureNext || frameCount + 1 == captureFrameNumber )
+        {
+            captureNext = false;
+            capturePath = "frame_" + std::to_string( frameCount + 1 ) + ".swrc";
+            device->captureFrame( capturePath );
+        }
+
         // Clear device
+        device->beginFrame();
         device->clear();
         // Prepare and render via current scene
         if( auto *scene = sceneManager.getCurrent() )
@@ -192,13 +386,54 @@ int main( int argc, char *argv[] )
             scene->renderFrame();
             scene->endFrame();
         }
+        // Отложенное затенение буфера видимости и перерисовка изменившихся тайлов — часть рендеринга кадра
+        try
+        {
+            device->endFrame();
+            if( !capturePath.empty() )
+                std::cout << "Captured frame to " << capturePath << std::endl;
+        }
+        catch( const std::runtime_error &e )
+        {
+            // Не записался только файл захвата, кадр отрисован
+            std::cerr << e.what() << std::endl;
+        }
+
+        const double renderMs =
+            static_cast<double>( SDL_GetPerformanceCounter() - renderStart ) * 1000.0 / static_cast<double>( perfFreq );
+        renderStats.add( renderMs );
+        if( dynamicResolution )
+            device->setRenderScale( resolutionController.update( static_cast<float>( renderMs ) ) );
+
+        titleTimer += dtSec;
+        if( titleTimer >= 0.5 )
+        {
+            titleTimer = 0.0;
+            char title[160];
+            std::snprintf( title, sizeof( title ), "Software Renderer - %zux%zu, %.1f ms, %llu PS, %.1f MB",
+                           device->renderWidth(), device->renderHeight(), renderMs,
+                           static_cast<unsigned long long>( device->pipelineStatistics().psInvocations ),
+                           static_cast<double>( device->memoryStats().liveBytes ) / ( 1024.0 * 1024.0 ) );
+            SDL_SetWindowTitle( window, title );
+        }
 
         // Present the rendered frame
         device->present( renderer, texture );
 
         // No SDL_Delay here; VSync will pace via SDL_RenderPresent
+
+        if( ++frameCount == maxFrames )
+            running = false;
     }
 
+    std::cout << "Start scene " << startScene << ", " << device->deviceFrameWidth() << "x"
+              << device->deviceFrameHeight() << ( vsync ? ", vsync" : ", no vsync" ) << std::endl;
+    frameStats.print( std::cout, "Frame time" );
+    renderStats.print( std::cout, "Render time" );
+    const swr::MemoryStats memory = device->memoryStats();
+    std::cout << "Resource memory: peak " << ( memory.peakBytes >> 20 ) << " MB, buffer pool hits " << memory.poolHits
+              << " / misses " << memory.poolMisses << std::endl;
+
     // Cleanup
     SDL_DestroyTexture( texture );
     SDL_DestroyRenderer( renderer );
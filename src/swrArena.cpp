@@ -0,0 +1,101 @@
+#include "swrArena.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace swr
+{
+    LinearArena::LinearArena( size_t blockSize ) : blockSize( blockSize )
+    {
+    }
+
+    void LinearArena::addBlock( size_t minSize )
+    {
+        size_t size = std::max( blockSize, minSize );
+        blocks.push_back( Block{ std::unique_ptr<uint8_t[]>( new uint8_t[size] ), size } );
+    }
+
+    void *LinearArena::allocate( size_t bytes, size_t alignment )
+    {
+        assert( ( alignment & ( alignment - 1 ) ) == 0 && "Alignment must be a power of two" );
+        // Ищем место в текущем или следующих (уже выделенных) блоках
+        while( currentBlock < blocks.size() )
+        {
+            Block &b = blocks[currentBlock];
+            uintptr_t base = reinterpret_cast<uintptr_t>( b.memory.get() );
+            size_t aligned = ( ( base + offset + alignment - 1 ) & ~( uintptr_t( alignment ) - 1 ) ) - base;
+            if( aligned + bytes <= b.size )
+            {
+                used += aligned + bytes - offset;
+                offset = aligned + bytes;
+                highWater = std::max( highWater, used );
+                return b.memory.get() + aligned;
+            }
+            ++currentBlock;
+            offset = 0;
+        }
+        addBlock( bytes + alignment );
+        return allocate( bytes, alignment );
+    }
+
+    void LinearArena::rewind( const Marker &m )
+    {
+        currentBlock = m.block;
+        offset = m.offset;
+        used = m.used;
+    }
+
+    void LinearArena::reset()
+    {
+        // Несколько блоков — признак того, что кадру мало одного; сливаем в один блок суммарного размера
+        if( blocks.size() > 1 )
+        {
+            size_t total = capacity();
+            blocks.clear();
+            addBlock( total );
+        }
+        currentBlock = 0;
+        offset = 0;
+        used = 0;
+    }
+
+    size_t LinearArena::capacity() const
+    {
+        size_t total = 0;
+        for( const auto &b : blocks )
+            total += b.size;
+        return total;
+    }
+
+    FrameArena::FrameArena( size_t threadCount, size_t blockSize ) : blockSize( blockSize )
+    {
+        setThreadCount( threadCount );
+    }
+
+    void FrameArena::setThreadCount( size_t threadCount )
+    {
+        threadCount = std::max<size_t>( threadCount, 1 );
+        while( arenas.size() > threadCount )
+            arenas.pop_back();
+        while( arenas.size() < threadCount )
+            arenas.emplace_back( blockSize );
+    }
+
+    void FrameArena::reset()
+    {
+        for( auto &a : arenas )
+            a.reset();
+    }
+
+    FrameMemoryStats FrameArena::stats() const
+    {
+        FrameMemoryStats s;
+        for( const auto &a : arenas )
+        {
+            s.bytesUsed += a.bytesUsed();
+            s.highWaterMark += a.highWaterMark();
+            s.capacity += a.capacity();
+        }
+        return s;
+    }
+} // namespace swr
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace swr
+{
+    // Линейный (bump) аллокатор для временной памяти конвейера.
+    // Память не освобождается поштучно: reset() отдаёт всё разом, rewind() — до сохранённой отметки.
+    // После reset() занятые блоки сливаются в один, так что в установившемся режиме malloc не вызывается.
+    class LinearArena
+    {
+      public:
+        explicit LinearArena( size_t blockSize = 1 << 20 );
+
+        LinearArena( const LinearArena & ) = delete;
+        LinearArena &operator=( const LinearArena & ) = delete;
+        LinearArena( LinearArena && ) = default;
+        LinearArena &operator=( LinearArena && ) = default;
+
+        void *allocate( size_t bytes, size_t alignment = alignof( std::max_align_t ) );
+
+        // Неинициализированный массив из count элементов; деструкторы не вызываются
+        template <typename T>
+        T *allocate( size_t count )
+        {
+            static_assert( std::is_trivially_destructible<T>::value, "Arena objects are never destroyed" );
+            return static_cast<T *>( allocate( sizeof( T ) * count, alignof( T ) ) );
+        }
+
+        // Отметка текущей позиции: rewind() освобождает всё выделенное после неё
+        struct Marker
+        {
+            size_t block;
+            size_t offset;
+            size_t used;
+        };
+        Marker marker() const
+        {
+            return Marker{ currentBlock, offset, used };
+        }
+        void rewind( const Marker &m );
+
+        // Освобождение всей памяти арены (начало кадра)
+        void reset();
+
+        size_t bytesUsed() const
+        {
+            return used;
+        }
+        size_t highWaterMark() const
+        {
+            return highWater;
+        }
+        size_t capacity() const;
+
+      private:
+        struct Block
+        {
+            std::unique_ptr<uint8_t[]> memory;
+            size_t size;
+        };
+
+        void addBlock( size_t minSize );
+
+        std::vector<Block> blocks;
+        size_t blockSize;
+        size_t currentBlock = 0;
+        size_t offset = 0;
+        size_t used = 0;
+        size_t highWater = 0;
+    };
+
+    // RAII-возврат арены к отметке: память временных массивов одного draw переиспользуется следующим
+    class ArenaScope
+    {
+      public:
+        explicit ArenaScope( LinearArena &arena ) : arena( arena ), mark( arena.marker() )
+        {
+        }
+        ~ArenaScope()
+        {
+            arena.rewind( mark );
+        }
+        ArenaScope( const ArenaScope & ) = delete;
+        ArenaScope &operator=( const ArenaScope & ) = delete;
+
+      private:
+        LinearArena &arena;
+        LinearArena::Marker mark;
+    };
+
+    // Статистика использования кадровой памяти
+    struct FrameMemoryStats
+    {
+        size_t bytesUsed = 0;     // Занято сейчас (сумма по потокам)
+        size_t highWaterMark = 0; // Максимум занятой памяти с момента создания (сумма по потокам)
+        size_t capacity = 0;      // Зарезервировано блоками
+    };
+
+    // Кадровая арена устройства: по одной LinearArena на поток конвейера, сбрасывается в начале кадра
+    class FrameArena
+    {
+      public:
+        explicit FrameArena( size_t threadCount = 1, size_t blockSize = 1 << 20 );
+
+        void setThreadCount( size_t threadCount );
+        size_t threadCount() const
+        {
+            return arenas.size();
+        }
+
+        LinearArena &forThread( size_t threadIndex = 0 )
+        {
+            return arenas[threadIndex];
+        }
+
+        void reset();
+        FrameMemoryStats stats() const;
+
+      private:
+        std::vector<LinearArena> arenas;
+        size_t blockSize;
+    };
+} // namespace swr
@@ -0,0 +1,310 @@
+#include "swrBVH.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace swr
+{
+    namespace
+    {
+        constexpr uint32_t kMaxLeafSize = 4;
+        constexpr int kSahBins = 12;
+        constexpr float kRebuildThreshold = 1.5f; // Рост суммарной площади узлов после refit
+        constexpr int kMaxStackDepth = 64;
+        constexpr uint32_t kAllPlanes = ( 1u << 6 ) - 1;
+    } // unnamed namespace
+
+    AABB AABB::empty()
+    {
+        const float inf = std::numeric_limits<float>::max();
+        return { glm::vec3( inf ), glm::vec3( -inf ) };
+    }
+
+    void AABB::expand( const AABB &other )
+    {
+        min = glm::min( min, other.min );
+        max = glm::max( max, other.max );
+    }
+
+    void AABB::expand( const glm::vec3 &point )
+    {
+        min = glm::min( min, point );
+        max = glm::max( max, point );
+    }
+
+    float AABB::surfaceArea() const
+    {
+        const glm::vec3 e = glm::max( max - min, glm::vec3( 0.0f ) );
+        return 2.0f * ( e.x * e.y + e.y * e.z + e.z * e.x );
+    }
+
+    AABB transformBounds( const AABB &box, const glm::mat4 &m )
+    {
+        // Метод Арво: центр переносится матрицей, полуразмеры — модулем её линейной части
+        const glm::vec3 c = glm::vec3( m * glm::vec4( box.center(), 1.0f ) );
+        const glm::vec3 h = ( box.max - box.min ) * 0.5f;
+        glm::vec3 e( 0.0f );
+        for( int i = 0; i < 3; ++i )
+            e += glm::abs( glm::vec3( m[i] ) ) * h[i];
+        return { c - e, c + e };
+    }
+
+    Frustum Frustum::fromMatrix( const glm::mat4 &viewProj )
+    {
+        // Gribb-Hartmann: плоскости — суммы/разности строк матрицы (glm хранит столбцы)
+        auto row = [&]( int r ) { return glm::vec4( viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r] ); };
+        const glm::vec4 r0 = row( 0 ), r1 = row( 1 ), r2 = row( 2 ), r3 = row( 3 );
+        Frustum f;
+        f.planes[0] = r3 + r0; // left
+        f.planes[1] = r3 - r0; // right
+        f.planes[2] = r3 + r1; // bottom
+        f.planes[3] = r3 - r1; // top
+        f.planes[4] = r3 + r2; // near (z_ndc в [-1, 1])
+        f.planes[5] = r3 - r2; // far
+        for( glm::vec4 &p : f.planes )
+            p /= glm::length( glm::vec3( p ) );
+        return f;
+    }
+
+    void BVH::build( const std::vector<AABB> &bounds )
+    {
+        objectBounds = bounds;
+        const uint32_t n = static_cast<uint32_t>( bounds.size() );
+        objectIndices.resize( n );
+        centers.resize( n );
+        for( uint32_t i = 0; i < n; ++i )
+        {
+            objectIndices[i] = i;
+            centers[i] = bounds[i].center();
+        }
+
+        nodes.clear();
+        if( n == 0 )
+        {
+            builtSurfaceArea = 0.0f;
+            return;
+        }
+        nodes.reserve( 2 * static_cast<size_t>( n ) );
+        Node root;
+        root.first = 0;
+        root.count = n;
+        nodes.push_back( root );
+        subdivide( 0 );
+        refit();
+        builtSurfaceArea = totalSurfaceArea();
+    }
+
+    void BVH::subdivide( uint32_t nodeIndex )
+    {
+        const uint32_t first = nodes[nodeIndex].first;
+        const uint32_t count = nodes[nodeIndex].count;
+
+        AABB bounds = AABB::empty();
+        AABB centerBounds = AABB::empty();
+        for( uint32_t i = first; i < first + count; ++i )
+        {
+            bounds.expand( objectBounds[objectIndices[i]] );
+            centerBounds.expand( centers[objectIndices[i]] );
+        }
+        nodes[nodeIndex].bounds = bounds;
+        if( count <= kMaxLeafSize )
+            return;
+
+        // SAH с биннингом по центрам вдоль каждой оси
+        struct Bin
+        {
+            AABB bounds = AABB::empty();
+            uint32_t count = 0;
+        };
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        float bestSplit = 0.0f;
+        for( int axis = 0; axis < 3; ++axis )
+        {
+            const float lo = centerBounds.min[axis], hi = centerBounds.max[axis];
+            if( hi <= lo )
+                continue;
+            Bin bins[kSahBins];
+            const float scale = kSahBins / ( hi - lo );
+            for( uint32_t i = first; i < first + count; ++i )
+            {
+                const uint32_t obj = objectIndices[i];
+                const int b = std::min( kSahBins - 1, static_cast<int>( ( centers[obj][axis] - lo ) * scale ) );
+                bins[b].bounds.expand( objectBounds[obj] );
+                ++bins[b].count;
+            }
+            // Площади и количества слева/справа от каждой границы бинов
+            float leftArea[kSahBins - 1], rightArea[kSahBins - 1];
+            uint32_t leftCount[kSahBins - 1], rightCount[kSahBins - 1];
+            AABB leftBox = AABB::empty(), rightBox = AABB::empty();
+            uint32_t leftSum = 0, rightSum = 0;
+            for( int i = 0; i < kSahBins - 1; ++i )
+            {
+                leftSum += bins[i].count;
+                leftCount[i] = leftSum;
+                leftBox.expand( bins[i].bounds );
+                leftArea[i] = leftSum ? leftBox.surfaceArea() : 0.0f;
+                rightSum += bins[kSahBins - 1 - i].count;
+                rightCount[kSahBins - 2 - i] = rightSum;
+                rightBox.expand( bins[kSahBins - 1 - i].bounds );
+                rightArea[kSahBins - 2 - i] = rightSum ? rightBox.surfaceArea() : 0.0f;
+            }
+            for( int i = 0; i < kSahBins - 1; ++i )
+            {
+                const float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+                if( leftCount[i] && rightCount[i] && cost < bestCost )
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = lo + ( i + 1 ) / scale;
+                }
+            }
+        }
+
+        uint32_t mid = first;
+        if( bestAxis >= 0 && bestCost < count * bounds.surfaceArea() )
+        {
+            auto it = std::partition( objectIndices.begin() + first, objectIndices.begin() + first + count,
+                                      [&]( uint32_t obj ) { return centers[obj][bestAxis] < bestSplit; } );
+            mid = static_cast<uint32_t>( it - objectIndices.begin() );
+        }
+        if( mid == first || mid == first + count )
+        {
+            // Разбиение по SAH невыгодно или невозможно (совпадающие центры): делим пополам по числу
+            if( count <= kMaxLeafSize * 4 && bestAxis >= 0 )
+                return;
+            mid = first + count / 2;
+        }
+
+        const uint32_t left = static_cast<uint32_t>( nodes.size() );
+        Node leftNode, rightNode;
+        leftNode.first = first;
+        leftNode.count = mid - first;
+        rightNode.first = mid;
+        rightNode.count = first + count - mid;
+        nodes.push_back( leftNode );
+        nodes.push_back( rightNode );
+        nodes[nodeIndex].first = left;
+        nodes[nodeIndex].count = 0;
+        subdivide( left );
+        subdivide( left + 1 );
+    }
+
+    void BVH::update( uint32_t objectId, const AABB &bounds )
+    {
+        objectBounds[objectId] = bounds;
+    }
+
+    void BVH::refit()
+    {
+        for( size_t i = nodes.size(); i-- > 0; )
+        {
+            Node &node = nodes[i];
+            if( node.count > 0 )
+            {
+                AABB box = AABB::empty();
+                for( uint32_t k = node.first; k < node.first + node.count; ++k )
+                    box.expand( objectBounds[objectIndices[k]] );
+                node.bounds = box;
+            }
+            else
+            {
+                node.bounds = nodes[node.first].bounds;
+                node.bounds.expand( nodes[node.first + 1].bounds );
+            }
+        }
+    }
+
+    float BVH::totalSurfaceArea() const
+    {
+        float sum = 0.0f;
+        for( const Node &node : nodes )
+            sum += node.bounds.surfaceArea();
+        return sum;
+    }
+
+    bool BVH::needsRebuild() const
+    {
+        return !nodes.empty() && totalSurfaceArea() > builtSurfaceArea * kRebuildThreshold;
+    }
+
+    void BVH::cull( const Frustum &frustum, std::vector<uint32_t> &visible, BVHQueryStats *stats ) const
+    {
+        if( nodes.empty() )
+            return;
+
+        struct Entry
+        {
+            uint32_t node;
+            uint32_t planeMask; // Плоскости, относительно которых узел ещё не признан полностью внутри
+        };
+        Entry stack[kMaxStackDepth];
+        int top = 0;
+        stack[top++] = { 0, kAllPlanes };
+        size_t visited = 0, planeTests = 0;
+
+        while( top > 0 )
+        {
+            const Entry e = stack[--top];
+            const Node &node = nodes[e.node];
+            ++visited;
+
+            uint32_t mask = e.planeMask;
+            bool outside = false;
+            for( int p = 0; p < 6 && mask; ++p )
+            {
+                if( !( mask & ( 1u << p ) ) )
+                    continue;
+                ++planeTests;
+                const glm::vec4 &pl = frustum.planes[p];
+                // p-вершина (дальняя по нормали) и n-вершина (ближняя)
+                const glm::vec3 pv( pl.x >= 0.0f ? node.bounds.max.x : node.bounds.min.x,
+                                    pl.y >= 0.0f ? node.bounds.max.y : node.bounds.min.y,
+                                    pl.z >= 0.0f ? node.bounds.max.z : node.bounds.min.z );
+                if( glm::dot( glm::vec3( pl ), pv ) + pl.w < 0.0f )
+                {
+                    outside = true;
+                    break;
+                }
+                const glm::vec3 nv( pl.x >= 0.0f ? node.bounds.min.x : node.bounds.max.x,
+                                    pl.y >= 0.0f ? node.bounds.min.y : node.bounds.max.y,
+                                    pl.z >= 0.0f ? node.bounds.min.z : node.bounds.max.z );
+                if( glm::dot( glm::vec3( pl ), nv ) + pl.w >= 0.0f )
+                    mask &= ~( 1u << p );
+            }
+            if( outside )
+                continue;
+
+            if( node.count > 0 )
+            {
+                for( uint32_t k = node.first; k < node.first + node.count; ++k )
+                    visible.push_back( objectIndices[k] );
+                continue;
+            }
+            if( top + 2 > kMaxStackDepth )
+            {
+                // Слишком глубокое дерево (вырожденный ввод): поддерево считается видимым целиком
+                std::vector<uint32_t> pending{ node.first, node.first + 1 };
+                while( !pending.empty() )
+                {
+                    const Node &n = nodes[pending.back()];
+                    pending.pop_back();
+                    if( n.count > 0 )
+                        visible.insert( visible.end(), objectIndices.begin() + n.first,
+                                        objectIndices.begin() + n.first + n.count );
+                    else
+                        pending.insert( pending.end(), { n.first, n.first + 1 } );
+                }
+                continue;
+            }
+            stack[top++] = { node.first + 1, mask };
+            stack[top++] = { node.first, mask };
+        }
+
+        if( stats )
+        {
+            stats->nodesVisited += visited;
+            stats->planeTests += planeTests;
+        }
+    }
+} // namespace swr
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace swr
+{
+    // Ограничивающий параллелепипед, выровненный по осям
+    struct AABB
+    {
+        glm::vec3 min{ 0.0f };
+        glm::vec3 max{ 0.0f };
+
+        static AABB empty();
+        void expand( const AABB &other );
+        void expand( const glm::vec3 &point );
+        glm::vec3 center() const
+        {
+            return ( min + max ) * 0.5f;
+        }
+        float surfaceArea() const;
+    };
+
+    // Преобразование AABB матрицей (результат — AABB преобразованного параллелепипеда)
+    AABB transformBounds( const AABB &box, const glm::mat4 &m );
+
+    // Пирамида видимости: 6 плоскостей (нормали внутрь), извлечённые из матрицы view-projection
+    struct Frustum
+    {
+        glm::vec4 planes[6];
+
+        static Frustum fromMatrix( const glm::mat4 &viewProj );
+    };
+
+    struct BVHQueryStats
+    {
+        size_t nodesVisited = 0;
+        size_t planeTests = 0;
+    };
+
+    // BVH по ограничивающим объёмам объектов сцены.
+    // Строится по SAH с биннингом; для движущихся объектов достаточно update() + refit() (O(узлов)),
+    // полная перестройка нужна, когда после refit дерево заметно деградировало (needsRebuild()).
+    // Идентификатор объекта — индекс в массиве, переданном в build()
+    class BVH
+    {
+      public:
+        void build( const std::vector<AABB> &bounds );
+        // Новые границы объекта; узлы пересчитываются в refit()
+        void update( uint32_t objectId, const AABB &bounds );
+        void refit();
+        // Суммарная площадь поверхности узлов выросла относительно построения больше порога
+        bool needsRebuild() const;
+
+        // Объекты, AABB которых пересекает пирамиду видимости (консервативно), добавляются в visible.
+        // Поддеревья, целиком лежащие внутри плоскости, дальше против неё не проверяются
+        void cull( const Frustum &frustum, std::vector<uint32_t> &visible, BVHQueryStats *stats = nullptr ) const;
+
+        size_t objectCount() const
+        {
+            return objectBounds.size();
+        }
+        size_t nodeCount() const
+        {
+            return nodes.size();
+        }
+        const AABB &bounds( uint32_t objectId ) const
+        {
+            return objectBounds[objectId];
+        }
+
+      private:
+        struct Node
+        {
+            AABB bounds;
+            uint32_t first = 0; // Лист: первый объект в objectIndices; внутренний узел: левый потомок
+            uint32_t count = 0; // Лист: число объектов; 0 — внутренний узел (правый потомок = first + 1)
+        };
+
+        void subdivide( uint32_t nodeIndex );
+        float totalSurfaceArea() const;
+
+        std::vector<Node> nodes; // Потомки всегда после родителя — refit идёт в обратном порядке
+        std::vector<uint32_t> objectIndices;
+        std::vector<AABB> objectBounds;
+        std::vector<glm::vec3> centers; // Центры на момент построения
+        float builtSurfaceArea = 0.0f;
+    };
+} // namespace swr
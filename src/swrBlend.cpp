@@ -0,0 +1,204 @@
+#include "swrBlend.h"
+
+#include <array>
+#include <utility>
+
+#include "swrSimd.h"
+
+namespace swr
+{
+    namespace
+    {
+        constexpr uint32_t kFullCoverage = ( 1u << kBlendBlockSize ) - 1;
+
+#if SWR_SSE2
+        // glm::vec4 — 4 float подряд, один пиксель помещается ровно в один регистр SSE
+        using Pixel = __m128;
+
+        inline Pixel loadPixel( const glm::vec4 *p )
+        {
+            return _mm_loadu_ps( &p->x );
+        }
+        inline void storePixel( glm::vec4 *p, Pixel v )
+        {
+            _mm_storeu_ps( &p->x, v );
+        }
+
+        template <BlendMode Mode> inline Pixel blendPixel( Pixel s, Pixel d )
+        {
+            const Pixel one = _mm_set1_ps( 1.0f );
+            const Pixel a = _mm_shuffle_ps( s, s, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+            const Pixel invA = _mm_sub_ps( one, a );
+            switch( Mode )
+            {
+            case BlendMode::Opaque:
+                return s;
+            case BlendMode::Alpha: {
+                // Множитель src: (a, a, a, 1) — альфа цели накапливает покрытие
+                const Pixel alphaLane = _mm_castsi128_ps( _mm_set_epi32( -1, 0, 0, 0 ) );
+                const Pixel srcFactor = _mm_or_ps( _mm_andnot_ps( alphaLane, a ), _mm_and_ps( alphaLane, one ) );
+                return _mm_add_ps( _mm_mul_ps( s, srcFactor ), _mm_mul_ps( d, invA ) );
+            }
+            case BlendMode::Additive:
+                return _mm_add_ps( d, _mm_mul_ps( s, a ) );
+            case BlendMode::Premultiplied:
+                return _mm_add_ps( s, _mm_mul_ps( d, invA ) );
+            }
+            return s;
+        }
+
+        inline Pixel applyWriteMask( Pixel blended, Pixel d, Pixel laneMask )
+        {
+            return _mm_or_ps( _mm_and_ps( laneMask, blended ), _mm_andnot_ps( laneMask, d ) );
+        }
+
+        inline Pixel writeMaskToLanes( uint8_t writeMask )
+        {
+            return _mm_castsi128_ps( _mm_set_epi32( ( writeMask & ColorWriteAlpha ) ? -1 : 0,
+                                                    ( writeMask & ColorWriteBlue ) ? -1 : 0,
+                                                    ( writeMask & ColorWriteGreen ) ? -1 : 0,
+                                                    ( writeMask & ColorWriteRed ) ? -1 : 0 ) );
+        }
+#else
+        using Pixel = glm::vec4;
+
+        inline Pixel loadPixel( const glm::vec4 *p )
+        {
+            return *p;
+        }
+        inline void storePixel( glm::vec4 *p, const Pixel &v )
+        {
+            *p = v;
+        }
+
+        template <BlendMode Mode> inline Pixel blendPixel( const Pixel &s, const Pixel &d )
+        {
+            const float invA = 1.0f - s.a;
+            switch( Mode )
+            {
+            case BlendMode::Opaque:
+                return s;
+            case BlendMode::Alpha:
+                return glm::vec4( glm::vec3( s ) * s.a, s.a ) + d * invA;
+            case BlendMode::Additive:
+                return d + s * s.a;
+            case BlendMode::Premultiplied:
+                return s + d * invA;
+            }
+            return s;
+        }
+
+        inline Pixel applyWriteMask( const Pixel &blended, const Pixel &d, const Pixel &laneMask )
+        {
+            return glm::mix( d, blended, laneMask );
+        }
+
+        inline Pixel writeMaskToLanes( uint8_t writeMask )
+        {
+            auto lane = [writeMask]( uint8_t bit ) { return ( writeMask & bit ) ? 1.0f : 0.0f; };
+            return glm::vec4( lane( ColorWriteRed ), lane( ColorWriteGreen ), lane( ColorWriteBlue ),
+                              lane( ColorWriteAlpha ) );
+        }
+#endif
+
+        // Непрозрачная запись всех каналов: цель не читается
+        void storeOpaque( glm::vec4 *dst, const glm::vec4 *src, uint32_t coverage )
+        {
+            if( coverage == kFullCoverage )
+            {
+                for( int i = 0; i < kBlendBlockSize; ++i )
+                    dst[i] = src[i];
+                return;
+            }
+            for( int i = 0; i < kBlendBlockSize; ++i )
+            {
+                if( coverage & ( 1u << i ) )
+                    dst[i] = src[i];
+            }
+        }
+
+        // Маска каналов — параметр шаблона, чтобы полная маска не стоила лишних операций
+        template <BlendMode Mode, uint8_t WriteMask>
+        void blendBlock( glm::vec4 *dst, const glm::vec4 *src, uint32_t coverage )
+        {
+            const Pixel laneMask = writeMaskToLanes( WriteMask );
+            auto blendOne = [&]( int i ) {
+                const Pixel d = loadPixel( dst + i );
+                Pixel r = blendPixel<Mode>( loadPixel( src + i ), d );
+                if( WriteMask != ColorWriteAll )
+                    r = applyWriteMask( r, d, laneMask );
+                storePixel( dst + i, r );
+            };
+            if( coverage == kFullCoverage )
+            {
+                // Полный блок без ветвлений
+                for( int i = 0; i < kBlendBlockSize; ++i )
+                    blendOne( i );
+                return;
+            }
+            for( int i = 0; i < kBlendBlockSize; ++i )
+            {
+                if( coverage & ( 1u << i ) )
+                    blendOne( i );
+            }
+        }
+
+        // Таблица ядер по всем 16 маскам каналов для режима Mode
+        template <BlendMode Mode, size_t... M>
+        constexpr std::array<BlendKernel, 16> makeKernelTable( std::index_sequence<M...> )
+        {
+            return { { &blendBlock<Mode, static_cast<uint8_t>( M )>... } };
+        }
+
+        template <BlendMode Mode> BlendKernel selectMasked( uint8_t writeMask )
+        {
+            static constexpr auto table = makeKernelTable<Mode>( std::make_index_sequence<16>{} );
+            return table[writeMask & ColorWriteAll];
+        }
+
+        void discardAll( glm::vec4 *, const glm::vec4 *, uint32_t )
+        {
+        }
+    } // unnamed namespace
+
+    BlendKernel selectBlendKernel( const BlendState &state )
+    {
+        if( ( state.writeMask & ColorWriteAll ) == 0 )
+            return &discardAll;
+        switch( state.mode )
+        {
+        case BlendMode::Opaque:
+            if( ( state.writeMask & ColorWriteAll ) == ColorWriteAll )
+                return &storeOpaque;
+            return selectMasked<BlendMode::Opaque>( state.writeMask );
+        case BlendMode::Alpha:
+            return selectMasked<BlendMode::Alpha>( state.writeMask );
+        case BlendMode::Additive:
+            return selectMasked<BlendMode::Additive>( state.writeMask );
+        case BlendMode::Premultiplied:
+            return selectMasked<BlendMode::Premultiplied>( state.writeMask );
+        }
+        return &storeOpaque;
+    }
+
+    bool blendReadsTarget( const BlendState &state )
+    {
+        return state.mode != BlendMode::Opaque || ( state.writeMask & ColorWriteAll ) != ColorWriteAll;
+    }
+
+    void blendBlockHalf( BlendKernel kernel, bool readsTarget, Half4 *dst, const glm::vec4 *src, uint32_t coverage )
+    {
+        glm::vec4 block[kBlendBlockSize];
+        for( int i = 0; readsTarget && i < kBlendBlockSize; ++i )
+        {
+            if( coverage & ( 1u << i ) )
+                block[i] = unpackHalf4( dst[i] );
+        }
+        kernel( block, src, coverage );
+        for( int i = 0; i < kBlendBlockSize; ++i )
+        {
+            if( coverage & ( 1u << i ) )
+                dst[i] = packHalf4( block[i] );
+        }
+    }
+} // namespace swr
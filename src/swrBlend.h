@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "swrHalf.h"
+
+namespace swr
+{
+    // Режим смешивания цвета пикселя (src — выход PS, dst — значение в цели)
+    enum class BlendMode
+    {
+        Opaque,        // dst = src
+        Alpha,         // rgb = src.rgb * src.a + dst.rgb * (1 - src.a), a = src.a + dst.a * (1 - src.a)
+        Additive,      // dst = dst + src * src.a
+        Premultiplied, // dst = src + dst * (1 - src.a), цвет src уже умножен на альфу
+    };
+
+    // Маска записи каналов (битовая маска)
+    enum ColorWriteMask : uint8_t
+    {
+        ColorWriteRed = 1u << 0,
+        ColorWriteGreen = 1u << 1,
+        ColorWriteBlue = 1u << 2,
+        ColorWriteAlpha = 1u << 3,
+        ColorWriteAll = ColorWriteRed | ColorWriteGreen | ColorWriteBlue | ColorWriteAlpha,
+    };
+
+    struct BlendState
+    {
+        BlendMode mode = BlendMode::Opaque;
+        uint8_t writeMask = ColorWriteAll;
+    };
+
+    // Растеризатор передаёт цвет блоками по kBlendBlockSize соседних пикселей строки
+    constexpr int kBlendBlockSize = 4;
+
+    // Ядро смешивания блока: dst — kBlendBlockSize пикселей цели, src — выход PS,
+    // coverage — биты пикселей блока, прошедших тест глубины. Пиксели вне маски не читаются и не пишутся,
+    // поэтому неполный блок у правого края цели безопасен
+    using BlendKernel = void ( * )( glm::vec4 *dst, const glm::vec4 *src, uint32_t coverage );
+
+    // Выбор ядра под состояние; делается один раз при установке состояния, а не на каждый пиксель.
+    // Opaque с полной маской записи — просто запись без чтения цели
+    BlendKernel selectBlendKernel( const BlendState &state );
+
+    // false — ядро состояния только пишет цель (Opaque с полной маской записи)
+    bool blendReadsTarget( const BlendState &state );
+
+    // Смешивание блока в цели RGBA16F: покрытые пиксели распаковываются во float (если ядро читает цель),
+    // смешиваются ядром kernel и упаковываются обратно
+    void blendBlockHalf( BlendKernel kernel, bool readsTarget, Half4 *dst, const glm::vec4 *src, uint32_t coverage );
+} // namespace swr
@@ -0,0 +1,288 @@
+#include "swrBlockCompression.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "swrDevice.h"
+
+namespace swr
+{
+    namespace
+    {
+        // Палитра цветового блока: 4 цвета RGBA8
+        using ColorPalette = uint8_t[4][4];
+
+        uint16_t readU16( const uint8_t *p )
+        {
+            return static_cast<uint16_t>( p[0] | ( p[1] << 8 ) );
+        }
+
+        void writeU16( uint8_t *p, uint16_t v )
+        {
+            p[0] = static_cast<uint8_t>( v );
+            p[1] = static_cast<uint8_t>( v >> 8 );
+        }
+
+        // RGB565 -> RGB8 с повтором старших бит в младших (0x1F -> 0xFF)
+        void expand565( uint16_t c, uint8_t *rgb )
+        {
+            const uint32_t r = ( c >> 11 ) & 31, g = ( c >> 5 ) & 63, b = c & 31;
+            rgb[0] = static_cast<uint8_t>( ( r << 3 ) | ( r >> 2 ) );
+            rgb[1] = static_cast<uint8_t>( ( g << 2 ) | ( g >> 4 ) );
+            rgb[2] = static_cast<uint8_t>( ( b << 3 ) | ( b >> 2 ) );
+        }
+
+        uint16_t pack565( int r, int g, int b )
+        {
+            return static_cast<uint16_t>( ( ( r * 31 + 127 ) / 255 ) << 11 | ( ( g * 63 + 127 ) / 255 ) << 5 |
+                                          ( ( b * 31 + 127 ) / 255 ) );
+        }
+
+        // fourColor — режим 4 цветов; в BC1 он задаётся порядком концов (c0 > c1), в BC3 действует всегда
+        void buildColorPalette( uint16_t c0, uint16_t c1, bool fourColor, ColorPalette pal )
+        {
+            expand565( c0, pal[0] );
+            expand565( c1, pal[1] );
+            pal[0][3] = pal[1][3] = 255;
+            for( int c = 0; c < 3; ++c )
+            {
+                const int a = pal[0][c], b = pal[1][c];
+                if( fourColor )
+                {
+                    pal[2][c] = static_cast<uint8_t>( ( 2 * a + b + 1 ) / 3 );
+                    pal[3][c] = static_cast<uint8_t>( ( a + 2 * b + 1 ) / 3 );
+                }
+                else
+                {
+                    pal[2][c] = static_cast<uint8_t>( ( a + b + 1 ) / 2 );
+                    pal[3][c] = 0;
+                }
+            }
+            pal[2][3] = 255;
+            pal[3][3] = fourColor ? 255 : 0;
+        }
+
+        void buildAlphaPalette( uint8_t a0, uint8_t a1, uint8_t pal[8] )
+        {
+            pal[0] = a0;
+            pal[1] = a1;
+            if( a0 > a1 )
+            {
+                for( int k = 1; k <= 6; ++k )
+                    pal[k + 1] = static_cast<uint8_t>( ( ( 7 - k ) * a0 + k * a1 + 3 ) / 7 );
+            }
+            else
+            {
+                for( int k = 1; k <= 4; ++k )
+                    pal[k + 1] = static_cast<uint8_t>( ( ( 5 - k ) * a0 + k * a1 + 2 ) / 5 );
+                pal[6] = 0;
+                pal[7] = 255;
+            }
+        }
+
+        void decodeColorBlock( const uint8_t *block, bool forceFourColor, uint8_t *texels )
+        {
+            const uint16_t c0 = readU16( block ), c1 = readU16( block + 2 );
+            ColorPalette pal;
+            buildColorPalette( c0, c1, forceFourColor || c0 > c1, pal );
+            uint32_t indices;
+            std::memcpy( &indices, block + 4, 4 ); // Little-endian, как и сам формат
+            for( size_t i = 0; i < kBlockTexels; ++i, indices >>= 2 )
+                std::memcpy( texels + i * 4, pal[indices & 3], 4 );
+        }
+
+        int colorDistance( const uint8_t *a, const uint8_t *b )
+        {
+            const int dr = a[0] - b[0], dg = a[1] - b[1], db = a[2] - b[2];
+            return dr * dr + dg * dg + db * db;
+        }
+
+        // allowTransparent — BC1 с прозрачными текселями (режим 3 цветов, индекс 3)
+        void encodeColorBlock( const uint8_t *texels, bool allowTransparent, uint8_t *block )
+        {
+            int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+            bool transparent = false, anyOpaque = false;
+            for( size_t i = 0; i < kBlockTexels; ++i )
+            {
+                const uint8_t *t = texels + i * 4;
+                if( allowTransparent && t[3] < 128 )
+                {
+                    transparent = true;
+                    continue;
+                }
+                anyOpaque = true;
+                for( int c = 0; c < 3; ++c )
+                {
+                    lo[c] = std::min<int>( lo[c], t[c] );
+                    hi[c] = std::max<int>( hi[c], t[c] );
+                }
+            }
+            if( !anyOpaque )
+            {
+                // Весь блок прозрачный: c0 == c1 (режим 3 цветов), все индексы 3
+                std::memset( block, 0, 4 );
+                std::memset( block + 4, 0xFF, 4 );
+                return;
+            }
+
+            // Сжатие прямоугольника внутрь уменьшает ошибку: крайние цвета редко лежат точно в углах
+            for( int c = 0; c < 3; ++c )
+            {
+                const int inset = ( hi[c] - lo[c] ) >> 4;
+                lo[c] += inset;
+                hi[c] -= inset;
+            }
+            uint16_t c0 = pack565( hi[0], hi[1], hi[2] );
+            uint16_t c1 = pack565( lo[0], lo[1], lo[2] );
+            // Порядок концов выбирает режим BC1: c0 > c1 — 4 цвета, иначе 3 цвета + прозрачный
+            if( transparent ? c0 > c1 : c0 < c1 )
+                std::swap( c0, c1 );
+            const bool fourColor = !transparent && c0 != c1;
+
+            ColorPalette pal;
+            buildColorPalette( c0, c1, fourColor || !allowTransparent, pal );
+            const int paletteSize = fourColor || !allowTransparent ? 4 : 3;
+            uint32_t indices = 0;
+            for( size_t i = 0; i < kBlockTexels; ++i )
+            {
+                const uint8_t *t = texels + i * 4;
+                uint32_t best = 3;
+                if( !( allowTransparent && t[3] < 128 ) )
+                {
+                    int bestDist = colorDistance( t, pal[0] );
+                    best = 0;
+                    for( int k = 1; k < paletteSize; ++k )
+                    {
+                        const int d = colorDistance( t, pal[k] );
+                        if( d < bestDist )
+                        {
+                            bestDist = d;
+                            best = static_cast<uint32_t>( k );
+                        }
+                    }
+                }
+                indices |= best << ( i * 2 );
+            }
+            writeU16( block, c0 );
+            writeU16( block + 2, c1 );
+            std::memcpy( block + 4, &indices, 4 );
+        }
+
+        void encodeAlphaBlock( const uint8_t *texels, uint8_t *block )
+        {
+            uint8_t lo = 255, hi = 0;
+            for( size_t i = 0; i < kBlockTexels; ++i )
+            {
+                lo = std::min( lo, texels[i * 4 + 3] );
+                hi = std::max( hi, texels[i * 4 + 3] );
+            }
+            // a0 > a1 — режим 8 значений; при равных концах все тексели точно попадают в индекс 0
+            uint8_t pal[8];
+            buildAlphaPalette( hi, lo, pal );
+            uint64_t indices = 0;
+            for( size_t i = 0; i < kBlockTexels; ++i )
+            {
+                const int a = texels[i * 4 + 3];
+                uint64_t best = 0;
+                int bestDist = 256;
+                for( int k = 0; k < 8; ++k )
+                {
+                    const int d = std::abs( a - pal[k] );
+                    if( d < bestDist )
+                    {
+                        bestDist = d;
+                        best = static_cast<uint64_t>( k );
+                    }
+                }
+                indices |= best << ( i * 3 );
+            }
+            block[0] = hi;
+            block[1] = lo;
+            for( int b = 0; b < 6; ++b )
+                block[2 + b] = static_cast<uint8_t>( indices >> ( b * 8 ) );
+        }
+    } // unnamed namespace
+
+    bool isBlockCompressed( BufferFormat format )
+    {
+        return blockBytes( format ) != 0;
+    }
+
+    size_t blockBytes( BufferFormat format )
+    {
+        switch( format )
+        {
+        case BufferFormat::BC1_UNORM:
+            return kBC1BlockBytes;
+        case BufferFormat::BC3_UNORM:
+            return kBC3BlockBytes;
+        default:
+            return 0;
+        }
+    }
+
+    void decodeBC1Block( const uint8_t *block, uint8_t *texels )
+    {
+        decodeColorBlock( block, false, texels );
+    }
+
+    void decodeBC3Block( const uint8_t *block, uint8_t *texels )
+    {
+        decodeColorBlock( block + 8, true, texels );
+        uint8_t pal[8];
+        buildAlphaPalette( block[0], block[1], pal );
+        uint64_t indices = 0;
+        for( int b = 0; b < 6; ++b )
+            indices |= static_cast<uint64_t>( block[2 + b] ) << ( b * 8 );
+        for( size_t i = 0; i < kBlockTexels; ++i, indices >>= 3 )
+            texels[i * 4 + 3] = pal[indices & 7];
+    }
+
+    void encodeBC1Block( const uint8_t *texels, uint8_t *block )
+    {
+        encodeColorBlock( texels, true, block );
+    }
+
+    void encodeBC3Block( const uint8_t *texels, uint8_t *block )
+    {
+        encodeAlphaBlock( texels, block );
+        encodeColorBlock( texels, false, block + 8 );
+    }
+
+    std::vector<uint8_t> compressImage( BufferFormat format, const uint8_t *rgba, size_t width, size_t height,
+                                        size_t rowPitch )
+    {
+        const size_t bytes = blockBytes( format );
+        if( bytes == 0 )
+            throw std::invalid_argument( "compressImage: format is not block-compressed" );
+        if( rowPitch == 0 )
+            rowPitch = width * 4;
+        const size_t blocksX = ( width + kBlockDim - 1 ) / kBlockDim;
+        const size_t blocksY = ( height + kBlockDim - 1 ) / kBlockDim;
+        std::vector<uint8_t> out( blocksX * blocksY * bytes );
+        uint8_t texels[kBlockTexels * 4];
+        for( size_t by = 0; by < blocksY; ++by )
+        {
+            for( size_t bx = 0; bx < blocksX; ++bx )
+            {
+                for( size_t ty = 0; ty < kBlockDim; ++ty )
+                {
+                    const size_t y = std::min( by * kBlockDim + ty, height - 1 );
+                    for( size_t tx = 0; tx < kBlockDim; ++tx )
+                    {
+                        const size_t x = std::min( bx * kBlockDim + tx, width - 1 );
+                        std::memcpy( texels + ( ty * kBlockDim + tx ) * 4, rgba + y * rowPitch + x * 4, 4 );
+                    }
+                }
+                uint8_t *block = out.data() + ( by * blocksX + bx ) * bytes;
+                if( format == BufferFormat::BC1_UNORM )
+                    encodeBC1Block( texels, block );
+                else
+                    encodeBC3Block( texels, block );
+            }
+        }
+        return out;
+    }
+} // namespace swr
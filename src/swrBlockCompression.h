@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace swr
+{
+    // Forward decl BufferFormat (определён в swrDevice.h)
+    enum class BufferFormat;
+
+    // Блочное сжатие текстур: блок 4x4 текселя фиксированного размера.
+    //   BC1 (DXT1) — 8 байт: два цвета RGB565 и 2-битные индексы (4 цвета, либо 3 + прозрачный чёрный);
+    //   BC3 (DXT5) — 16 байт: блок альфы (два значения и 3-битные индексы) + цветовой блок BC1.
+    // Относительно RGBA8 это 8x и 4x экономии памяти
+    constexpr size_t kBlockDim = 4;
+    constexpr size_t kBlockTexels = kBlockDim * kBlockDim;
+    constexpr size_t kBC1BlockBytes = 8;
+    constexpr size_t kBC3BlockBytes = 16;
+
+    bool isBlockCompressed( BufferFormat format );
+    // Размер блока в байтах (0 для несжатых форматов)
+    size_t blockBytes( BufferFormat format );
+
+    // Распаковка блока в 16 текселей RGBA8 (построчно, 64 байта)
+    void decodeBC1Block( const uint8_t *block, uint8_t *texels );
+    void decodeBC3Block( const uint8_t *block, uint8_t *texels );
+
+    // Быстрое сжатие 16 текселей RGBA8: концы отрезка — ограничивающий прямоугольник цветов, сжатый
+    // внутрь на 1/16 диапазона, индексы — ближайший цвет палитры. В BC1 тексели с альфой < 128 становятся
+    // прозрачными (режим 3 цветов)
+    void encodeBC1Block( const uint8_t *texels, uint8_t *block );
+    void encodeBC3Block( const uint8_t *texels, uint8_t *block );
+
+    // Сжатие изображения RGBA8 (rowPitch в байтах, 0 — плотная упаковка) в строки блоков формата format.
+    // Неполные блоки у краёв дополняются повтором крайних текселей
+    std::vector<uint8_t> compressImage( BufferFormat format, const uint8_t *rgba, size_t width, size_t height,
+                                        size_t rowPitch = 0 );
+} // namespace swr
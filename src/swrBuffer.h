@@ -3,8 +3,9 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <new>
 #include <stdexcept>
-#include <vector>
 
 namespace swr
 {
@@ -13,13 +14,33 @@ namespace swr
     // Forward decl device class
     class Device;
 
+    // Параметры создания буфера
+    struct BufferOptions
+    {
+        size_t alignment = 16;      // Выравнивание начала данных (степень двойки); 64 — под выровненные SIMD-загрузки
+        bool zeroInitialize = true; // false — память не обнуляется (если буфер всё равно будет перезаписан)
+    };
+
+    // Режим отображения буфера в map()
+    enum class MapMode
+    {
+        Read,      // Только чтение, содержимое не считается изменённым
+        Write,     // Запись, содержимое считается изменённым при unmap()
+        ReadWrite, // Чтение и запись, содержимое считается изменённым при unmap()
+    };
+
     // Буфер ресурсов (вершинный буфер, индексный буфер и т.д.)
     class Buffer
     {
         // Поскольку созданием буфера занимается только устройство, конструктор приватный
       private:
-        Buffer( size_t elementSize, size_t elementCount, BufferFormat fmt )
-            : elemSize( elementSize ), elemCount( elementCount ), dataVec( elementSize * elementCount ), format_( fmt )
+        // Буфер поверх готовой памяти без копирования: блок пула устройства (его возвращает делетер буфера),
+        // mmap'нутый файл (readOnly) или память вызывающего.
+        // backing держит память живой, пока жив буфер (может быть пустым, если памятью владеет не буфер)
+        Buffer( size_t elementSize, size_t elementCount, BufferFormat fmt, void *external,
+                std::shared_ptr<const void> backing, bool readOnly )
+            : elemSize( elementSize ), elemCount( elementCount ), ptr( static_cast<uint8_t *>( external ) ),
+              backing( std::move( backing ) ), format_( fmt ), readOnly( readOnly )
         {
         }
         friend class Device; // Разрешить Device создавать Buffer
@@ -27,12 +48,12 @@ namespace swr
       public:
         void *data()
         {
-            return dataVec.data();
+            return ptr;
         }
 
         const void *data() const
         {
-            return dataVec.data();
+            return ptr;
         }
 
         size_t elementSize() const
@@ -45,25 +66,93 @@ namespace swr
             return elemCount;
         }
 
+        size_t sizeInBytes() const
+        {
+            return elemSize * elemCount;
+        }
+
         BufferFormat format() const
         {
             return format_;
         }
 
+        // true, если буфер ссылается на внешнюю память только для чтения (uploadData/map на запись запрещены)
+        bool isReadOnly() const
+        {
+            return readOnly;
+        }
+
+        // Проверка выравнивания начала данных (например, isAligned(64) перед выровненными SIMD-загрузками)
+        bool isAligned( size_t alignment ) const
+        {
+            return reinterpret_cast<uintptr_t>( ptr ) % alignment == 0;
+        }
+
         void uploadData( const void *srcData, size_t count, size_t offset = 0 )
         {
+            if( readOnly )
+            {
+                throw std::logic_error( "Buffer::uploadData on read-only buffer" );
+            }
             if( offset + count > elemCount )
             {
                 // Выход за пределы буфера
                 throw std::out_of_range( "Buffer::uploadData out of range" );
             }
-            std::memcpy( dataVec.data() + offset * elemSize, srcData, count * elemSize );
+            std::memcpy( ptr + offset * elemSize, srcData, count * elemSize );
+            markDirty();
+        }
+
+        // Прямой доступ к диапазону элементов без копирования. Изменение регистрируется при unmap()
+        void *map( size_t offset, size_t count, MapMode mode = MapMode::Write )
+        {
+            if( mapped )
+                throw std::logic_error( "Buffer::map: buffer is already mapped" );
+            if( readOnly && mode != MapMode::Read )
+                throw std::logic_error( "Buffer::map for writing on read-only buffer" );
+            if( offset + count > elemCount )
+                throw std::out_of_range( "Buffer::map out of range" );
+            mapped = true;
+            mappedMode = mode;
+            return ptr + offset * elemSize;
+        }
+
+        void unmap()
+        {
+            if( !mapped )
+                throw std::logic_error( "Buffer::unmap: buffer is not mapped" );
+            mapped = false;
+            if( mappedMode != MapMode::Read )
+                markDirty();
+        }
+
+        bool isMapped() const
+        {
+            return mapped;
+        }
+
+        // Счётчик изменений содержимого; растёт при каждой записи через uploadData/unmap
+        uint64_t version() const
+        {
+            return contentVersion;
+        }
+
+        // Явная регистрация изменения (для записи через data() в обход map/uploadData)
+        void markDirty()
+        {
+            ++contentVersion;
         }
 
       private:
         size_t elemSize;
         size_t elemCount;
-        std::vector<uint8_t> dataVec;
+        uint8_t *ptr = nullptr;              // Начало данных
+        std::shared_ptr<const void> backing; // Владелец памяти (собственная аллокация или внешний владелец)
         BufferFormat format_;
+        bool readOnly = false;
+
+        bool mapped = false;
+        MapMode mappedMode = MapMode::Read;
+        uint64_t contentVersion = 0;
     };
-} // namespace swr
\ No newline at end of file
+} // namespace swr
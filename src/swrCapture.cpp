@@ -0,0 +1,897 @@
+#include "swrCapture.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+#include "swrMappedFile.h"
+
+namespace swr
+{
+    namespace
+    {
+        constexpr size_t kNoCommand = SIZE_MAX;
+
+        // Разбор тела команды: выход за конец — ошибка формата
+        struct CaptureReader
+        {
+            const uint8_t *pos;
+            const uint8_t *end;
+            const std::string &path;
+
+            [[noreturn]] void fail( const char *what ) const
+            {
+                throw std::runtime_error( "Capture " + path + ": " + what );
+            }
+            const uint8_t *bytes( size_t size )
+            {
+                if( static_cast<size_t>( end - pos ) < size )
+                    fail( "truncated" );
+                const uint8_t *p = pos;
+                pos += size;
+                return p;
+            }
+            template <typename T> T read()
+            {
+                T value;
+                std::memcpy( &value, bytes( sizeof( T ) ), sizeof( T ) );
+                return value;
+            }
+            std::string string()
+            {
+                const uint32_t size = read<uint32_t>();
+                const uint8_t *p = bytes( size );
+                return std::string( reinterpret_cast<const char *>( p ), size );
+            }
+            // Число элементов массива, каждый из которых занимает в теле не меньше minSize байт: испорченный
+            // счётчик отсекается до выделения памяти под массив
+            uint32_t count( size_t minSize )
+            {
+                const uint32_t value = read<uint32_t>();
+                if( value > static_cast<size_t>( end - pos ) / minSize )
+                    fail( "bad element count" );
+                return value;
+            }
+        };
+
+        // Предел стороны текстуры и кадра (как в D3D11): больше — испорченный файл, а не огромное выделение
+        constexpr uint64_t kMaxTextureDim = 16384;
+
+        bool isTextureFormat( BufferFormat format )
+        {
+            switch( format )
+            {
+            case BufferFormat::R8G8B8A8_UNORM:
+            case BufferFormat::D32_FLOAT:
+            case BufferFormat::R32G32B32A32_FLOAT:
+            case BufferFormat::R16G16B16A16_FLOAT:
+            case BufferFormat::BC1_UNORM:
+            case BufferFormat::BC3_UNORM:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // Наименьший и наибольший индекс, которые выберет draw: count индексов с start, неполный последний
+        // треугольник не выбирается (как в Device::drawIndices). false — пустой диапазон
+        bool indexRange( const std::vector<uint8_t> &data, uint64_t indexSize, uint64_t start, uint64_t count,
+                         uint32_t &minIndex, uint32_t &maxIndex )
+        {
+            count -= count % 3;
+            if( count == 0 )
+                return false;
+            minIndex = UINT32_MAX;
+            maxIndex = 0;
+            const uint8_t *bytes = data.data() + start * indexSize;
+            for( uint64_t i = 0; i < count; ++i )
+            {
+                uint32_t index = 0;
+                if( indexSize == 2 )
+                {
+                    uint16_t value;
+                    std::memcpy( &value, bytes + i * 2, sizeof( value ) );
+                    index = value;
+                }
+                else
+                {
+                    std::memcpy( &index, bytes + i * 4, sizeof( index ) );
+                }
+                minIndex = std::min( minIndex, index );
+                maxIndex = std::max( maxIndex, index );
+            }
+            return true;
+        }
+
+        bool isRenderTarget( const TextureDesc &desc )
+        {
+            return ( desc.bindFlags & ( TextureBindRenderTarget | TextureBindDepthStencil ) ) != 0;
+        }
+
+        bool sameViewport( const Viewport &a, const Viewport &b )
+        {
+            return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height &&
+                   a.minDepth == b.minDepth && a.maxDepth == b.maxDepth;
+        }
+    } // unnamed namespace
+
+    CaptureWriter::CaptureWriter( const CaptureFileHeader &header ) : header( header ), commandStart( kNoCommand )
+    {
+        this->header.commandCount = 0;
+        this->header.drawCount = 0;
+    }
+
+    uint32_t CaptureWriter::buffer( const std::shared_ptr<Buffer> &buffer )
+    {
+        if( !buffer )
+            return 0;
+        auto it = buffers.find( buffer.get() );
+        if( it == buffers.end() )
+        {
+            const uint32_t id = nextId++;
+            beginCommand( CaptureCommand::CreateBuffer );
+            write( id );
+            write( static_cast<uint64_t>( buffer->elementSize() ) );
+            write( static_cast<uint64_t>( buffer->elementCount() ) );
+            write( static_cast<uint32_t>( buffer->format() ) );
+            endCommand();
+            it = buffers.emplace( buffer.get(), BufferEntry{ id, buffer, {} } ).first;
+        }
+
+        // Запись в обход uploadData/map версию не меняет, поэтому содержимое сравнивается с записанной копией
+        BufferEntry &entry = it->second;
+        const Buffer &source = *buffer;
+        const uint8_t *bytes = static_cast<const uint8_t *>( source.data() );
+        const size_t size = source.sizeInBytes();
+        if( entry.written.size() == size && ( size == 0 || std::memcmp( entry.written.data(), bytes, size ) == 0 ) )
+            return entry.id;
+        entry.written.assign( bytes, bytes + size );
+        beginCommand( CaptureCommand::BufferData );
+        write( entry.id );
+        writeBytes( bytes, size );
+        endCommand();
+        return entry.id;
+    }
+
+    uint32_t CaptureWriter::texture( const std::shared_ptr<Texture2D> &texture )
+    {
+        if( !texture )
+            return 0;
+        auto it = textures.find( texture.get() );
+        if( it == textures.end() )
+        {
+            const uint32_t id = nextId++;
+            const TextureDesc &desc = texture->desc();
+            beginCommand( CaptureCommand::CreateTexture );
+            write( id );
+            write( static_cast<uint64_t>( desc.width ) );
+            write( static_cast<uint64_t>( desc.height ) );
+            write( desc.mipLevels );
+            write( static_cast<uint32_t>( desc.format ) );
+            write( desc.bindFlags );
+            write( desc.sampleCount );
+            endCommand();
+            it = textures.emplace( texture.get(), TextureEntry{ id, texture, UINT64_MAX } ).first;
+        }
+
+        TextureEntry &entry = it->second;
+        if( isRenderTarget( texture->desc() ) || entry.version == texture->version() )
+            return entry.id;
+        entry.version = texture->version();
+        beginCommand( CaptureCommand::TextureData );
+        write( entry.id );
+        writeBytes( texture->rawData(), texture->memorySize() );
+        endCommand();
+        return entry.id;
+    }
+
+    uint32_t CaptureWriter::inputLayout( const std::shared_ptr<InputLayout> &layout )
+    {
+        if( !layout )
+            return 0;
+        auto it = layouts.find( layout.get() );
+        if( it != layouts.end() )
+            return it->second.id;
+
+        const uint32_t id = nextId++;
+        const InputLayoutDesc &desc = layout->desc();
+        beginCommand( CaptureCommand::CreateInputLayout );
+        write( id );
+        write( static_cast<uint64_t>( desc.stride ) );
+        write( static_cast<uint32_t>( desc.elements.size() ) );
+        for( const InputElementDesc &e : desc.elements )
+        {
+            write( static_cast<uint32_t>( e.semantic ) );
+            write( static_cast<uint32_t>( e.format ) );
+            write( static_cast<uint64_t>( e.offset ) );
+        }
+        endCommand();
+        layouts.emplace( layout.get(), LayoutEntry{ id, layout } );
+        return id;
+    }
+
+    void CaptureWriter::beginCommand( CaptureCommand type )
+    {
+        if( commandStart != kNoCommand )
+        {
+            assert( false && "CaptureWriter::beginCommand: previous command is not finished" );
+            endCommand();
+        }
+        commandStart = stream.size();
+        const CaptureCommandHeader command{ static_cast<uint32_t>( type ), 0 };
+        writeBytes( &command, sizeof( command ) );
+        ++header.commandCount;
+        if( type == CaptureCommand::Draw )
+            ++header.drawCount;
+    }
+
+    void CaptureWriter::endCommand()
+    {
+        if( commandStart == kNoCommand )
+        {
+            assert( false && "CaptureWriter::endCommand without beginCommand" );
+            return;
+        }
+        const size_t size = stream.size() - commandStart - sizeof( CaptureCommandHeader );
+        if( size > UINT32_MAX )
+            throw std::length_error( "CaptureWriter: command is larger than 4 GB" );
+        const uint32_t size32 = static_cast<uint32_t>( size );
+        std::memcpy( stream.data() + commandStart + offsetof( CaptureCommandHeader, size ), &size32, sizeof( size32 ) );
+        commandStart = kNoCommand;
+    }
+
+    void CaptureWriter::writeBytes( const void *data, size_t size )
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>( data );
+        stream.insert( stream.end(), bytes, bytes + size );
+    }
+
+    void CaptureWriter::writeString( const std::string &value )
+    {
+        write( static_cast<uint32_t>( value.size() ) );
+        writeBytes( value.data(), value.size() );
+    }
+
+    void CaptureWriter::finish( const std::string &path )
+    {
+        std::ofstream out( path, std::ios::binary | std::ios::trunc );
+        if( !out )
+            throw std::runtime_error( "Capture " + path + ": cannot open for writing" );
+        out.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+        out.write( reinterpret_cast<const char *>( stream.data() ), static_cast<std::streamsize>( stream.size() ) );
+        if( !out )
+            throw std::runtime_error( "Capture " + path + ": write failed" );
+    }
+
+    // Захват на стороне устройства. Номера ресурсов получаются до beginCommand: создание ресурса и его
+    // содержимое — отдельные команды, они не могут попасть внутрь тела clear или draw
+
+    void Device::captureFrame( const std::string &path )
+    {
+        capturePath = path;
+    }
+
+    void Device::beginCapture()
+    {
+        CaptureFileHeader header{};
+        header.magic = kCaptureFileMagic;
+        header.version = kCaptureFileVersion;
+        header.frameWidth = static_cast<uint32_t>( frameWidth );
+        header.frameHeight = static_cast<uint32_t>( frameHeight );
+        header.renderScale = renderScaleValue;
+        header.sampleCount = frameBuffers.sampleCount;
+        header.layout = static_cast<uint32_t>( frameBuffers.layout );
+        header.colorFormat = static_cast<uint32_t>( frameBuffers.colorFormat );
+        header.visibilityBuffer = visibilityMode ? 1 : 0;
+        header.halfVaryings = halfVaryingsMode ? 1 : 0;
+        capture = std::make_unique<CaptureWriter>( header );
+    }
+
+    static std::vector<uint32_t> captureViewTargets( CaptureWriter &capture, const std::vector<ViewDesc> &views )
+    {
+        std::vector<uint32_t> ids;
+        ids.reserve( views.size() );
+        for( const ViewDesc &view : views )
+            ids.push_back( capture.texture( view.renderTarget ) );
+        return ids;
+    }
+
+    static void writeViews( CaptureWriter &capture, const std::vector<ViewDesc> &views,
+                            const std::vector<uint32_t> &targets )
+    {
+        capture.write( static_cast<uint32_t>( views.size() ) );
+        for( size_t v = 0; v < views.size(); ++v )
+        {
+            capture.write( views[v].viewProj );
+            capture.write( views[v].viewport );
+            capture.write( targets[v] );
+        }
+    }
+
+    void Device::captureClear()
+    {
+        const uint32_t targetId = capture->texture( omStage.renderTargetTexture );
+        const std::vector<uint32_t> viewTargets = captureViewTargets( *capture, viewDescs );
+
+        capture->beginCommand( CaptureCommand::Clear );
+        capture->write( targetId );
+        writeViews( *capture, viewDescs, viewTargets );
+        capture->write( omStage.clearColor() );
+        capture->write( omStage.depthClearValue() );
+        capture->endCommand();
+    }
+
+    // Слот констант: 0 — пусто, 1 — буфер (номер и смещение), 2 — участок кольца констант (копия данных:
+    // страницы кольца переиспользуются, как ресурс они не пишутся)
+    static std::vector<uint32_t> captureConstantBuffers( CaptureWriter &capture,
+                                                         const std::vector<ConstantBinding> &slots )
+    {
+        std::vector<uint32_t> ids( slots.size(), 0 );
+        for( size_t s = 0; s < slots.size(); ++s )
+        {
+            if( slots[s] && !slots[s].transient )
+                ids[s] = capture.buffer( slots[s].buffer );
+        }
+        return ids;
+    }
+
+    static void writeConstants( CaptureWriter &capture, const std::vector<ConstantBinding> &slots,
+                                const std::vector<uint32_t> &ids )
+    {
+        capture.write( static_cast<uint32_t>( slots.size() ) );
+        for( size_t s = 0; s < slots.size(); ++s )
+        {
+            const ConstantBinding &binding = slots[s];
+            if( !binding )
+            {
+                capture.write( uint8_t( 0 ) );
+            }
+            else if( !binding.transient )
+            {
+                capture.write( uint8_t( 1 ) );
+                capture.write( ids[s] );
+                capture.write( static_cast<uint64_t>( binding.offset ) );
+            }
+            else
+            {
+                capture.write( uint8_t( 2 ) );
+                capture.write( static_cast<uint32_t>( binding.size ) );
+                capture.writeBytes( binding.data(), binding.size );
+            }
+        }
+    }
+
+    void Device::captureDraw( bool indexed, size_t count, size_t instanceCount, size_t start, int32_t baseVertex,
+                              size_t startInstance )
+    {
+        const uint32_t vertexBufferId = capture->buffer( iaStage.vertexBuffer );
+        const uint32_t indexBufferId = indexed ? capture->buffer( iaStage.indexBuffer ) : 0;
+        const uint32_t layoutId = capture->inputLayout( iaStage.inputLayout );
+        const std::vector<uint32_t> vsConstantIds = captureConstantBuffers( *capture, vsStage.constantBuffers );
+        const std::vector<uint32_t> psConstantIds = captureConstantBuffers( *capture, psStage.constantBuffers );
+        std::vector<uint32_t> textureIds;
+        for( const std::shared_ptr<Texture2D> &texture : psStage.textures )
+            textureIds.push_back( capture->texture( texture ) );
+        const uint32_t targetId = capture->texture( omStage.renderTargetTexture );
+        const std::vector<uint32_t> viewTargets = captureViewTargets( *capture, viewDescs );
+
+        CaptureWriter &out = *capture;
+        out.beginCommand( CaptureCommand::Draw );
+        out.write( uint8_t( indexed ? 1 : 0 ) );
+        out.write( static_cast<uint64_t>( count ) );
+        out.write( static_cast<uint64_t>( instanceCount ) );
+        out.write( static_cast<uint64_t>( start ) );
+        out.write( static_cast<uint64_t>( startInstance ) );
+        out.write( baseVertex );
+        out.write( vertexBufferId );
+        out.write( indexBufferId );
+        out.write( layoutId );
+        out.write( static_cast<uint32_t>( iaStage.primitiveTopology ) );
+
+        out.writeString( vsStage.shaderName );
+        const uint8_t psKind = !psStage.pixelShader ? 0 : !psStage.shaderName.empty() ? 1 : 2;
+        out.write( psKind );
+        out.writeString( psStage.shaderName );
+        writeConstants( out, vsStage.constantBuffers, vsConstantIds );
+        writeConstants( out, psStage.constantBuffers, psConstantIds );
+        out.write( static_cast<uint32_t>( textureIds.size() ) );
+        for( uint32_t id : textureIds )
+            out.write( id );
+        out.write( static_cast<uint32_t>( psStage.samplers.size() ) );
+        for( const SamplerState &sampler : psStage.samplers )
+            out.write( sampler );
+
+        out.write( rsStage.viewport );
+        out.write( uint8_t( rsStage.cullBackface ? 1 : 0 ) );
+        out.write( uint8_t( rsStage.wireframe ? 1 : 0 ) );
+        out.write( static_cast<uint32_t>( omStage.blend.mode ) );
+        out.write( static_cast<uint32_t>( omStage.blend.writeMask ) );
+        out.write( uint8_t( omStage.depth.depthEnable ? 1 : 0 ) );
+        out.write( uint8_t( omStage.depth.depthWrite ? 1 : 0 ) );
+        out.write( static_cast<uint32_t>( omStage.depth.func ) );
+        out.write( targetId );
+        writeViews( out, viewDescs, viewTargets );
+        out.endCommand();
+    }
+
+    void Device::finishCapture()
+    {
+        // Устройство перестаёт писать до записи файла: ошибка записи не оставляет захват активным
+        std::unique_ptr<CaptureWriter> writer = std::move( capture );
+        const std::string path = std::move( capturePath );
+        capturePath.clear();
+        writer->finish( path );
+    }
+
+    FrameReplay::FrameReplay( const std::string &path )
+    {
+        auto file = MappedFile::open( path );
+        CaptureReader in{ file->data(), file->data() + file->size(), path };
+        header_ = in.read<CaptureFileHeader>();
+        if( header_.magic != kCaptureFileMagic )
+            in.fail( "bad magic" );
+        if( header_.version != kCaptureFileVersion )
+            in.fail( "unsupported version" );
+        if( header_.frameWidth == 0 || header_.frameHeight == 0 || header_.frameWidth > kMaxTextureDim ||
+            header_.frameHeight > kMaxTextureDim )
+            in.fail( "bad frame size" );
+        if( header_.sampleCount != 1 && header_.sampleCount != 4 )
+            in.fail( "unsupported sample count" );
+        if( header_.layout > static_cast<uint32_t>( SurfaceLayout::Tiled ) )
+            in.fail( "bad framebuffer layout" );
+        if( header_.colorFormat > static_cast<uint32_t>( SurfaceFormat::RGBA16F ) )
+            in.fail( "bad back buffer format" );
+        if( !( header_.renderScale > 0.0f && header_.renderScale <= 1.0f ) )
+            in.fail( "bad render scale" );
+
+        // Последнее содержимое каждого буфера (номер в uploads): по нему проверяются индексы draw
+        std::unordered_map<uint32_t, size_t> bufferData;
+        auto knownBuffer = [&]( uint32_t id ) {
+            if( id != 0 && !buffers.count( id ) )
+                in.fail( "unknown buffer" );
+            return id;
+        };
+        auto knownTexture = [&]( uint32_t id ) {
+            if( id != 0 && !textures.count( id ) )
+                in.fail( "unknown texture" );
+            return id;
+        };
+        auto readViews = [&]( CaptureReader &body ) {
+            const uint32_t viewCount = body.read<uint32_t>();
+            if( viewCount > kMaxViews )
+                body.fail( "too many views" );
+            std::vector<ViewRecord> views( viewCount );
+            for( ViewRecord &view : views )
+            {
+                view.viewProj = body.read<glm::mat4>();
+                view.viewport = body.read<Viewport>();
+                view.renderTarget = knownTexture( body.read<uint32_t>() );
+            }
+            return views;
+        };
+        auto readConstants = [&]( CaptureReader &body ) {
+            std::vector<ConstantSlot> slots( body.count( sizeof( uint8_t ) ) );
+            for( ConstantSlot &slot : slots )
+            {
+                slot.kind = body.read<uint8_t>();
+                if( slot.kind == 1 )
+                {
+                    slot.buffer = knownBuffer( body.read<uint32_t>() );
+                    slot.offset = body.read<uint64_t>();
+                    if( slot.buffer != 0 )
+                    {
+                        const BufferRecord &record = buffers.at( slot.buffer );
+                        if( slot.offset >= record.elementSize * record.elementCount )
+                            body.fail( "constant buffer offset is outside of the buffer" );
+                    }
+                }
+                else if( slot.kind == 2 )
+                {
+                    const uint32_t size = body.read<uint32_t>();
+                    const uint8_t *bytes = body.bytes( size );
+                    slot.bytes.assign( bytes, bytes + size );
+                }
+                else if( slot.kind != 0 )
+                {
+                    body.fail( "bad constant slot" );
+                }
+            }
+            return slots;
+        };
+
+        for( uint32_t c = 0; c < header_.commandCount; ++c )
+        {
+            const CaptureCommandHeader command = in.read<CaptureCommandHeader>();
+            const uint8_t *bodyStart = in.bytes( command.size );
+            CaptureReader body{ bodyStart, bodyStart + command.size, path };
+            const CaptureCommand type = static_cast<CaptureCommand>( command.type );
+            switch( type )
+            {
+            case CaptureCommand::CreateBuffer: {
+                const uint32_t id = body.read<uint32_t>();
+                BufferRecord record;
+                record.elementSize = body.read<uint64_t>();
+                record.elementCount = body.read<uint64_t>();
+                record.format = body.read<uint32_t>();
+                // Содержимое буфера пишется при первом использовании, поэтому он не больше файла: размер из
+                // испорченного файла не превратится в огромное выделение при создании ресурсов
+                if( record.elementSize == 0 || record.elementCount > file->size() / record.elementSize )
+                    body.fail( "bad buffer size" );
+                if( id == 0 || !buffers.emplace( id, std::move( record ) ).second )
+                    body.fail( "duplicate buffer" );
+                break;
+            }
+            case CaptureCommand::CreateTexture: {
+                const uint32_t id = body.read<uint32_t>();
+                TextureRecord record;
+                record.desc.width = static_cast<size_t>( body.read<uint64_t>() );
+                record.desc.height = static_cast<size_t>( body.read<uint64_t>() );
+                record.desc.mipLevels = body.read<uint32_t>();
+                record.desc.format = static_cast<BufferFormat>( body.read<uint32_t>() );
+                record.desc.bindFlags = body.read<uint32_t>();
+                record.desc.sampleCount = body.read<uint32_t>();
+                // Описание пишется после создания текстуры: mipLevels уже приведён к 1..полной цепочки
+                const TextureDesc &desc = record.desc;
+                uint32_t maxLevels = 1;
+                while( ( std::max( desc.width, desc.height ) >> maxLevels ) != 0 )
+                    ++maxLevels;
+                if( desc.width == 0 || desc.height == 0 || desc.width > kMaxTextureDim ||
+                    desc.height > kMaxTextureDim || desc.mipLevels == 0 || desc.mipLevels > maxLevels ||
+                    !isTextureFormat( desc.format ) ||
+                    ( desc.bindFlags & ~uint32_t( TextureBindShaderResource | TextureBindRenderTarget |
+                                                  TextureBindDepthStencil ) ) != 0 ||
+                    ( desc.sampleCount != 1 && desc.sampleCount != 4 ) )
+                    body.fail( "bad texture description" );
+                // Тексели обычной текстуры пишутся при первом использовании (не меньше половины байта на тексель
+                // у BC1), поэтому она не больше файла
+                if( !isRenderTarget( desc ) && desc.width * desc.height / 2 > file->size() )
+                    body.fail( "bad texture description" );
+                if( id == 0 || !textures.emplace( id, std::move( record ) ).second )
+                    body.fail( "duplicate texture" );
+                break;
+            }
+            case CaptureCommand::CreateInputLayout: {
+                const uint32_t id = body.read<uint32_t>();
+                InputLayoutDesc desc;
+                desc.stride = static_cast<size_t>( body.read<uint64_t>() );
+                desc.elements.resize( body.count( 2 * sizeof( uint32_t ) + sizeof( uint64_t ) ) );
+                if( desc.stride == 0 )
+                    body.fail( "zero input layout stride" );
+                for( InputElementDesc &e : desc.elements )
+                {
+                    const uint32_t semantic = body.read<uint32_t>();
+                    const uint32_t format = body.read<uint32_t>();
+                    const uint64_t offset = body.read<uint64_t>();
+                    // Элемент целиком внутри вершины: выборка последней вершины не выйдет за буфер
+                    if( semantic > static_cast<uint32_t>( Semantic::NORMAL0 ) ||
+                        format > static_cast<uint32_t>( InputFormat::R32G32B32A32_FLOAT ) || offset > desc.stride ||
+                        inputFormatSize( static_cast<InputFormat>( format ) ) > desc.stride - offset )
+                        body.fail( "bad input layout element" );
+                    e = { static_cast<Semantic>( semantic ), static_cast<InputFormat>( format ),
+                          static_cast<size_t>( offset ) };
+                }
+                if( id == 0 || !layoutDescs.emplace( id, std::move( desc ) ).second )
+                    body.fail( "duplicate input layout" );
+                break;
+            }
+            case CaptureCommand::BufferData:
+            case CaptureCommand::TextureData: {
+                const uint32_t id = body.read<uint32_t>();
+                if( type == CaptureCommand::BufferData )
+                {
+                    auto it = buffers.find( id );
+                    if( it == buffers.end() )
+                        body.fail( "unknown buffer" );
+                    if( command.size - sizeof( id ) != it->second.elementSize * it->second.elementCount )
+                        body.fail( "buffer data size mismatch" );
+                }
+                else
+                {
+                    auto it = textures.find( id );
+                    if( it == textures.end() || isRenderTarget( it->second.desc ) )
+                        body.fail( "unknown texture" );
+                }
+                const size_t size = command.size - sizeof( id );
+                const uint8_t *bytes = body.bytes( size );
+                if( type == CaptureCommand::BufferData )
+                    bufferData[id] = uploads.size();
+                commands.push_back( { type, uploads.size() } );
+                uploads.emplace_back( id, std::vector<uint8_t>( bytes, bytes + size ) );
+                break;
+            }
+            case CaptureCommand::Clear: {
+                ClearRecord clear;
+                clear.target = knownTexture( body.read<uint32_t>() );
+                clear.views = readViews( body );
+                clear.color = body.read<glm::vec4>();
+                clear.depth = body.read<float>();
+                commands.push_back( { type, clears.size() } );
+                clears.push_back( std::move( clear ) );
+                break;
+            }
+            case CaptureCommand::Draw: {
+                DrawRecord draw;
+                draw.indexed = body.read<uint8_t>();
+                draw.count = body.read<uint64_t>();
+                draw.instanceCount = body.read<uint64_t>();
+                draw.start = body.read<uint64_t>();
+                draw.startInstance = body.read<uint64_t>();
+                draw.baseVertex = body.read<int32_t>();
+                draw.vertexBuffer = knownBuffer( body.read<uint32_t>() );
+                draw.indexBuffer = knownBuffer( body.read<uint32_t>() );
+                draw.inputLayout = body.read<uint32_t>();
+                if( draw.inputLayout != 0 && !layoutDescs.count( draw.inputLayout ) )
+                    body.fail( "unknown input layout" );
+                draw.topology = body.read<uint32_t>();
+                if( draw.vertexBuffer == 0 || draw.inputLayout == 0 || ( draw.indexed && draw.indexBuffer == 0 ) )
+                    body.fail( "draw without input assembler resources" );
+                if( draw.topology != static_cast<uint32_t>( PrimitiveTopology::TriangleList ) )
+                    body.fail( "bad primitive topology" );
+                // Диапазон draw внутри буфера: у индексного — индексы, у неиндексного — вершины по шагу layout.
+                // Размеры буферов ограничены размером файла, поэтому count не раздует арену вершин
+                const BufferRecord &range = buffers.at( draw.indexed ? draw.indexBuffer : draw.vertexBuffer );
+                uint64_t rangeSize = range.elementCount;
+                if( !draw.indexed )
+                    rangeSize = range.elementSize * range.elementCount / layoutDescs.at( draw.inputLayout ).stride;
+                if( draw.count > rangeSize || draw.start > rangeSize - draw.count )
+                    body.fail( "draw range is outside of the buffer" );
+                if( draw.indexed )
+                {
+                    // Вершины, которые выберет draw (индекс + baseVertex), — по содержимому индексного буфера
+                    // на момент draw; отрицательный baseVertex допустим
+                    const uint64_t indexSize = range.elementSize;
+                    if( !( ( range.format == static_cast<uint32_t>( BufferFormat::R16_UINT ) && indexSize == 2 ) ||
+                           ( range.format == static_cast<uint32_t>( BufferFormat::R32_UINT ) && indexSize == 4 ) ) )
+                        body.fail( "bad index buffer format" );
+                    auto data = bufferData.find( draw.indexBuffer );
+                    if( data == bufferData.end() )
+                        body.fail( "index buffer without data" );
+                    const BufferRecord &vb = buffers.at( draw.vertexBuffer );
+                    const int64_t vertexCount = static_cast<int64_t>(
+                        vb.elementSize * vb.elementCount / layoutDescs.at( draw.inputLayout ).stride );
+                    uint32_t minIndex, maxIndex;
+                    if( indexRange( uploads[data->second].second, indexSize, draw.start, draw.count, minIndex,
+                                    maxIndex ) &&
+                        ( static_cast<int64_t>( minIndex ) + draw.baseVertex < 0 ||
+                          static_cast<int64_t>( maxIndex ) + draw.baseVertex >= vertexCount ) )
+                        body.fail( "draw index is outside of the vertex buffer" );
+                }
+                draw.vertexShader = body.string();
+                draw.pixelShaderKind = body.read<uint8_t>();
+                draw.pixelShader = body.string();
+                if( draw.pixelShaderKind > 2 )
+                    body.fail( "bad pixel shader kind" );
+                draw.vsConstants = readConstants( body );
+                draw.psConstants = readConstants( body );
+                draw.textures.resize( body.count( sizeof( uint32_t ) ) );
+                for( uint32_t &id : draw.textures )
+                    id = knownTexture( body.read<uint32_t>() );
+                draw.samplers.resize( body.count( sizeof( SamplerState ) ) );
+                for( SamplerState &sampler : draw.samplers )
+                    sampler = body.read<SamplerState>();
+                draw.viewport = body.read<Viewport>();
+                draw.cullBackface = body.read<uint8_t>();
+                draw.wireframe = body.read<uint8_t>();
+                draw.blend.mode = static_cast<BlendMode>( body.read<uint32_t>() );
+                draw.blend.writeMask = static_cast<uint8_t>( body.read<uint32_t>() );
+                draw.depth.depthEnable = body.read<uint8_t>() != 0;
+                draw.depth.depthWrite = body.read<uint8_t>() != 0;
+                draw.depth.func = static_cast<DepthFunc>( body.read<uint32_t>() );
+                draw.target = knownTexture( body.read<uint32_t>() );
+                draw.views = readViews( body );
+
+                // Шейдеры ищутся в реестре этого процесса: без них draw нечем выполнить
+                draw.skipped = draw.vertexShader.empty() || !isVertexShaderRegistered( draw.vertexShader ) ||
+                               draw.pixelShaderKind == 2 ||
+                               ( draw.pixelShaderKind == 1 && !isPixelShaderRegistered( draw.pixelShader ) );
+                DrawInfo info;
+                info.vertexShader = draw.vertexShader.empty() ? "(unnamed)" : draw.vertexShader;
+                info.pixelShader = draw.pixelShaderKind == 0   ? "(none)"
+                                   : draw.pixelShaderKind == 2 ? "(unnamed)"
+                                                               : draw.pixelShader;
+                info.indexed = draw.indexed != 0;
+                info.count = draw.count;
+                info.instanceCount = draw.instanceCount;
+                info.skipped = draw.skipped;
+                drawInfos.push_back( std::move( info ) );
+                commands.push_back( { type, drawRecords.size() } );
+                drawRecords.push_back( std::move( draw ) );
+                break;
+            }
+            default:
+                body.fail( "unknown command" );
+            }
+            if( body.pos != body.end )
+                body.fail( "malformed command" );
+        }
+    }
+
+    std::shared_ptr<Device> FrameReplay::createDevice() const
+    {
+        auto device = Device::create( header_.frameWidth, header_.frameHeight );
+        device->setSampleCount( header_.sampleCount );
+        device->setFramebufferLayout( static_cast<SurfaceLayout>( header_.layout ) );
+        device->setBackBufferFormat( static_cast<SurfaceFormat>( header_.colorFormat ) );
+        device->setRenderScale( header_.renderScale );
+        device->setVisibilityBuffer( header_.visibilityBuffer != 0 );
+        device->setHalfVaryings( header_.halfVaryings != 0 );
+        return device;
+    }
+
+    void FrameReplay::createResources( Device &device )
+    {
+        for( auto &entry : buffers )
+        {
+            BufferRecord &record = entry.second;
+            record.buffer = device.createBuffer( static_cast<size_t>( record.elementSize ),
+                                                 static_cast<size_t>( record.elementCount ),
+                                                 static_cast<BufferFormat>( record.format ) );
+        }
+        for( auto &entry : textures )
+            entry.second.texture = device.createTexture2D( entry.second.desc );
+        for( const auto &entry : layoutDescs )
+            layouts[entry.first] = device.createInputLayout( entry.second );
+
+        // Размер текселей определяется описанием текстуры, его можно проверить только после создания
+        for( const Command &command : commands )
+        {
+            if( command.type != CaptureCommand::TextureData )
+                continue;
+            const auto &upload = uploads[command.index];
+            if( upload.second.size() != textures[upload.first].texture->memorySize() )
+                throw std::runtime_error( "Capture: texture data size mismatch" );
+        }
+        boundDevice = device.shared_from_this();
+        currentTarget = 0;
+        currentViews.clear();
+    }
+
+    void FrameReplay::setTarget( Device &device, uint32_t target )
+    {
+        // Смена цели разрешает буфер видимости, поэтому цель переключается только при изменении
+        if( target == currentTarget )
+            return;
+        device.OM().setRenderTarget( target ? textures[target].texture : nullptr );
+        currentTarget = target;
+    }
+
+    void FrameReplay::setViews( Device &device, const std::vector<ViewRecord> &views )
+    {
+        bool same = views.size() == currentViews.size();
+        for( size_t v = 0; same && v < views.size(); ++v )
+        {
+            same = views[v].viewProj == currentViews[v].viewProj &&
+                   sameViewport( views[v].viewport, currentViews[v].viewport ) &&
+                   views[v].renderTarget == currentViews[v].renderTarget;
+        }
+        if( same )
+            return;
+        std::vector<ViewDesc> descs( views.size() );
+        for( size_t v = 0; v < views.size(); ++v )
+        {
+            descs[v].viewProj = views[v].viewProj;
+            descs[v].viewport = views[v].viewport;
+            descs[v].renderTarget = views[v].renderTarget ? textures[views[v].renderTarget].texture : nullptr;
+        }
+        device.setViews( descs );
+        currentViews = views;
+    }
+
+    void FrameReplay::bindConstants( Device &device, bool pixel, const std::vector<ConstantSlot> &slots )
+    {
+        for( size_t s = 0; s < slots.size(); ++s )
+        {
+            const ConstantSlot &slot = slots[s];
+            if( slot.kind == 2 )
+            {
+                ConstantAllocation alloc = device.allocateConstants( slot.bytes.size() );
+                std::memcpy( alloc.data, slot.bytes.data(), slot.bytes.size() );
+                if( pixel )
+                    device.PS().setConstants( s, alloc.binding );
+                else
+                    device.VS().setConstants( s, alloc.binding );
+                continue;
+            }
+            std::shared_ptr<Buffer> buffer = slot.kind == 1 ? buffers[slot.buffer].buffer : nullptr;
+            const size_t offset = static_cast<size_t>( slot.offset );
+            if( pixel )
+                device.PS().setConstantBuffer( s, std::move( buffer ), offset );
+            else
+                device.VS().setConstantBuffer( s, std::move( buffer ), offset );
+        }
+    }
+
+    void FrameReplay::applyDraw( Device &device, const DrawRecord &draw )
+    {
+        setTarget( device, draw.target );
+        setViews( device, draw.views );
+
+        device.IA().setVertexBuffer( draw.vertexBuffer ? buffers[draw.vertexBuffer].buffer : nullptr );
+        device.IA().setIndexBuffer( draw.indexBuffer ? buffers[draw.indexBuffer].buffer : nullptr );
+        device.IA().setInputLayout( draw.inputLayout ? layouts[draw.inputLayout] : nullptr );
+        device.IA().setPrimitiveTopology( static_cast<PrimitiveTopology>( draw.topology ) );
+
+        device.VS().setNamedVertexShader( draw.vertexShader );
+        if( draw.pixelShaderKind == 0 )
+            device.PS().setPixelShader( nullptr );
+        else
+            device.PS().setNamedPixelShader( draw.pixelShader );
+        bindConstants( device, false, draw.vsConstants );
+        bindConstants( device, true, draw.psConstants );
+        for( size_t t = 0; t < draw.textures.size(); ++t )
+            device.PS().setShaderResource( t, draw.textures[t] ? textures[draw.textures[t]].texture : nullptr );
+        for( size_t s = 0; s < draw.samplers.size(); ++s )
+            device.PS().setSampler( s, draw.samplers[s] );
+
+        device.RS().setViewport( draw.viewport );
+        device.RS().setCullBackface( draw.cullBackface != 0 );
+        device.RS().setWireframe( draw.wireframe != 0 );
+        device.OM().setBlendState( draw.blend );
+        device.OM().setDepthState( draw.depth );
+    }
+
+    void FrameReplay::replay( Device &device, std::vector<double> *drawMs )
+    {
+        if( boundDevice.lock().get() != &device )
+            createResources( device );
+        if( drawMs )
+            drawMs->assign( drawRecords.size(), 0.0 );
+
+        device.beginFrame();
+        for( const Command &command : commands )
+        {
+            switch( command.type )
+            {
+            case CaptureCommand::BufferData: {
+                const auto &upload = uploads[command.index];
+                Buffer &buffer = *buffers[upload.first].buffer;
+                std::memcpy( buffer.data(), upload.second.data(), upload.second.size() );
+                buffer.markDirty();
+                break;
+            }
+            case CaptureCommand::TextureData: {
+                const auto &upload = uploads[command.index];
+                textures[upload.first].texture->uploadRawData( upload.second.data() );
+                break;
+            }
+            case CaptureCommand::Clear: {
+                const ClearRecord &clear = clears[command.index];
+                setTarget( device, clear.target );
+                setViews( device, clear.views );
+                device.OM().setClearColor( clear.color );
+                device.OM().setDepthClearValue( clear.depth );
+                device.clear();
+                break;
+            }
+            case CaptureCommand::Draw: {
+                const DrawRecord &draw = drawRecords[command.index];
+                if( draw.skipped )
+                    break;
+                applyDraw( device, draw );
+                auto t0 = std::chrono::steady_clock::now();
+                if( draw.indexed )
+                    device.drawIndexedInstanced( static_cast<size_t>( draw.count ),
+                                                 static_cast<size_t>( draw.instanceCount ),
+                                                 static_cast<size_t>( draw.start ), draw.baseVertex,
+                                                 static_cast<size_t>( draw.startInstance ) );
+                else
+                    device.drawInstanced( static_cast<size_t>( draw.count ), static_cast<size_t>( draw.instanceCount ),
+                                          static_cast<size_t>( draw.start ),
+                                          static_cast<size_t>( draw.startInstance ) );
+                auto t1 = std::chrono::steady_clock::now();
+                if( drawMs )
+                    ( *drawMs )[command.index] = std::chrono::duration<double, std::milli>( t1 - t0 ).count();
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        device.endFrame();
+        // Текстуры целей разрешаются, следующий кадр начинается с заднего буфера, как и первый
+        setViews( device, {} );
+        setTarget( device, 0 );
+    }
+} // namespace swr
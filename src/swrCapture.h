@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "swrDevice.h"
+
+namespace swr
+{
+    // Захват кадра (.swrc, Device::captureFrame), little-endian:
+    //
+    //   CaptureFileHeader
+    //   команды: CaptureCommandHeader, затем size байт тела
+    //
+    // Ресурсы получают номера (0 — нет ресурса, у цели рендеринга — задний буфер). Создание ресурса пишется
+    // при первом использовании, содержимое буфера — при первом использовании и каждый раз, когда оно
+    // отличается от записанного (сравнение копий), текстуры — при смене Texture2D::version. Содержимое целей
+    // рендеринга (TextureBindRenderTarget/DepthStencil) не пишется: их производят воспроизводимые clear и draw,
+    // поэтому кадр должен очищать цели сам, а не читать оставшееся от прошлых кадров.
+    // Draw несёт полное состояние конвейера, шейдеры — по именам из реестра (setNamedVertexShader/
+    // setNamedPixelShader). Draw с безымянным или незарегистрированным шейдером при воспроизведении пропускается
+    constexpr uint32_t kCaptureFileMagic = 0x43525753; // "SWRC"
+    constexpr uint32_t kCaptureFileVersion = 1;
+
+    struct CaptureFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t frameWidth; // Размер кадра устройства (Device::create)
+        uint32_t frameHeight;
+        float renderScale;
+        uint32_t sampleCount;
+        uint32_t layout;      // SurfaceLayout
+        uint32_t colorFormat; // SurfaceFormat заднего буфера
+        uint32_t visibilityBuffer;
+        uint32_t halfVaryings;
+        uint32_t commandCount;
+        uint32_t drawCount;
+    };
+
+    enum class CaptureCommand : uint32_t
+    {
+        CreateBuffer = 1,  // id, elementSize, elementCount, format
+        BufferData,        // id, байты всего буфера
+        CreateTexture,     // id, TextureDesc
+        TextureData,       // id, тексели во внутренней раскладке (Texture2D::rawData)
+        CreateInputLayout, // id, stride, элементы
+        Clear,             // цель OM, виды, цвет и глубина очистки
+        Draw,              // аргументы и состояние конвейера
+    };
+
+    struct CaptureCommandHeader
+    {
+        uint32_t type; // CaptureCommand
+        uint32_t size; // Байт тела
+    };
+
+    // Запись захвата: команды копятся в памяти, файл пишется в finish()
+    class CaptureWriter
+    {
+      public:
+        explicit CaptureWriter( const CaptureFileHeader &header );
+
+        // Номер ресурса; создание и изменившееся содержимое пишутся тут же, поэтому вызывать их можно
+        // только между командами, а не внутри тела
+        uint32_t buffer( const std::shared_ptr<Buffer> &buffer );
+        uint32_t texture( const std::shared_ptr<Texture2D> &texture );
+        uint32_t inputLayout( const std::shared_ptr<InputLayout> &layout );
+
+        void beginCommand( CaptureCommand type );
+        void endCommand();
+        template <typename T> void write( const T &value )
+        {
+            static_assert( std::is_trivially_copyable<T>::value, "CaptureWriter::write: T must be trivially copyable" );
+            writeBytes( &value, sizeof( T ) );
+        }
+        void writeBytes( const void *data, size_t size );
+        void writeString( const std::string &value );
+
+        // Ошибка записи — std::runtime_error
+        void finish( const std::string &path );
+
+      private:
+        struct BufferEntry
+        {
+            uint32_t id;
+            std::shared_ptr<Buffer> buffer; // Держит ресурс живым: адрес не достанется другому ресурсу
+            std::vector<uint8_t> written;   // Последнее записанное содержимое
+        };
+        struct TextureEntry
+        {
+            uint32_t id;
+            std::shared_ptr<Texture2D> texture;
+            uint64_t version;
+        };
+        struct LayoutEntry
+        {
+            uint32_t id;
+            std::shared_ptr<InputLayout> layout;
+        };
+
+        CaptureFileHeader header;
+        std::vector<uint8_t> stream;
+        size_t commandStart = 0;
+        uint32_t nextId = 1;
+        std::unordered_map<const Buffer *, BufferEntry> buffers;
+        std::unordered_map<const Texture2D *, TextureEntry> textures;
+        std::unordered_map<const InputLayout *, LayoutEntry> layouts;
+    };
+
+    // Воспроизведение захвата на устройстве (утилита swr_replay). Файл разбирается в конструкторе
+    // (ошибка формата — std::runtime_error), ресурсы создаются при первом replay и переиспользуются
+    class FrameReplay
+    {
+      public:
+        explicit FrameReplay( const std::string &path );
+
+        const CaptureFileHeader &header() const
+        {
+            return header_;
+        }
+
+        // Описание draw для отчёта; skipped — шейдер безымянный или не зарегистрирован в этом процессе
+        struct DrawInfo
+        {
+            std::string vertexShader; // Имя или "(unnamed)"
+            std::string pixelShader;  // Имя, "(none)" у draw только глубины или "(unnamed)"
+            bool indexed;
+            uint64_t count;
+            uint64_t instanceCount;
+            bool skipped;
+        };
+        const std::vector<DrawInfo> &draws() const
+        {
+            return drawInfos;
+        }
+
+        // Устройство с размером кадра и настройками захваченного кадра
+        std::shared_ptr<Device> createDevice() const;
+
+        // Один кадр: beginFrame, команды захвата, endFrame. drawMs (если задан) получает время каждого draw, мс;
+        // у пропущенного — 0. В режиме буфера видимости затенение идёт в endFrame и во время draw не входит
+        void replay( Device &device, std::vector<double> *drawMs = nullptr );
+
+      private:
+        struct ConstantSlot
+        {
+            uint8_t kind = 0; // 0 — пусто, 1 — буфер со смещением, 2 — данные кольца констант (bytes)
+            uint32_t buffer = 0;
+            uint64_t offset = 0;
+            std::vector<uint8_t> bytes;
+        };
+        struct ViewRecord
+        {
+            glm::mat4 viewProj;
+            Viewport viewport;
+            uint32_t renderTarget;
+        };
+        struct DrawRecord
+        {
+            uint8_t indexed;
+            uint64_t count, instanceCount, start, startInstance;
+            int32_t baseVertex;
+            uint32_t vertexBuffer, indexBuffer, inputLayout, topology;
+            std::string vertexShader;
+            uint8_t pixelShaderKind; // 0 — нет, 1 — по имени, 2 — безымянный
+            std::string pixelShader;
+            std::vector<ConstantSlot> vsConstants, psConstants;
+            std::vector<uint32_t> textures;
+            std::vector<SamplerState> samplers;
+            Viewport viewport;
+            uint8_t cullBackface, wireframe;
+            BlendState blend;
+            DepthState depth;
+            uint32_t target;
+            std::vector<ViewRecord> views;
+            bool skipped;
+        };
+        struct ClearRecord
+        {
+            uint32_t target;
+            std::vector<ViewRecord> views;
+            glm::vec4 color;
+            float depth;
+        };
+        // Команда в порядке захвата: index — номер в списке своего типа
+        struct Command
+        {
+            CaptureCommand type;
+            size_t index;
+        };
+
+        void applyDraw( Device &device, const DrawRecord &draw );
+        void bindConstants( Device &device, bool pixel, const std::vector<ConstantSlot> &slots );
+        void setTarget( Device &device, uint32_t target );
+        void setViews( Device &device, const std::vector<ViewRecord> &views );
+        void createResources( Device &device );
+
+        CaptureFileHeader header_;
+        std::vector<Command> commands;
+        std::vector<DrawRecord> drawRecords;
+        std::vector<DrawInfo> drawInfos;
+        std::vector<ClearRecord> clears;
+        // Ресурсы захвата: описание и содержимое из файла, созданный на устройстве объект
+        struct BufferRecord
+        {
+            uint64_t elementSize, elementCount;
+            uint32_t format;
+            std::shared_ptr<Buffer> buffer;
+        };
+        struct TextureRecord
+        {
+            TextureDesc desc;
+            std::shared_ptr<Texture2D> texture;
+        };
+        std::unordered_map<uint32_t, BufferRecord> buffers;
+        std::unordered_map<uint32_t, TextureRecord> textures;
+        std::unordered_map<uint32_t, InputLayoutDesc> layoutDescs;
+        std::unordered_map<uint32_t, std::shared_ptr<InputLayout>> layouts;
+        // Данные BufferData/TextureData: id ресурса и байты
+        std::vector<std::pair<uint32_t, std::vector<uint8_t>>> uploads;
+        std::weak_ptr<Device> boundDevice; // Устройство, на котором созданы ресурсы
+        uint32_t currentTarget = 0;
+        std::vector<ViewRecord> currentViews;
+    };
+} // namespace swr
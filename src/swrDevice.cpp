@@ -1,7 +1,16 @@
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
 
+#include "swrCapture.h"
 #include "swrDevice.h"
+#include "swrSimd.h"
 #include <SDL3/SDL.h>
 
 namespace
@@ -27,6 +36,20 @@ namespace
         TextureLock( const TextureLock & ) = delete;
         TextureLock &operator=( const TextureLock & ) = delete;
     };
+
+    std::uint32_t vec4ColorToRGBA8( const glm::vec4 &color, const SDL_PixelFormatDetails *pfmt )
+    {
+        std::uint32_t r = static_cast<std::uint32_t>( glm::clamp( color.r, 0.0f, 1.0f ) * 255.0f );
+        std::uint32_t g = static_cast<std::uint32_t>( glm::clamp( color.g, 0.0f, 1.0f ) * 255.0f );
+        std::uint32_t b = static_cast<std::uint32_t>( glm::clamp( color.b, 0.0f, 1.0f ) * 255.0f );
+        std::uint32_t a = static_cast<std::uint32_t>( glm::clamp( color.a, 0.0f, 1.0f ) * 255.0f );
+        // Pack using masks/shifts from pixel format details
+        return ( ( r << pfmt->Rshift ) & pfmt->Rmask ) | ( ( g << pfmt->Gshift ) & pfmt->Gmask ) |
+               ( ( b << pfmt->Bshift ) & pfmt->Bmask ) | ( ( a << pfmt->Ashift ) & pfmt->Amask );
+    }
+
+    // Минимальный допустимый масштаб внутреннего разрешения
+    constexpr float kMinRenderScale = 0.25f;
 } // unnamed namespace
 
 namespace swr
@@ -40,26 +63,148 @@ namespace swr
         return dev;
     }
 
+    Device::Device( size_t width, size_t height )
+        : iaStage( std::shared_ptr<Device>() ), vsStage( std::shared_ptr<Device>() ),
+          rsStage( std::shared_ptr<Device>() ), psStage( std::shared_ptr<Device>() ),
+          omStage( std::shared_ptr<Device>() ), frameWidth( width ), frameHeight( height )
+    {
+        frameBuffers.resize( width, height, glm::vec4( 0.0f ), 1.0f );
+    }
+
     Device::~Device() = default;
 
-    std::shared_ptr<Buffer> Device::createBuffer( size_t elementSize, size_t elementCount, BufferFormat format )
+    std::shared_ptr<Buffer> Device::createBuffer( size_t elementSize, size_t elementCount, BufferFormat format,
+                                                  const BufferOptions &options )
     {
-        // Делетер захватывает weak_ptr<Device>, чтобы избежать продления жизни устройства
-        std::weak_ptr<Device> wself = shared_from_this();
-        Buffer *raw = new Buffer( elementSize, elementCount, format );
-        auto deleter = [wself]( Buffer *p ) {
-            // Если устройство ещё живо, тут можно выполнить внутреннюю очистку
-            // if (auto self = wself.lock()) { /* self->onBufferDestroy(p); */ }
+        // Память — из пула устройства; делетер возвращает её туда же. Делетер держит DeviceMemory, а не
+        // устройство, чтобы не продлевать жизнь устройства
+        const size_t bytes = elementSize * elementCount;
+        const DeviceMemory::Block block = memory->allocate( bytes, options.alignment );
+        if( options.zeroInitialize )
+            std::memset( block.data, 0, bytes );
+        std::shared_ptr<DeviceMemory> pool = memory;
+        Buffer *raw = new Buffer( elementSize, elementCount, format, block.data, nullptr, false );
+        auto deleter = [pool, block]( Buffer *p ) {
+            delete p;
+            pool->release( block );
+        };
+        return std::shared_ptr<Buffer>( raw, std::move( deleter ) );
+    }
+
+    std::shared_ptr<Buffer> Device::createBufferFromMemory( size_t elementSize, size_t elementCount,
+                                                            BufferFormat format, const void *data,
+                                                            std::shared_ptr<const void> owner )
+    {
+        const size_t bytes = elementSize * elementCount;
+        memory->track( ResourceKind::External, bytes );
+        std::shared_ptr<DeviceMemory> pool = memory;
+        Buffer *raw =
+            new Buffer( elementSize, elementCount, format, const_cast<void *>( data ), std::move( owner ), true );
+        auto deleter = [pool, bytes]( Buffer *p ) {
+            delete p;
+            pool->untrack( ResourceKind::External, bytes );
+        };
+        return std::shared_ptr<Buffer>( raw, std::move( deleter ) );
+    }
+
+    std::shared_ptr<Buffer> Device::wrapMemory( size_t elementSize, size_t elementCount, BufferFormat format,
+                                                void *data, std::shared_ptr<void> owner )
+    {
+        const size_t bytes = elementSize * elementCount;
+        memory->track( ResourceKind::External, bytes );
+        std::shared_ptr<DeviceMemory> pool = memory;
+        Buffer *raw = new Buffer( elementSize, elementCount, format, data, std::move( owner ), false );
+        auto deleter = [pool, bytes]( Buffer *p ) {
             delete p;
+            pool->untrack( ResourceKind::External, bytes );
         };
         return std::shared_ptr<Buffer>( raw, std::move( deleter ) );
     }
 
+    std::shared_ptr<Texture2D> Device::createTexture2D( const TextureDesc &desc )
+    {
+        // Размер текстуры известен только после раскладки мипов: не прошедшая бюджет текстура удаляется сразу
+        std::unique_ptr<Texture2D> texture( new Texture2D( desc ) );
+        RenderSurface *surface = texture->renderSurface();
+        const size_t bytes = texture->memorySize() + ( surface ? surface->memorySize() : 0 );
+        memory->track( ResourceKind::Texture, bytes );
+        std::shared_ptr<DeviceMemory> pool = memory;
+        auto deleter = [pool, bytes]( Texture2D *p ) {
+            delete p;
+            pool->untrack( ResourceKind::Texture, bytes );
+        };
+        return std::shared_ptr<Texture2D>( texture.release(), std::move( deleter ) );
+    }
+
+    void Device::bindRenderTarget( const std::shared_ptr<Texture2D> &texture )
+    {
+        if( recording && texture )
+            stopRecording();
+        flushVisibilityBuffer();
+        // Отрисованное в предыдущую текстуру переносим в её тексели, чтобы её можно было читать
+        if( target != &frameBuffers && omStage.renderTargetTexture )
+            omStage.renderTargetTexture->resolveRenderSurface();
+
+        RenderSurface *surface = texture ? texture->renderSurface() : &frameBuffers;
+        if( !surface )
+        {
+            assert( false && "Texture was not created with TextureBindRenderTarget or TextureBindDepthStencil" );
+            surface = &frameBuffers;
+        }
+        target = surface;
+    }
+
+    void Device::setViews( const std::vector<ViewDesc> &views )
+    {
+        if( views.size() > kMaxViews )
+            throw std::out_of_range( "setViews: too many views" );
+        if( recording && !views.empty() )
+            stopRecording();
+        // Отрисованное в текстуры прежних видов переносим в тексели, как при смене цели OM
+        for( size_t v = 0; v < viewDescs.size(); ++v )
+        {
+            const std::shared_ptr<Texture2D> &texture = viewDescs[v].renderTarget;
+            bool resolved = false;
+            for( size_t u = 0; u < v && !resolved; ++u )
+                resolved = viewDescs[u].renderTarget == texture;
+            if( texture && !resolved )
+                texture->resolveRenderSurface();
+        }
+
+        viewDescs = views;
+        viewSurfaces.assign( views.size(), nullptr );
+        for( size_t v = 0; v < views.size(); ++v )
+        {
+            if( !views[v].renderTarget )
+                continue;
+            viewSurfaces[v] = views[v].renderTarget->renderSurface();
+            if( !viewSurfaces[v] )
+                assert( false &&
+                        "View texture was not created with TextureBindRenderTarget or TextureBindDepthStencil" );
+        }
+    }
+
     std::shared_ptr<InputLayout> Device::createInputLayout( const InputLayoutDesc &desc )
     {
         return std::make_shared<InputLayout>( desc );
     }
 
+    size_t inputFormatSize( InputFormat format )
+    {
+        switch( format )
+        {
+        case InputFormat::R32_FLOAT:
+            return 4;
+        case InputFormat::R32G32_FLOAT:
+            return 8;
+        case InputFormat::R32G32B32_FLOAT:
+            return 12;
+        case InputFormat::R32G32B32A32_FLOAT:
+            return 16;
+        }
+        return 0;
+    }
+
     // VertexInputView implementations
     float VertexInputView::readFloat1( Semantic semantic, size_t index ) const
     {
@@ -123,8 +268,153 @@ namespace swr
             return;
         frameWidth = width;
         frameHeight = height;
-        frameBuffers.colorBuffer.assign( width * height, omStage.clearColor() );
-        frameBuffers.depthBuffer.assign( width * height, omStage.depthClearValue() );
+        resizeBackBuffer( frameBuffers.sampleCount, frameBuffers.layout, frameBuffers.colorFormat );
+    }
+
+    void Device::setSampleCount( uint32_t samples )
+    {
+        if( samples == frameBuffers.sampleCount )
+            return;
+        resizeBackBuffer( samples, frameBuffers.layout, frameBuffers.colorFormat );
+    }
+
+    void Device::setFramebufferLayout( SurfaceLayout layout )
+    {
+        if( layout == frameBuffers.layout )
+            return;
+        resizeBackBuffer( frameBuffers.sampleCount, layout, frameBuffers.colorFormat );
+    }
+
+    void Device::setBackBufferFormat( SurfaceFormat format )
+    {
+        if( format == SurfaceFormat::DepthOnly )
+        {
+            assert( false && "Back buffer must have a color format" );
+            return;
+        }
+        if( format == frameBuffers.colorFormat )
+            return;
+        resizeBackBuffer( frameBuffers.sampleCount, frameBuffers.layout, format );
+    }
+
+    void Device::setRenderScale( float scale )
+    {
+        scale = std::clamp( scale, kMinRenderScale, 1.0f );
+        if( scale == renderScaleValue )
+            return;
+        renderScaleValue = scale;
+        if( scaledSize( frameWidth ) != frameBuffers.width || scaledSize( frameHeight ) != frameBuffers.height )
+            resizeBackBuffer( frameBuffers.sampleCount, frameBuffers.layout, frameBuffers.colorFormat );
+    }
+
+    void Device::setUpscaleSharpness( float value )
+    {
+        sharpness = std::clamp( value, 0.0f, 1.0f );
+    }
+
+    size_t Device::scaledSize( size_t size ) const
+    {
+        return std::max<size_t>( 1,
+                                 static_cast<size_t>( std::lround( static_cast<float>( size ) * renderScaleValue ) ) );
+    }
+
+    void Device::resizeBackBuffer( uint32_t samples, SurfaceLayout layout, SurfaceFormat format )
+    {
+        if( target == &frameBuffers )
+            discardVisibilityBuffer();
+        // Содержимое пересозданного буфера не совпадает с прошлым кадром
+        previousValid = false;
+        // Векторы при уменьшении не перераспределяются, поэтому частая смена масштаба не аллоцирует
+        frameBuffers.resize( scaledSize( frameWidth ), scaledSize( frameHeight ), omStage.clearColor(),
+                             omStage.depthClearValue(), samples, layout, format );
+    }
+
+    void Device::upscaleToOutput( void *pixels, int pitch, const SDL_PixelFormatDetails *pf )
+    {
+        const size_t srcW = frameBuffers.width;
+        const size_t srcH = frameBuffers.height;
+        const glm::vec4 *src = frameBuffers.colorBuffer.data();
+        auto *row = static_cast<std::uint8_t *>( pixels );
+        if( frameBuffers.layout != SurfaceLayout::Linear || frameBuffers.isHalfColor() )
+        {
+            // Тайловый задний буфер переводится в построчный порядок одним проходом, RGBA16F — во float
+            linearScratch.resize( srcW * srcH );
+            for( size_t y = 0; y < srcH; ++y )
+                frameBuffers.readColorRow( y, linearScratch.data() + y * srcW );
+            src = linearScratch.data();
+        }
+
+        if( srcW == frameWidth && srcH == frameHeight )
+        {
+            // Пишем построчно с учётом pitch
+            for( size_t y = 0; y < frameHeight; ++y )
+            {
+                auto *dst32 = reinterpret_cast<std::uint32_t *>( row );
+                const size_t base = y * frameWidth;
+                for( size_t x = 0; x < frameWidth; ++x )
+                    dst32[x] = vec4ColorToRGBA8( src[base + x], pf );
+                row += pitch;
+            }
+            return;
+        }
+
+        // Резкость до растяжения, во внутреннем разрешении (дешевле): c + k * (4c - n - s - w - e) / 4,
+        // с ограничением минимумом/максимумом креста, чтобы на контрастных рёбрах не было ореолов
+        if( sharpness > 0.0f )
+        {
+            sharpenScratch.resize( srcW * srcH );
+            const float k = sharpness;
+            for( size_t y = 0; y < srcH; ++y )
+            {
+                const size_t yn = y > 0 ? y - 1 : 0;
+                const size_t ys = y + 1 < srcH ? y + 1 : y;
+                for( size_t x = 0; x < srcW; ++x )
+                {
+                    const size_t xw = x > 0 ? x - 1 : 0;
+                    const size_t xe = x + 1 < srcW ? x + 1 : x;
+                    const glm::vec4 c = src[y * srcW + x];
+                    const glm::vec4 n = src[yn * srcW + x];
+                    const glm::vec4 s = src[ys * srcW + x];
+                    const glm::vec4 w = src[y * srcW + xw];
+                    const glm::vec4 e = src[y * srcW + xe];
+                    const glm::vec4 mn = glm::min( glm::min( glm::min( n, s ), glm::min( w, e ) ), c );
+                    const glm::vec4 mx = glm::max( glm::max( glm::max( n, s ), glm::max( w, e ) ), c );
+                    const glm::vec4 sharp = c + ( c * 4.0f - n - s - w - e ) * ( 0.25f * k );
+                    sharpenScratch[y * srcW + x] = glm::clamp( sharp, mn, mx );
+                }
+            }
+            src = sharpenScratch.data();
+        }
+
+        // Билинейное растяжение: центры пикселей кадра проецируются в центры пикселей заднего буфера
+        const float scaleX = static_cast<float>( srcW ) / static_cast<float>( frameWidth );
+        const float scaleY = static_cast<float>( srcH ) / static_cast<float>( frameHeight );
+        auto footprint = []( size_t dst, float scale, size_t srcSize, size_t &i0, size_t &i1, float &t ) {
+            float f = ( static_cast<float>( dst ) + 0.5f ) * scale - 0.5f;
+            f = std::clamp( f, 0.0f, static_cast<float>( srcSize - 1 ) );
+            i0 = static_cast<size_t>( f );
+            i1 = std::min( i0 + 1, srcSize - 1 );
+            t = f - static_cast<float>( i0 );
+        };
+        for( size_t y = 0; y < frameHeight; ++y )
+        {
+            size_t y0, y1;
+            float ty;
+            footprint( y, scaleY, srcH, y0, y1, ty );
+            const glm::vec4 *r0 = src + y0 * srcW;
+            const glm::vec4 *r1 = src + y1 * srcW;
+            auto *dst32 = reinterpret_cast<std::uint32_t *>( row );
+            for( size_t x = 0; x < frameWidth; ++x )
+            {
+                size_t x0, x1;
+                float tx;
+                footprint( x, scaleX, srcW, x0, x1, tx );
+                const glm::vec4 top = glm::mix( r0[x0], r0[x1], tx );
+                const glm::vec4 bottom = glm::mix( r1[x0], r1[x1], tx );
+                dst32[x] = vec4ColorToRGBA8( glm::mix( top, bottom, ty ), pf );
+            }
+            row += pitch;
+        }
     }
 
     // Заглушки стадий (интерфейсные методы) — реализации по мере развития
@@ -145,44 +435,55 @@ namespace swr
         */
         assert( renderer != nullptr );
         assert( texture != nullptr );
-        assert( frameWidth * frameHeight == frameBuffers.colorBuffer.size() );
+        assert( frameBuffers.width * frameBuffers.height <= frameBuffers.pixelCount() );
+
+        endFrame();
+        // MSAA: сэмплы усредняются в colorBuffer (сжатые пиксели просто копируются)
+        frameBuffers.resolve();
 
         static const SDL_PixelFormatDetails *pf = SDL_GetPixelFormatDetails( SDL_PIXELFORMAT_RGBA8888 );
-        auto vec4ColorToRGBA8 = []( const glm::vec4 &color, const SDL_PixelFormatDetails *pfmt ) -> std::uint32_t {
-            std::uint32_t r = static_cast<std::uint32_t>( glm::clamp( color.r, 0.0f, 1.0f ) * 255.0f );
-            std::uint32_t g = static_cast<std::uint32_t>( glm::clamp( color.g, 0.0f, 1.0f ) * 255.0f );
-            std::uint32_t b = static_cast<std::uint32_t>( glm::clamp( color.b, 0.0f, 1.0f ) * 255.0f );
-            std::uint32_t a = static_cast<std::uint32_t>( glm::clamp( color.a, 0.0f, 1.0f ) * 255.0f );
-            // Pack using masks/shifts from pixel format details
-            return ( ( r << pfmt->Rshift ) & pfmt->Rmask ) | ( ( g << pfmt->Gshift ) & pfmt->Gmask ) |
-                   ( ( b << pfmt->Bshift ) & pfmt->Bmask ) | ( ( a << pfmt->Ashift ) & pfmt->Amask );
-        };
 
         size_t width = frameWidth;
         size_t height = frameHeight;
-        // Обновление текстуры через Lock/Unlock без доп. аллокаций
+        // Инкрементальный кадр в ту же текстуру: выгружаются только перерисованные прямоугольники
+        // (задний буфер в этом режиме в разрешении кадра), кадр без изменений не выгружается вовсе
+        const bool partial = !uploadAll && texture == presentedTexture;
+        uploadAll = true;
+        presentedTexture = texture;
+        for( size_t i = 0; partial && i < dirtyRects.size(); ++i )
         {
-            TextureLock lock( texture );
+            const PixelRect &r = dirtyRects[i];
+            const SDL_Rect rect{ r.minX, r.minY, r.maxX - r.minX + 1, r.maxY - r.minY + 1 };
+            TextureLock lock( texture, &rect );
             if( !lock.ok )
             {
                 std::cerr << "SDL_LockTexture failed: " << SDL_GetError() << std::endl;
                 return;
             }
-            assert( lock.pixels != nullptr );
-            assert( lock.pitch >= static_cast<int>( width ) * 4 );
-
-            // Пишем построчно с учётом pitch
             auto *row = static_cast<std::uint8_t *>( lock.pixels );
-            for( size_t y = 0; y < height; ++y )
+            for( int y = r.minY; y <= r.maxY; ++y, row += lock.pitch )
             {
                 auto *dst32 = reinterpret_cast<std::uint32_t *>( row );
-                const size_t base = y * width;
-                for( size_t x = 0; x < width; ++x )
+                for( int x = r.minX; x <= r.maxX; ++x )
                 {
-                    dst32[x] = vec4ColorToRGBA8( frameBuffers.colorBuffer[base + x], pf );
+                    const size_t index = frameBuffers.pixelIndex( static_cast<size_t>( x ), static_cast<size_t>( y ) );
+                    dst32[x - r.minX] = vec4ColorToRGBA8( frameBuffers.loadColor( index ), pf );
                 }
-                row += lock.pitch;
             }
+        }
+        // Обновление текстуры через Lock/Unlock без доп. аллокаций
+        if( !partial )
+        {
+            TextureLock lock( texture );
+            if( !lock.ok )
+            {
+                std::cerr << "SDL_LockTexture failed: " << SDL_GetError() << std::endl;
+                return;
+            }
+            assert( lock.pixels != nullptr );
+            assert( lock.pitch >= static_cast<int>( width ) * 4 );
+
+            upscaleToOutput( lock.pixels, lock.pitch, pf );
             // lock выходит из области видимости здесь и вызывает SDL_UnlockTexture
         }
 
@@ -196,12 +497,118 @@ namespace swr
         SDL_RenderPresent( renderer );
     }
 
+    void Device::beginFrame()
+    {
+        // Кадр без endFrame дорисовывается сразу.
+        // Отложенные draw ссылаются на страницы кольца констант — разрешаем их до переиспользования страниц
+        if( recording )
+            stopRecording();
+        flushVisibilityBuffer();
+        frameArena.reset();
+        constantPage = 0;
+        constantOffset = 0;
+        constantBytes = 0;
+        stats = PipelineStatistics{};
+
+        recording = incrementalMode && target == &frameBuffers && !frameBuffers.isMultisampled() &&
+                    frameBuffers.width == frameWidth && frameBuffers.height == frameHeight;
+        if( !recording )
+            previousValid = false;
+        frameCleared = false;
+        recordedCount = 0;
+        uploadAll = true;
+
+        // Захват, начатый в кадре без endFrame, завершается на его границе
+        if( capture )
+            finishCapture();
+        else if( !capturePath.empty() )
+            beginCapture();
+    }
+
+    ConstantAllocation Device::allocateConstants( size_t bytes )
+    {
+        const size_t size = ( std::max<size_t>( bytes, 1 ) + kConstantAlignment - 1 ) & ~( kConstantAlignment - 1 );
+        BufferOptions options;
+        options.zeroInitialize = false;
+        constantBytes += size;
+        if( size > kConstantPageSize )
+        {
+            // Крупный блок не делит страницу с остальными и освобождается вместе с последней привязкой
+            auto buffer = createBuffer( 1, size, BufferFormat::Unknown, options );
+            void *data = buffer->data();
+            return { data, { std::move( buffer ), 0, true, size } };
+        }
+        if( constantPage < constantPages.size() && constantOffset + size > kConstantPageSize )
+        {
+            ++constantPage;
+            constantOffset = 0;
+        }
+        if( constantPage == constantPages.size() )
+            constantPages.push_back( createBuffer( 1, kConstantPageSize, BufferFormat::Unknown, options ) );
+        const std::shared_ptr<Buffer> &page = constantPages[constantPage];
+        const size_t offset = constantOffset;
+        constantOffset += size;
+        return { static_cast<uint8_t *>( page->data() ) + offset, { page, offset, true, size } };
+    }
+
     void Device::clear()
     {
+        if( capture )
+            captureClear();
         auto clearColor = omStage.clearColor();
         auto clearDepth = omStage.depthClearValue();
-        std::fill( frameBuffers.colorBuffer.begin(), frameBuffers.colorBuffer.end(), clearColor );
-        std::fill( frameBuffers.depthBuffer.begin(), frameBuffers.depthBuffer.end(), clearDepth );
+        // Инкрементальный кадр: clear до первого draw выполняется только в перерисовываемых тайлах
+        if( recording )
+        {
+            if( recordedCount == 0 )
+            {
+                recordedClearColor = clearColor;
+                recordedClearDepth = clearDepth;
+                frameCleared = true;
+                return;
+            }
+            stopRecording();
+        }
+        // Отложенное затенение всё равно было бы перезаписано
+        discardVisibilityBuffer();
+        target->clear( clearColor, clearDepth );
+        for( RenderSurface *surface : viewSurfaces )
+        {
+            if( surface && surface != target )
+                surface->clear( clearColor, clearDepth );
+        }
+    }
+
+    // Число покрытых сэмплов в маске
+    static inline uint32_t countSamples( uint32_t mask )
+    {
+        uint32_t n = 0;
+        for( ; mask; mask &= mask - 1 )
+            ++n;
+        return n;
+    }
+
+    // Тест глубины: d — глубина фрагмента, stored — значение в буфере
+    static inline bool depthTest( DepthFunc func, float d, float stored )
+    {
+        switch( func )
+        {
+        case DepthFunc::Never:
+            return false;
+        case DepthFunc::Less:
+            return d < stored;
+        case DepthFunc::LessEqual:
+            return d <= stored;
+        case DepthFunc::Equal:
+            return d == stored;
+        case DepthFunc::GreaterEqual:
+            return d >= stored;
+        case DepthFunc::Greater:
+            return d > stored;
+        case DepthFunc::Always:
+            return true;
+        }
+        return false;
     }
 
     // Вычисление ориентированной площади треугольника из которой берутся барицентрические координаты
@@ -210,143 +617,877 @@ namespace swr
         return ( c.x - a.x ) * ( b.y - a.y ) - ( c.y - a.y ) * ( b.x - a.x );
     }
 
-    void Device::draw( size_t vertexCount, size_t startVertexLocation )
+    // fp16-варьинги: упаковка вершины после VS и обратно
+    static inline PackedVSOutput packVertex( const VSOutput &v )
     {
-        // IA - забираем VB
-        if( iaStage.primitiveTopology != PrimitiveTopology::TriangleList )
-        {
-            assert( false && "Unsupported primitive topology" );
-            return;
-        }
-        auto vb = iaStage.vertexBuffer;
-        if( !vb )
+        PackedVSOutput p;
+        p.position = v.position;
+        p.texcoord = v.texcoord;
+        p.color = packHalf4( glm::vec4( v.color, 0.0f ) );
+        return p;
+    }
+
+    static inline VSOutput unpackVertex( const PackedVSOutput &p )
+    {
+        VSOutput v;
+        v.position = p.position;
+        v.color = glm::vec3( unpackHalf4( p.color ) );
+        v.texcoord = p.texcoord;
+        return v;
+    }
+
+    void Device::setVisibilityBuffer( bool enable )
+    {
+        if( !enable )
+            flushVisibilityBuffer();
+        visibilityMode = enable;
+    }
+
+    bool Device::beginDeferredDraw()
+    {
+        if( !visibilityMode )
+            return false;
+        // Буфер видимости один, на цель OM: вид со своей целью растеризуется прямым путём
+        for( RenderSurface *surface : viewSurfaces )
         {
-            assert( false && "No vertex buffer set" );
-            return;
+            if( surface && surface != target )
+            {
+                flushVisibilityBuffer();
+                return false;
+            }
         }
-        auto layout = iaStage.inputLayout;
-        if( !layout )
+        const BlendState &blend = omStage.blend;
+        const DepthState &depth = omStage.depth;
+        // Без записи цвета откладывать нечего, а глубина отложенных draw в буфере уже актуальна.
+        // Draw, пишущий глубину (Z-prepass, карта теней), может закрыть отложенные пиксели, поэтому
+        // они разрешаются до него; обычно проход глубины идёт первым и разрешать нечего
+        if( !colorWriteEnabled() )
         {
-            assert( false && "No input layout set" );
-            return;
+            if( depth.depthEnable && depth.depthWrite )
+                flushVisibilityBuffer();
+            return false;
         }
-        if( !vsStage.vertexShader )
+        // Отложить можно только непрозрачный draw, для которого видимость определяется ближайшей глубиной
+        const bool deferrable = !target->isMultisampled() && blend.mode == BlendMode::Opaque &&
+                                ( blend.writeMask & ColorWriteAll ) == ColorWriteAll && depth.depthEnable &&
+                                depth.depthWrite &&
+                                ( depth.func == DepthFunc::Less || depth.func == DepthFunc::LessEqual );
+        if( !deferrable )
         {
-            assert( false && "No vertex shader set" );
-            return;
+            flushVisibilityBuffer();
+            return false;
         }
 
-        const uint8_t *vertexData = static_cast<const uint8_t *>( vb->data() );
-        size_t stride = layout->stride();
-
-        // VS - трансформируем вершины прогоняя их через шейдер
-        std::vector<VSOutput> vsOut( vertexCount );
-        ShaderContext ctx( vsStage.constantBuffers, psStage.constantBuffers );
+        if( visTriangles.empty() && visibilityIds.size() != target->pixelCount() )
+            visibilityIds.assign( target->pixelCount(), kNoTriangle );
+
+        if( visDrawCount == visDraws.size() )
+            visDraws.emplace_back();
+        DeferredDraw &d = visDraws[visDrawCount++];
+        d.pixelShader = psStage.pixelShader;
+        copyConstantBuffers( vsStage.constantBuffers, d.vsConstantBuffers );
+        copyConstantBuffers( psStage.constantBuffers, d.psConstantBuffers );
+        d.textures = psStage.textures;
+        d.samplers = psStage.samplers;
+        return true;
+    }
 
-        for( size_t i = 0; i < vertexCount; ++i )
+    void Device::copyConstantBuffers( const std::vector<ConstantBinding> &src, std::vector<ConstantBinding> &dst )
+    {
+        // Сцены обновляют один и тот же константный буфер между draw, поэтому ссылки недостаточно.
+        // Копии остаются в слоте visDraws и перезаписываются на месте, пока совпадает размер.
+        // Участок кольца констант до конца кадра не меняется — достаточно самой привязки
+        dst.resize( src.size() );
+        for( size_t i = 0; i < src.size(); ++i )
         {
-            const uint8_t *vertexBytes = vertexData + ( startVertexLocation + i ) * stride;
-            VertexInputView inputView( vertexBytes, layout.get() );
-            vsOut[i] = vsStage.vertexShader( inputView, ctx );
+            if( !src[i] || src[i].transient )
+            {
+                dst[i] = src[i];
+                continue;
+            }
+            const Buffer &from = *src[i].buffer;
+            if( !dst[i] || dst[i].transient || dst[i].buffer->elementSize() != from.elementSize() ||
+                dst[i].buffer->elementCount() != from.elementCount() )
+            {
+                BufferOptions options;
+                options.zeroInitialize = false;
+                dst[i].buffer = createBuffer( from.elementSize(), from.elementCount(), from.format(), options );
+                dst[i].transient = false;
+            }
+            dst[i].offset = src[i].offset;
+            std::memcpy( dst[i].buffer->data(), from.data(), from.sizeInBytes() );
         }
+    }
 
-        // Primitive assembly: triangle list, растеризация каждого треугольника
-        for( size_t i = 0; i + 2 < vertexCount; i += 3 )
+    void Device::flushVisibilityBuffer()
+    {
+        // Второй проход: PS ровно один раз на пиксель, оставшийся видимым после всех отложенных draw.
+        // Барицентрики восстанавливаются из сохранённой установки треугольника в центре пикселя
+        for( int y = visMinY; y <= visMaxY; ++y )
         {
-            rasterizeTri( vsOut[i], vsOut[i + 1], vsOut[i + 2], ctx );
+            for( int x = visMinX; x <= visMaxX; ++x )
+            {
+                const size_t fbIndex = target->pixelIndex( static_cast<size_t>( x ), static_cast<size_t>( y ) );
+                const uint32_t triId = visibilityIds[fbIndex];
+                if( triId == kNoTriangle )
+                    continue;
+                visibilityIds[fbIndex] = kNoTriangle;
+
+                const TriangleSetup &tri = visTriangles[triId];
+                const DeferredDraw &d = visDraws[tri.drawId];
+                const glm::vec2 p( static_cast<float>( x ) + 0.5f, static_cast<float>( y ) + 0.5f );
+                const glm::vec3 w = barycentricAt( tri, p );
+                const float denom = glm::dot( w, tri.invWv );
+                const float depth = glm::dot( w, tri.zv );
+                ShaderContext ctx( d.vsConstantBuffers, d.psConstantBuffers, d.textures, d.samplers );
+                ctx.view = tri.view;
+                ++stats.psInvocations;
+                target->storeColor( fbIndex, d.pixelShader( interpolate( tri, w, denom, depth ), ctx ) );
+            }
         }
+        visMaxX = visMaxY = -1;
+        discardVisibilityBuffer();
     }
 
-    void Device::drawIndexed( size_t indexCount, size_t startIndexLocation, size_t baseVertexLocation )
+    void Device::discardVisibilityBuffer()
     {
-        if( iaStage.primitiveTopology != PrimitiveTopology::TriangleList )
+        for( int y = visMinY; y <= visMaxY; ++y )
         {
-            assert( false && "Unsupported primitive topology" );
-            return;
+            for( int x = visMinX; x <= visMaxX; ++x )
+                visibilityIds[target->pixelIndex( static_cast<size_t>( x ), static_cast<size_t>( y ) )] = kNoTriangle;
+        }
+        visMinX = visMinY = 0;
+        visMaxX = visMaxY = -1;
+        visTriangles.clear();
+        // Слоты visDraws остаются (с копиями константных буферов), ссылки на шейдеры и текстуры отпускаем
+        for( size_t i = 0; i < visDrawCount; ++i )
+        {
+            visDraws[i].pixelShader = nullptr;
+            visDraws[i].textures.clear();
         }
+        visDrawCount = 0;
+    }
 
-        auto vb = iaStage.vertexBuffer;
-        auto ib = iaStage.indexBuffer;
-        if( !vb || !ib )
+    void Device::setIncrementalRendering( bool enable )
+    {
+        if( !enable && recording )
+            stopRecording();
+        incrementalMode = enable;
+        previousValid = false;
+    }
+
+    void Device::endFrame()
+    {
+        if( recording )
         {
-            assert( false && "Vertex or Index buffer not set" );
-            return;
+            recording = false;
+            renderIncrementalFrame();
         }
-        auto layout = iaStage.inputLayout;
-        if( !layout )
+        flushVisibilityBuffer();
+        if( capture )
+            finishCapture();
+    }
+
+    bool Device::recordDraw( bool indexed, size_t count, size_t instanceCount, size_t start, int32_t baseVertex,
+                             size_t startInstance )
+    {
+        if( !recording )
+            return false;
+        // Draw без clear рисует поверх прошлого кадра, предикат и запрос читают результат в том же кадре
+        if( !frameCleared || predicate || activeQuery || !viewDescs.empty() || target != &frameBuffers )
         {
-            assert( false && "No input layout set" );
-            return;
+            stopRecording();
+            return false;
         }
-        if( !vsStage.vertexShader )
+        if( recordedCount == recordedDraws.size() )
+            recordedDraws.emplace_back( iaStage, vsStage, rsStage, psStage, omStage );
+        RecordedDraw &r = recordedDraws[recordedCount++];
+        r.indexed = indexed;
+        r.count = count;
+        r.instanceCount = instanceCount;
+        r.start = start;
+        r.baseVertex = baseVertex;
+        r.startInstance = startInstance;
+        r.ia = iaStage;
+        r.vs = vsStage;
+        r.rs = rsStage;
+        r.ps = psStage;
+        r.om = omStage;
+        r.halfVaryings = halfVaryingsMode;
+        snapshotConstants( vsStage.constantBuffers, r.vsConstants );
+        snapshotConstants( psStage.constantBuffers, r.psConstants );
+        r.vertexVersion = iaStage.vertexBuffer->version();
+        r.indexVersion = indexed ? iaStage.indexBuffer->version() : 0;
+        r.textureVersions.resize( psStage.textures.size() );
+        for( size_t i = 0; i < psStage.textures.size(); ++i )
+            r.textureVersions[i] = psStage.textures[i] ? psStage.textures[i]->version() : 0;
+        r.bounds = kEmptyRect;
+        return true;
+    }
+
+    void Device::snapshotConstants( const std::vector<ConstantBinding> &src, std::vector<ConstantBinding> &dst )
+    {
+        dst.resize( src.size() );
+        for( size_t i = 0; i < src.size(); ++i )
         {
-            assert( false && "No vertex shader set" );
-            return;
+            if( !src[i] )
+            {
+                dst[i] = ConstantBinding{};
+                continue;
+            }
+            // У участка кольца копируется только он сам, у буфера — весь буфер (смещение сохраняется)
+            const size_t bytes = src[i].transient ? src[i].size : src[i].buffer->sizeInBytes();
+            const size_t from = src[i].transient ? src[i].offset : 0;
+            if( !dst[i] || dst[i].buffer->sizeInBytes() != bytes )
+            {
+                BufferOptions options;
+                options.zeroInitialize = false;
+                dst[i].buffer = createBuffer( 1, std::max<size_t>( bytes, 1 ), BufferFormat::Unknown, options );
+            }
+            dst[i].offset = src[i].transient ? 0 : src[i].offset;
+            dst[i].transient = false;
+            dst[i].size = 0;
+            std::memcpy( dst[i].buffer->data(), static_cast<const uint8_t *>( src[i].buffer->data() ) + from, bytes );
         }
+    }
 
-        // Поддерживаем форматы индексов R16_UINT и R32_UINT
-        BufferFormat idxFmt = ib->format();
-        size_t idxElemSize = ib->elementSize();
-        if( !( ( idxFmt == BufferFormat::R16_UINT && idxElemSize == 2 ) ||
-               ( idxFmt == BufferFormat::R32_UINT && idxElemSize == 4 ) ) )
+    void Device::stopRecording()
+    {
+        recording = false;
+        previousValid = false;
+        // Записанное выполняется в порядке вызовов, как без инкрементального режима
+        if( frameCleared )
         {
-            assert( false && "Unsupported index buffer format/elementSize" );
-            return;
+            discardVisibilityBuffer();
+            frameBuffers.clear( recordedClearColor, recordedClearDepth );
         }
+        for( size_t i = 0; i < recordedCount; ++i )
+            executeRecorded( recordedDraws[i], true );
+        recordedCount = 0;
+    }
 
-        const uint8_t *idxBytes = static_cast<const uint8_t *>( ib->data() );
-        const uint8_t *vertexData = static_cast<const uint8_t *>( vb->data() );
-        size_t stride = layout->stride();
-        ShaderContext ctx( vsStage.constantBuffers, psStage.constantBuffers );
+    void Device::executeRecorded( RecordedDraw &draw, bool deferrable )
+    {
+        // Состояние записи подменяет текущее на время draw, константы — копиями
+        auto swapStages = [&]() {
+            std::swap( iaStage, draw.ia );
+            std::swap( vsStage, draw.vs );
+            std::swap( rsStage, draw.rs );
+            std::swap( psStage, draw.ps );
+            std::swap( omStage, draw.om );
+            std::swap( halfVaryingsMode, draw.halfVaryings );
+        };
+        auto swapConstants = [&]() {
+            vsStage.constantBuffers.swap( draw.vsConstants );
+            psStage.constantBuffers.swap( draw.psConstants );
+        };
+        swapStages();
+        swapConstants();
+        drawBounds = &draw.bounds;
 
-        // Идём по тройкам индексов
-        for( size_t i = 0; i + 2 < indexCount; i += 3 )
+        ShaderContext ctx = makeShaderContext();
+        const bool deferred = deferrable && beginDeferredDraw();
+        for( size_t k = 0; k < draw.instanceCount; ++k )
         {
-            auto readIndex = [&]( size_t idxPos ) -> uint32_t {
-                size_t offset = ( startIndexLocation + idxPos ) * idxElemSize;
-                if( idxFmt == BufferFormat::R16_UINT )
-                {
-                    const uint16_t *p = reinterpret_cast<const uint16_t *>( idxBytes + offset );
-                    return static_cast<uint32_t>( *p );
-                }
-                else
-                {
-                    const uint32_t *p = reinterpret_cast<const uint32_t *>( idxBytes + offset );
-                    return *p;
-                }
-            };
-
-            uint32_t i0 = readIndex( i ) + static_cast<uint32_t>( baseVertexLocation );
-            uint32_t i1 = readIndex( i + 1 ) + static_cast<uint32_t>( baseVertexLocation );
-            uint32_t i2 = readIndex( i + 2 ) + static_cast<uint32_t>( baseVertexLocation );
+            ctx.instance = static_cast<uint32_t>( draw.startInstance + k );
+            if( draw.indexed )
+                drawIndices( draw.count, draw.start, static_cast<uint32_t>( draw.baseVertex ), ctx, deferred );
+            else
+                drawVertices( draw.count, draw.start, ctx, deferred );
+        }
 
-            // Выполняем VS для каждой вершины (при желании можно закэшировать)
-            const uint8_t *vBytes0 = vertexData + static_cast<size_t>( i0 ) * stride;
-            const uint8_t *vBytes1 = vertexData + static_cast<size_t>( i1 ) * stride;
-            const uint8_t *vBytes2 = vertexData + static_cast<size_t>( i2 ) * stride;
+        drawBounds = nullptr;
+        swapConstants();
+        swapStages();
+    }
 
-            VertexInputView view0( vBytes0, layout.get() );
-            VertexInputView view1( vBytes1, layout.get() );
-            VertexInputView view2( vBytes2, layout.get() );
+    static bool sameConstants( const std::vector<ConstantBinding> &a, const std::vector<ConstantBinding> &b )
+    {
+        if( a.size() != b.size() )
+            return false;
+        for( size_t i = 0; i < a.size(); ++i )
+        {
+            if( !a[i] || !b[i] )
+            {
+                if( a[i] || b[i] )
+                    return false;
+                continue;
+            }
+            const size_t bytes = a[i].buffer->sizeInBytes();
+            if( a[i].offset != b[i].offset || bytes != b[i].buffer->sizeInBytes() ||
+                std::memcmp( a[i].buffer->data(), b[i].buffer->data(), bytes ) != 0 )
+                return false;
+        }
+        return true;
+    }
 
-            VSOutput o0 = vsStage.vertexShader( view0, ctx );
-            VSOutput o1 = vsStage.vertexShader( view1, ctx );
-            VSOutput o2 = vsStage.vertexShader( view2, ctx );
+    static bool sameSampler( const SamplerState &a, const SamplerState &b )
+    {
+        return a.filter == b.filter && a.addressU == b.addressU && a.addressV == b.addressV &&
+               a.lodBias == b.lodBias && a.maxLod == b.maxLod;
+    }
 
-            rasterizeTri( o0, o1, o2, ctx );
+    bool Device::sameDraw( const RecordedDraw &a, const RecordedDraw &b )
+    {
+        if( a.indexed != b.indexed || a.count != b.count || a.instanceCount != b.instanceCount ||
+            a.start != b.start || a.baseVertex != b.baseVertex || a.startInstance != b.startInstance ||
+            a.halfVaryings != b.halfVaryings )
+            return false;
+        // IA: те же буферы с тем же содержимым
+        if( a.ia.vertexBuffer != b.ia.vertexBuffer || a.vertexVersion != b.vertexVersion ||
+            a.ia.inputLayout != b.ia.inputLayout || a.ia.primitiveTopology != b.ia.primitiveTopology ||
+            ( a.indexed && ( a.ia.indexBuffer != b.ia.indexBuffer || a.indexVersion != b.indexVersion ) ) )
+            return false;
+        if( a.vs.shaderSerial != b.vs.shaderSerial || a.ps.shaderSerial != b.ps.shaderSerial ||
+            !sameConstants( a.vsConstants, b.vsConstants ) || !sameConstants( a.psConstants, b.psConstants ) )
+            return false;
+        const Viewport &va = a.rs.viewport, &vb = b.rs.viewport;
+        if( va.x != vb.x || va.y != vb.y || va.width != vb.width || va.height != vb.height ||
+            a.rs.cullBackface != b.rs.cullBackface || a.rs.wireframe != b.rs.wireframe )
+            return false;
+        if( a.ps.textures != b.ps.textures || a.textureVersions != b.textureVersions ||
+            a.ps.samplers.size() != b.ps.samplers.size() )
+            return false;
+        for( size_t i = 0; i < a.ps.samplers.size(); ++i )
+        {
+            if( !sameSampler( a.ps.samplers[i], b.ps.samplers[i] ) )
+                return false;
         }
+        const BlendState &ba = a.om.blend, &bb = b.om.blend;
+        const DepthState &da = a.om.depth, &db = b.om.depth;
+        return ba.mode == bb.mode && ba.writeMask == bb.writeMask && da.depthEnable == db.depthEnable &&
+               da.depthWrite == db.depthWrite && da.func == db.func;
     }
 
-    void Device::rasterizeTri( const VSOutput &v0, const VSOutput &v1, const VSOutput &v2, const ShaderContext &ctx )
+    void Device::renderIncrementalFrame()
     {
-        // Получаем viewport (если не задан, используем весь кадр)
-        Viewport vp{ 0, 0, static_cast<int>( frameWidth ), static_cast<int>( frameHeight ), 0.0f, 1.0f };
-        if( rsStage.viewport.width > 0 && rsStage.viewport.height > 0 )
-            vp = rsStage.viewport;
-        const float vpW = static_cast<float>( vp.width );
-        const float vpH = static_cast<float>( vp.height );
+        // Без clear кадр рисуется поверх прошлого, сравнивать не с чем
+        if( !frameCleared )
+        {
+            stopRecording();
+            return;
+        }
+        const int width = static_cast<int>( frameBuffers.width );
+        const int height = static_cast<int>( frameBuffers.height );
+        const int tilesX = ( width + kDirtyTileSize - 1 ) / kDirtyTileSize;
+        const int tilesY = ( height + kDirtyTileSize - 1 ) / kDirtyTileSize;
+        const bool all = !previousValid || recordedClearColor != previousClearColor ||
+                         recordedClearDepth != previousClearDepth;
+        dirtyTiles.assign( static_cast<size_t>( tilesX ) * static_cast<size_t>( tilesY ), all ? 1 : 0 );
+        auto markDirty = [&]( const PixelRect &r ) {
+            if( r.minX > r.maxX || r.minY > r.maxY )
+                return;
+            const int tx1 = std::min( r.maxX, width - 1 ) / kDirtyTileSize;
+            const int ty1 = std::min( r.maxY, height - 1 ) / kDirtyTileSize;
+            for( int ty = std::max( r.minY, 0 ) / kDirtyTileSize; ty <= ty1; ++ty )
+            {
+                for( int tx = std::max( r.minX, 0 ) / kDirtyTileSize; tx <= tx1; ++tx )
+                    dirtyTiles[static_cast<size_t>( ty ) * tilesX + tx] = 1;
+            }
+        };
 
-        // Clip to NDC space
+        // Draw сопоставляются по порядку. Изменившийся draw портит тайлы в прежнем положении и в новом,
+        // которое узнаётся прогоном VS и установки треугольников с пустым прямоугольником перерисовки
+        if( !all )
+        {
+            for( size_t i = 0; i < std::max( recordedCount, previousCount ); ++i )
+            {
+                if( i >= recordedCount )
+                {
+                    markDirty( previousDraws[i].bounds );
+                    continue;
+                }
+                RecordedDraw &draw = recordedDraws[i];
+                if( i < previousCount && sameDraw( draw, previousDraws[i] ) )
+                {
+                    draw.bounds = previousDraws[i].bounds;
+                    continue;
+                }
+                if( i < previousCount )
+                    markDirty( previousDraws[i].bounds );
+                scissor = kEmptyRect;
+                executeRecorded( draw, false );
+                markDirty( draw.bounds );
+            }
+        }
+
+        // Грязные прямоугольники очищаются и перерисовываются всеми draw, которые их касаются, по порядку
+        buildDirtyRects( tilesX, tilesY );
+        for( const PixelRect &rect : dirtyRects )
+        {
+            frameBuffers.clearRect( rect.minX, rect.minY, rect.maxX + 1, rect.maxY + 1, recordedClearColor,
+                                    recordedClearDepth );
+            scissor = rect;
+            for( size_t i = 0; i < recordedCount; ++i )
+            {
+                const PixelRect &b = recordedDraws[i].bounds;
+                const bool touches =
+                    b.minX <= rect.maxX && rect.minX <= b.maxX && b.minY <= rect.maxY && rect.minY <= b.maxY;
+                if( all || touches )
+                    executeRecorded( recordedDraws[i], true );
+            }
+            flushVisibilityBuffer();
+        }
+        scissor = kNoScissor;
+        stats.redrawnTiles += static_cast<uint64_t>( std::count( dirtyTiles.begin(), dirtyTiles.end(), 1 ) );
+
+        std::swap( recordedDraws, previousDraws );
+        previousCount = recordedCount;
+        recordedCount = 0;
+        previousClearColor = recordedClearColor;
+        previousClearDepth = recordedClearDepth;
+        previousValid = true;
+        uploadAll = all;
+    }
+
+    void Device::buildDirtyRects( int tilesX, int tilesY )
+    {
+        // Отрезки грязных тайлов строки; отрезок с теми же границами, что у прямоугольника строкой выше,
+        // продлевает его вниз
+        const int width = static_cast<int>( frameBuffers.width );
+        const int height = static_cast<int>( frameBuffers.height );
+        dirtyRects.clear();
+        for( int ty = 0; ty < tilesY; ++ty )
+        {
+            for( int tx = 0; tx < tilesX; )
+            {
+                if( !dirtyTiles[static_cast<size_t>( ty ) * tilesX + tx] )
+                {
+                    ++tx;
+                    continue;
+                }
+                const int begin = tx;
+                while( tx < tilesX && dirtyTiles[static_cast<size_t>( ty ) * tilesX + tx] )
+                    ++tx;
+                const PixelRect span{ begin * kDirtyTileSize, ty * kDirtyTileSize,
+                                      std::min( tx * kDirtyTileSize, width ) - 1,
+                                      std::min( ( ty + 1 ) * kDirtyTileSize, height ) - 1 };
+                auto above = std::find_if( dirtyRects.begin(), dirtyRects.end(), [&]( const PixelRect &r ) {
+                    return r.minX == span.minX && r.maxX == span.maxX && r.maxY + 1 == span.minY;
+                } );
+                if( above != dirtyRects.end() )
+                    above->maxY = span.maxY;
+                else
+                    dirtyRects.push_back( span );
+            }
+        }
+        // Много мелких прямоугольников дороже лишних пикселей: каждый заново прогоняет VS задевших его draw
+        if( dirtyRects.size() > kMaxDirtyRects )
+        {
+            PixelRect bounds = kEmptyRect;
+            for( const PixelRect &r : dirtyRects )
+            {
+                bounds.minX = std::min( bounds.minX, r.minX );
+                bounds.minY = std::min( bounds.minY, r.minY );
+                bounds.maxX = std::max( bounds.maxX, r.maxX );
+                bounds.maxY = std::max( bounds.maxY, r.maxY );
+            }
+            dirtyRects.assign( 1, bounds );
+        }
+    }
+
+    bool Device::predicatedOff()
+    {
+        if( !predicate || predicate->active || predicate->anySamplesPassed() != predicateValue )
+            return false;
+        ++stats.predicatedDraws;
+        return true;
+    }
+
+    bool Device::validateDraw( bool indexed ) const
+    {
+        if( iaStage.primitiveTopology != PrimitiveTopology::TriangleList )
+        {
+            assert( false && "Unsupported primitive topology" );
+            return false;
+        }
+        if( !iaStage.vertexBuffer || ( indexed && !iaStage.indexBuffer ) )
+        {
+            assert( false && "Vertex or Index buffer not set" );
+            return false;
+        }
+        if( !iaStage.inputLayout )
+        {
+            assert( false && "No input layout set" );
+            return false;
+        }
+        if( !vsStage.vertexShader )
+        {
+            assert( false && "No vertex shader set" );
+            return false;
+        }
+        if( indexed )
+        {
+            // Поддерживаем форматы индексов R16_UINT и R32_UINT
+            const BufferFormat idxFmt = iaStage.indexBuffer->format();
+            const size_t idxElemSize = iaStage.indexBuffer->elementSize();
+            if( !( ( idxFmt == BufferFormat::R16_UINT && idxElemSize == 2 ) ||
+                   ( idxFmt == BufferFormat::R32_UINT && idxElemSize == 4 ) ) )
+            {
+                assert( false && "Unsupported index buffer format/elementSize" );
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Device::draw( size_t vertexCount, size_t startVertexLocation )
+    {
+        drawInstanced( vertexCount, 1, startVertexLocation, 0 );
+    }
+
+    void Device::drawInstanced( size_t vertexCountPerInstance, size_t instanceCount, size_t startVertexLocation,
+                                size_t startInstanceLocation )
+    {
+        if( predicatedOff() || !validateDraw( false ) )
+            return;
+        if( capture )
+            captureDraw( false, vertexCountPerInstance, instanceCount, startVertexLocation, 0, startInstanceLocation );
+        if( recordDraw( false, vertexCountPerInstance, instanceCount, startVertexLocation, 0, startInstanceLocation ) )
+            return;
+        const bool deferred = beginDeferredDraw();
+        ShaderContext ctx = makeShaderContext();
+        for( size_t k = 0; k < instanceCount; ++k )
+        {
+            ctx.instance = static_cast<uint32_t>( startInstanceLocation + k );
+            drawVertices( vertexCountPerInstance, startVertexLocation, ctx, deferred );
+        }
+    }
+
+    void Device::drawVertices( size_t vertexCount, size_t startVertexLocation, const ShaderContext &ctx, bool deferred )
+    {
+        const InputLayout *layout = iaStage.inputLayout.get();
+        const uint8_t *vertexData = static_cast<const uint8_t *>( iaStage.vertexBuffer->data() );
+        size_t stride = layout->stride();
+
+        // VS - трансформируем вершины прогоняя их через шейдер.
+        // Результаты нужны только до конца draw, поэтому память арены возвращается на выходе.
+        // При fp16-варьингах вершины хранятся упакованными
+        LinearArena &arena = frameArena.forThread( 0 );
+        ArenaScope scope( arena );
+        VSOutput *vsOut = nullptr;
+        PackedVSOutput *packedOut = nullptr;
+        if( halfVaryingsMode )
+            packedOut = arena.allocate<PackedVSOutput>( vertexCount );
+        else
+            vsOut = arena.allocate<VSOutput>( vertexCount );
+
+        for( size_t i = 0; i < vertexCount; ++i )
+        {
+            const uint8_t *vertexBytes = vertexData + ( startVertexLocation + i ) * stride;
+            VertexInputView inputView( vertexBytes, layout );
+            if( packedOut )
+                packedOut[i] = packVertex( vsStage.vertexShader( inputView, ctx ) );
+            else
+                vsOut[i] = vsStage.vertexShader( inputView, ctx );
+        }
+        stats.vsInvocations += vertexCount;
+
+        // Primitive assembly: triangle list, растеризация каждого треугольника
+        for( size_t i = 0; i + 2 < vertexCount; i += 3 )
+        {
+            if( packedOut )
+                assembleTri( unpackVertex( packedOut[i] ), unpackVertex( packedOut[i + 1] ),
+                             unpackVertex( packedOut[i + 2] ), ctx, deferred );
+            else
+                assembleTri( vsOut[i], vsOut[i + 1], vsOut[i + 2], ctx, deferred );
+        }
+    }
+
+    void Device::drawIndexed( size_t indexCount, size_t startIndexLocation, size_t baseVertexLocation )
+    {
+        drawIndexedInstanced( indexCount, 1, startIndexLocation, static_cast<int32_t>( baseVertexLocation ), 0 );
+    }
+
+    void Device::drawIndexedInstanced( size_t indexCountPerInstance, size_t instanceCount, size_t startIndexLocation,
+                                       int32_t baseVertexLocation, size_t startInstanceLocation )
+    {
+        if( predicatedOff() || !validateDraw( true ) )
+            return;
+        if( capture )
+            captureDraw( true, indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation,
+                         startInstanceLocation );
+        if( recordDraw( true, indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation,
+                        startInstanceLocation ) )
+            return;
+        ShaderContext ctx = makeShaderContext();
+        const bool deferred = beginDeferredDraw();
+        for( size_t k = 0; k < instanceCount; ++k )
+        {
+            ctx.instance = static_cast<uint32_t>( startInstanceLocation + k );
+            drawIndices( indexCountPerInstance, startIndexLocation, static_cast<uint32_t>( baseVertexLocation ), ctx,
+                         deferred );
+        }
+    }
+
+    void Device::drawIndices( size_t indexCount, size_t startIndexLocation, uint32_t baseVertex,
+                              const ShaderContext &ctx, bool deferred )
+    {
+        const InputLayout *layout = iaStage.inputLayout.get();
+        const Buffer &ib = *iaStage.indexBuffer;
+        const BufferFormat idxFmt = ib.format();
+        const size_t idxElemSize = ib.elementSize();
+        const uint8_t *idxBytes = static_cast<const uint8_t *>( ib.data() );
+        const uint8_t *vertexData = static_cast<const uint8_t *>( iaStage.vertexBuffer->data() );
+        size_t stride = layout->stride();
+
+        // Пост-трансформ кэш вершин (FIFO, как в GPU): повторные индексы не прогоняются через VS.
+        // Эффективность зависит от порядка треугольников — см. swrMeshOptimizer.
+        // При fp16-варьингах в кэше упакованные вершины, как и в draw.
+        // Кэш живёт один экземпляр: выход VS зависит от instanceId
+        uint32_t cacheTags[kVertexCacheSize];
+        VSOutput cacheData[kVertexCacheSize];
+        PackedVSOutput packedCache[kVertexCacheSize];
+        size_t cacheHead = 0;
+        std::fill( std::begin( cacheTags ), std::end( cacheTags ), UINT32_MAX );
+
+        auto shadeVertex = [&]( uint32_t index ) -> VSOutput {
+            for( size_t k = 0; k < kVertexCacheSize; ++k )
+            {
+                if( cacheTags[k] == index )
+                    return halfVaryingsMode ? unpackVertex( packedCache[k] ) : cacheData[k];
+            }
+            const uint8_t *vBytes = vertexData + static_cast<size_t>( index ) * stride;
+            VertexInputView view( vBytes, layout );
+            size_t slot = cacheHead;
+            cacheHead = ( cacheHead + 1 ) % kVertexCacheSize;
+            cacheTags[slot] = index;
+            ++stats.vsInvocations;
+            if( halfVaryingsMode )
+            {
+                packedCache[slot] = packVertex( vsStage.vertexShader( view, ctx ) );
+                return unpackVertex( packedCache[slot] );
+            }
+            cacheData[slot] = vsStage.vertexShader( view, ctx );
+            return cacheData[slot];
+        };
+
+        // Идём по тройкам индексов
+        for( size_t i = 0; i + 2 < indexCount; i += 3 )
+        {
+            auto readIndex = [&]( size_t idxPos ) -> uint32_t {
+                size_t offset = ( startIndexLocation + idxPos ) * idxElemSize;
+                if( idxFmt == BufferFormat::R16_UINT )
+                {
+                    const uint16_t *p = reinterpret_cast<const uint16_t *>( idxBytes + offset );
+                    return static_cast<uint32_t>( *p );
+                }
+                else
+                {
+                    const uint32_t *p = reinterpret_cast<const uint32_t *>( idxBytes + offset );
+                    return *p;
+                }
+            };
+
+            // Отрицательный baseVertex работает через переполнение uint32
+            uint32_t i0 = readIndex( i ) + baseVertex;
+            uint32_t i1 = readIndex( i + 1 ) + baseVertex;
+            uint32_t i2 = readIndex( i + 2 ) + baseVertex;
+
+            // Копии, а не ссылки: промах по i1/i2 может вытеснить слот i0
+            VSOutput o0 = shadeVertex( i0 );
+            VSOutput o1 = shadeVertex( i1 );
+            VSOutput o2 = shadeVertex( i2 );
+
+            assembleTri( o0, o1, o2, ctx, deferred );
+        }
+    }
+
+    // Указатель на count записей аргументов размера recordSize с шагом stride; выход за буфер — исключение
+    static const uint8_t *indirectArgs( const std::shared_ptr<Buffer> &args, size_t byteOffset, size_t count,
+                                        size_t stride, size_t recordSize )
+    {
+        if( !args )
+            throw std::invalid_argument( "Indirect draw: argument buffer is null" );
+        if( stride < recordSize )
+            throw std::invalid_argument( "Indirect draw: stride is smaller than the argument record" );
+        const size_t size = args->sizeInBytes();
+        if( count > 0 && ( byteOffset > size || size - byteOffset < recordSize ||
+                           ( size - byteOffset - recordSize ) / stride < count - 1 ) )
+            throw std::out_of_range( "Indirect draw: arguments are outside of the buffer" );
+        return static_cast<const uint8_t *>( args->data() ) + byteOffset;
+    }
+
+    // Все вершины, которые выберет drawIndices (индекс + baseVertex), лежат в [0, vertexCount).
+    // Неполный последний треугольник не выбирается и не проверяется
+    static bool indicesFitVertices( const Buffer &ib, size_t start, size_t count, int32_t baseVertex,
+                                    size_t vertexCount )
+    {
+        count -= count % 3;
+        if( count == 0 )
+            return true;
+        const uint8_t *bytes = static_cast<const uint8_t *>( ib.data() ) + start * ib.elementSize();
+        uint32_t minIndex = UINT32_MAX, maxIndex = 0;
+        for( size_t i = 0; i < count; ++i )
+        {
+            const uint32_t index = ib.format() == BufferFormat::R16_UINT
+                                       ? reinterpret_cast<const uint16_t *>( bytes )[i]
+                                       : reinterpret_cast<const uint32_t *>( bytes )[i];
+            minIndex = std::min( minIndex, index );
+            maxIndex = std::max( maxIndex, index );
+        }
+        return static_cast<int64_t>( minIndex ) + baseVertex >= 0 &&
+               static_cast<int64_t>( maxIndex ) + baseVertex < static_cast<int64_t>( vertexCount );
+    }
+
+    void Device::drawIndirect( const std::shared_ptr<Buffer> &args, size_t byteOffset )
+    {
+        // Аргументы косвенного draw пишутся в том же кадре — инкрементальный кадр рисуется сразу
+        if( recording )
+            stopRecording();
+        DrawArguments a;
+        std::memcpy( &a, indirectArgs( args, byteOffset, 1, sizeof( a ), sizeof( a ) ), sizeof( a ) );
+        if( predicatedOff() || !validateDraw( false ) || a.instanceCount == 0 )
+            return;
+        const size_t stride = iaStage.inputLayout->stride();
+        if( ( static_cast<size_t>( a.startVertexLocation ) + a.vertexCountPerInstance ) * stride >
+            iaStage.vertexBuffer->sizeInBytes() )
+        {
+            assert( false && "drawIndirect: vertex range is outside of the vertex buffer" );
+            return;
+        }
+        if( capture )
+            captureDraw( false, a.vertexCountPerInstance, a.instanceCount, a.startVertexLocation, 0,
+                         a.startInstanceLocation );
+        const bool deferred = beginDeferredDraw();
+        ShaderContext ctx = makeShaderContext();
+        for( uint32_t k = 0; k < a.instanceCount; ++k )
+        {
+            ctx.instance = a.startInstanceLocation + k;
+            drawVertices( a.vertexCountPerInstance, a.startVertexLocation, ctx, deferred );
+        }
+    }
+
+    void Device::drawIndexedIndirect( const std::shared_ptr<Buffer> &args, size_t byteOffset )
+    {
+        multiDrawIndexedIndirect( args, byteOffset, 1 );
+    }
+
+    void Device::multiDrawIndexedIndirect( const std::shared_ptr<Buffer> &args, size_t byteOffset,
+                                           size_t maxDrawCount, size_t stride,
+                                           const std::shared_ptr<Buffer> &countBuffer, size_t countOffset )
+    {
+        if( recording )
+            stopRecording();
+        if( stride == 0 )
+            stride = sizeof( DrawIndexedArguments );
+        size_t drawCount = maxDrawCount;
+        if( countBuffer )
+        {
+            uint32_t count;
+            std::memcpy( &count, indirectArgs( countBuffer, countOffset, 1, sizeof( count ), sizeof( count ) ),
+                         sizeof( count ) );
+            drawCount = std::min<size_t>( drawCount, count );
+        }
+        const uint8_t *records = indirectArgs( args, byteOffset, drawCount, stride, sizeof( DrawIndexedArguments ) );
+        if( drawCount == 0 || predicatedOff() || !validateDraw( true ) )
+            return;
+
+        // Состояние общее для всех записей: один снимок PS для буфера видимости и один ShaderContext
+        const size_t indexCount = iaStage.indexBuffer->elementCount();
+        const size_t vertexCount = iaStage.vertexBuffer->sizeInBytes() / iaStage.inputLayout->stride();
+        ShaderContext ctx = makeShaderContext();
+        const bool deferred = beginDeferredDraw();
+        for( size_t d = 0; d < drawCount; ++d )
+        {
+            DrawIndexedArguments a;
+            std::memcpy( &a, records + d * stride, sizeof( a ) );
+            if( static_cast<size_t>( a.startIndexLocation ) + a.indexCountPerInstance > indexCount )
+            {
+                assert( false && "multiDrawIndexedIndirect: index range is outside of the index buffer" );
+                continue;
+            }
+            // Отрицательный baseVertex допустим, важна только итоговая вершина
+            if( !indicesFitVertices( *iaStage.indexBuffer, a.startIndexLocation, a.indexCountPerInstance,
+                                     a.baseVertexLocation, vertexCount ) )
+            {
+                assert( false && "multiDrawIndexedIndirect: fetched vertex is outside of the vertex buffer" );
+                continue;
+            }
+            if( capture )
+                captureDraw( true, a.indexCountPerInstance, a.instanceCount, a.startIndexLocation,
+                             a.baseVertexLocation, a.startInstanceLocation );
+            for( uint32_t k = 0; k < a.instanceCount; ++k )
+            {
+                ctx.instance = a.startInstanceLocation + k;
+                drawIndices( a.indexCountPerInstance, a.startIndexLocation,
+                             static_cast<uint32_t>( a.baseVertexLocation ), ctx, deferred );
+            }
+        }
+    }
+
+    void Device::assembleTri( const VSOutput &v0, const VSOutput &v1, const VSOutput &v2, const ShaderContext &ctx,
+                              bool deferred )
+    {
+        if( viewDescs.empty() )
+        {
+            rasterizeTri( v0, v1, v2, ctx, deferred );
+            return;
+        }
+        // Общие выходы VS копируются в каждый вид, меняется только позиция
+        RenderSurface *omTarget = target;
+        ShaderContext viewCtx( ctx );
+        VSOutput o0 = v0, o1 = v1, o2 = v2;
+        for( size_t v = 0; v < viewDescs.size(); ++v )
+        {
+            const glm::mat4 &viewProj = viewDescs[v].viewProj;
+            o0.position = viewProj * v0.position;
+            o1.position = viewProj * v1.position;
+            o2.position = viewProj * v2.position;
+            target = viewSurfaces[v] ? viewSurfaces[v] : omTarget;
+            currentView = static_cast<uint32_t>( v );
+            viewCtx.view = currentView;
+            rasterizeTri( o0, o1, o2, viewCtx, deferred );
+        }
+        target = omTarget;
+        currentView = 0;
+    }
+
+    const Viewport &Device::activeViewport() const
+    {
+        if( !viewDescs.empty() )
+        {
+            // Вид со своей целью без вьюпорта занимает её целиком
+            const Viewport &vp = viewDescs[currentView].viewport;
+            if( ( vp.width > 0 && vp.height > 0 ) || viewSurfaces[currentView] )
+                return vp;
+        }
+        return rsStage.viewport;
+    }
+
+    bool Device::setupTriangle( const VSOutput &v0, const VSOutput &v1, const VSOutput &v2, TriangleSetup &tri ) const
+    {
+        // Отсечения по ближней плоскости нет: треугольник с вершиной за камерой (w <= 0) после деления
+        // на w выворачивается, поэтому отбрасывается целиком
+        if( v0.position.w <= 0.0f || v1.position.w <= 0.0f || v2.position.w <= 0.0f )
+            return false;
+        // Получаем viewport (если не задан, используем весь кадр)
+        const int targetW = static_cast<int>( target->width );
+        const int targetH = static_cast<int>( target->height );
+        Viewport vp{ 0, 0, targetW, targetH, 0.0f, 1.0f };
+        const Viewport &requested = activeViewport();
+        if( requested.width > 0 && requested.height > 0 )
+        {
+            vp = requested;
+            // Вьюпорт заднего буфера задан в пикселях кадра — переводим во внутреннее разрешение
+            if( target == &frameBuffers && ( frameBuffers.width != frameWidth || frameBuffers.height != frameHeight ) )
+            {
+                const float sx = static_cast<float>( frameBuffers.width ) / static_cast<float>( frameWidth );
+                const float sy = static_cast<float>( frameBuffers.height ) / static_cast<float>( frameHeight );
+                const int x0 = static_cast<int>( std::lround( static_cast<float>( vp.x ) * sx ) );
+                const int y0 = static_cast<int>( std::lround( static_cast<float>( vp.y ) * sy ) );
+                const int x1 = static_cast<int>( std::lround( static_cast<float>( vp.x + vp.width ) * sx ) );
+                const int y1 = static_cast<int>( std::lround( static_cast<float>( vp.y + vp.height ) * sy ) );
+                vp.x = x0;
+                vp.y = y0;
+                vp.width = std::max( x1 - x0, 1 );
+                vp.height = std::max( y1 - y0, 1 );
+            }
+        }
+        const float vpW = static_cast<float>( vp.width );
+        const float vpH = static_cast<float>( vp.height );
+
+        // Clip to NDC space
         auto p0 = glm::vec3( v0.position ) / v0.position.w;
         auto p1 = glm::vec3( v1.position ) / v1.position.w;
         auto p2 = glm::vec3( v2.position ) / v2.position.w;
@@ -362,97 +1503,657 @@ namespace swr
         glm::vec2 s2 = ndcToViewport( p2 );
 
         // Boundig box
-        int minX = static_cast<int>( glm::floor( glm::min( glm::min( s0.x, s1.x ), s2.x ) ) );
-        int maxX = static_cast<int>( glm::ceil( glm::max( glm::max( s0.x, s1.x ), s2.x ) ) );
-        int minY = static_cast<int>( glm::floor( glm::min( glm::min( s0.y, s1.y ), s2.y ) ) );
-        int maxY = static_cast<int>( glm::ceil( glm::max( glm::max( s0.y, s1.y ), s2.y ) ) );
+        const float minSx = glm::min( glm::min( s0.x, s1.x ), s2.x );
+        const float maxSx = glm::max( glm::max( s0.x, s1.x ), s2.x );
+        const float minSy = glm::min( glm::min( s0.y, s1.y ), s2.y );
+        const float maxSy = glm::max( glm::max( s0.y, s1.y ), s2.y );
+        int minX, maxX, minY, maxY;
+        if( target->isMultisampled() )
+        {
+            minX = static_cast<int>( glm::floor( minSx ) );
+            maxX = static_cast<int>( glm::ceil( maxSx ) );
+            minY = static_cast<int>( glm::floor( minSy ) );
+            maxY = static_cast<int>( glm::ceil( maxSy ) );
+        }
+        else
+        {
+            // Без MSAA покрытие проверяется только в центрах пикселей (x + 0.5): пиксель, центр которого вне
+            // прямоугольника вершин, покрыт быть не может. Узкий треугольник между центрами даёт пустой прямоугольник
+            minX = static_cast<int>( glm::ceil( minSx - 0.5f ) );
+            maxX = static_cast<int>( glm::floor( maxSx - 0.5f ) );
+            minY = static_cast<int>( glm::ceil( minSy - 0.5f ) );
+            maxY = static_cast<int>( glm::floor( maxSy - 0.5f ) );
+        }
 
-        // Отсечение по viewport прямоугольнику
-        minX = std::max( minX, vp.x );
-        minY = std::max( minY, vp.y );
-        maxX = std::min( maxX, vp.x + vp.width - 1 );
-        maxY = std::min( maxY, vp.y + vp.height - 1 );
+        // Отсечение по viewport прямоугольнику и границам цели
+        minX = std::max( minX, std::max( vp.x, 0 ) );
+        minY = std::max( minY, std::max( vp.y, 0 ) );
+        maxX = std::min( maxX, std::min( vp.x + vp.width, targetW ) - 1 );
+        maxY = std::min( maxY, std::min( vp.y + vp.height, targetH ) - 1 );
+
+        if( minX > maxX || minY > maxY )
+            return false;
 
         // Полная площадь треугольника
         float area = edgeFunction( s0, s1, s2 );
         if( area == 0.0f )
-            return; // Вырожденный треугольник
+            return false; // Вырожденный треугольник
 
         // RS: Отсечение задних граней (простая политика: area>0 считаем фронт-фейс)
         if( rsStage.cullBackface )
         {
             if( area < 0.0f )
-                return;
+                return false;
         }
 
-        // Растеризация внутри ограничивающего прямоугольника
-        for( int y = minY; y <= maxY; ++y )
+        // Инкрементальный рендеринг: пиксели записанного draw копятся без учёта прямоугольника перерисовки
+        if( drawBounds )
         {
-            for( int x = minX; x <= maxX; ++x )
+            drawBounds->minX = std::min( drawBounds->minX, minX );
+            drawBounds->minY = std::min( drawBounds->minY, minY );
+            drawBounds->maxX = std::max( drawBounds->maxX, maxX );
+            drawBounds->maxY = std::max( drawBounds->maxY, maxY );
+        }
+        minX = std::max( minX, scissor.minX );
+        minY = std::max( minY, scissor.minY );
+        maxX = std::min( maxX, scissor.maxX );
+        maxY = std::min( maxY, scissor.maxY );
+        if( minX > maxX || minY > maxY )
+            return false;
+
+        // z_ndc после перспективного деления линейна в экранном пространстве,
+        // поэтому глубина интерполируется экранными барицентриками без деления на denom
+        tri.zv = glm::vec3( p0.z, p1.z, p2.z );
+        tri.s0 = s0;
+        tri.s1 = s1;
+        tri.s2 = s2;
+        tri.area = area;
+        tri.minX = minX;
+        tri.minY = minY;
+        tri.maxX = maxX;
+        tri.maxY = maxY;
+        tri.drawId = 0;
+        tri.view = currentView;
+        return true;
+    }
+
+    void Device::setupAttributes( const VSOutput &v0, const VSOutput &v1, const VSOutput &v2, TriangleSetup &tri )
+    {
+        // Производные барицентрик по экрану постоянны на треугольнике; из них — производные texcoord
+        // для выбора мипа: d(U/W)/dx = (dU/dx - uv * dW/dx) / W, где U = sum(b_i * uv_i / w_i), W = sum(b_i / w_i)
+        const glm::vec2 &s0 = tri.s0, &s1 = tri.s1, &s2 = tri.s2;
+        const float invArea = 1.0f / tri.area;
+        tri.dBdx = glm::vec3( s2.y - s1.y, s0.y - s2.y, s1.y - s0.y ) * invArea;
+        tri.dBdy = glm::vec3( s1.x - s2.x, s2.x - s0.x, s0.x - s1.x ) * invArea;
+        tri.invWv = glm::vec3( 1.0f / v0.position.w, 1.0f / v1.position.w, 1.0f / v2.position.w );
+        tri.uvW0 = v0.texcoord * tri.invWv.x;
+        tri.uvW1 = v1.texcoord * tri.invWv.y;
+        tri.uvW2 = v2.texcoord * tri.invWv.z;
+        tri.dUdx = tri.uvW0 * tri.dBdx.x + tri.uvW1 * tri.dBdx.y + tri.uvW2 * tri.dBdx.z;
+        tri.dUdy = tri.uvW0 * tri.dBdy.x + tri.uvW1 * tri.dBdy.y + tri.uvW2 * tri.dBdy.z;
+        tri.dWdx = glm::dot( tri.invWv, tri.dBdx );
+        tri.dWdy = glm::dot( tri.invWv, tri.dBdy );
+        tri.c0 = v0.color;
+        tri.c1 = v1.color;
+        tri.c2 = v2.color;
+    }
+
+    uint32_t Device::smallTriangleCoverage( const TriangleSetup &tri, glm::vec3 *edges )
+    {
+        // Тот же тест, что и covers в rasterizeTri, — результат растеризации не меняется
+        uint32_t mask = 0;
+        for( int y = tri.minY; y <= tri.maxY; ++y )
+        {
+            for( int x = tri.minX; x <= tri.maxX; ++x )
             {
-                glm::vec2 p( static_cast<float>( x ) + 0.5f, static_cast<float>( y ) + 0.5f );
+                const glm::vec2 p( static_cast<float>( x ) + 0.5f, static_cast<float>( y ) + 0.5f );
+                const float w0 = edgeFunction( tri.s1, tri.s2, p );
+                const float w1 = edgeFunction( tri.s2, tri.s0, p );
+                const float w2 = edgeFunction( tri.s0, tri.s1, p );
+                const bool inside = ( tri.area > 0.0f && w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f ) ||
+                                    ( tri.area < 0.0f && w0 <= 0.0f && w1 <= 0.0f && w2 <= 0.0f );
+                if( !inside )
+                    continue;
+                const int bit = ( y - tri.minY ) * kSmallTriangleDim + ( x - tri.minX );
+                mask |= 1u << bit;
+                edges[bit] = glm::vec3( w0, w1, w2 );
+            }
+        }
+        return mask;
+    }
 
-                // Барицентрические координаты
-                float w0 = edgeFunction( s1, s2, p );
-                float w1 = edgeFunction( s2, s0, p );
-                float w2 = edgeFunction( s0, s1, p );
+    glm::vec3 Device::barycentricAt( const TriangleSetup &tri, const glm::vec2 &p )
+    {
+        return glm::vec3( edgeFunction( tri.s1, tri.s2, p ) / tri.area, edgeFunction( tri.s2, tri.s0, p ) / tri.area,
+                          edgeFunction( tri.s0, tri.s1, p ) / tri.area );
+    }
 
-                // Если точка проходит внутренний тест или режим wireframe — пиксели на ребре
-                bool inside = ( area > 0.0f && w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f ) ||
-                              ( area < 0.0f && w0 <= 0.0f && w1 <= 0.0f && w2 <= 0.0f );
+    PSInput Device::interpolate( const TriangleSetup &tri, const glm::vec3 &w, float denom, float depth )
+    {
+        // Перспективно-корректная интерполяция атрибутов в точке с барицентриками w
+        PSInput psIn;
+        glm::vec3 colorNum = w.x * tri.c0 * tri.invWv.x + w.y * tri.c1 * tri.invWv.y + w.z * tri.c2 * tri.invWv.z;
+        psIn.color = colorNum / denom;
+        psIn.barycentric = w;
+        psIn.depth = depth;
+        const float invDenom = 1.0f / denom;
+        psIn.texcoord = ( w.x * tri.uvW0 + w.y * tri.uvW1 + w.z * tri.uvW2 ) * invDenom;
+        psIn.texcoordDdx = ( tri.dUdx - psIn.texcoord * tri.dWdx ) * invDenom;
+        psIn.texcoordDdy = ( tri.dUdy - psIn.texcoord * tri.dWdy ) * invDenom;
+        return psIn;
+    }
 
-                // Wireframe: рисуем только пиксели на границе (вблизи ребра)
-                bool onEdge = false;
-                if( rsStage.wireframe )
+    void Device::rasterizeTri( const VSOutput &v0, const VSOutput &v1, const VSOutput &v2, const ShaderContext &ctx,
+                               bool deferred )
+    {
+        ++stats.primitives;
+        TriangleSetup tri;
+        if( !setupTriangle( v0, v1, v2, tri ) )
+            return;
+        // Проход только глубины: производные и атрибуты не нужны, PS не вызывается. Идёт до маски мелких
+        // треугольников: rasterizeDepthOnly сам тестирует покрытие блоками, второй тест был бы лишним
+        if( !deferred && !target->isMultisampled() && !rsStage.wireframe && !colorWriteEnabled() )
+        {
+            const uint64_t passed = rasterizeDepthOnly( tri );
+            if( activeQuery )
+                activeQuery->samples += passed;
+            return;
+        }
+        // Мелкие треугольники плотных мешей: покрытие нескольких центров пикселей считается сразу маской.
+        // Треугольник, не накрывший ни одного центра, отбрасывается до установки производных и атрибутов,
+        // остальные обходят только биты маски с барицентриками из уже посчитанных рёбер
+        const bool small = !target->isMultisampled() && !rsStage.wireframe &&
+                           tri.maxX - tri.minX < kSmallTriangleDim && tri.maxY - tri.minY < kSmallTriangleDim;
+        glm::vec3 smallEdges[kSmallTriangleDim * kSmallTriangleDim];
+        const uint32_t smallMask = small ? smallTriangleCoverage( tri, smallEdges ) : 0;
+        if( small && smallMask == 0 )
+            return;
+        setupAttributes( v0, v1, v2, tri );
+        const glm::vec2 &s0 = tri.s0, &s1 = tri.s1, &s2 = tri.s2;
+        const float area = tri.area;
+        const int minX = tri.minX, minY = tri.minY, maxX = tri.maxX, maxY = tri.maxY;
+        const glm::vec3 &invWv = tri.invWv;
+        const glm::vec3 &zv = tri.zv;
+
+        // Тест покрытия точки: внутри треугольника, а в режиме wireframe — ещё и вблизи ребра
+        const float epsPixels = 0.75f; // толщина линии ~1px
+        const bool wireframe = rsStage.wireframe;
+        const float L0 = wireframe ? glm::length( s2 - s1 ) : 0.0f;
+        const float L1 = wireframe ? glm::length( s0 - s2 ) : 0.0f;
+        const float L2 = wireframe ? glm::length( s1 - s0 ) : 0.0f;
+        auto covers = [&]( const glm::vec2 &p ) -> bool {
+            float w0 = edgeFunction( s1, s2, p );
+            float w1 = edgeFunction( s2, s0, p );
+            float w2 = edgeFunction( s0, s1, p );
+            bool inside = ( area > 0.0f && w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f ) ||
+                          ( area < 0.0f && w0 <= 0.0f && w1 <= 0.0f && w2 <= 0.0f );
+            if( !inside || !wireframe )
+                return inside;
+            // Связь: |edgeFunction(e,p)| = |e| * distance(p, edge)
+            // Поэтому сравниваем с длиной ребра * допуск_в_пикселях
+            return ( std::abs( w0 ) <= L0 * epsPixels ) || ( std::abs( w1 ) <= L1 * epsPixels ) ||
+                   ( std::abs( w2 ) <= L2 * epsPixels );
+        };
+        auto barycentric = [&]( const glm::vec2 &p ) { return barycentricAt( tri, p ); };
+        // Барицентрики центра пикселя (x, y) полного пути; false — центр не покрыт
+        auto coveredBarycentric = [&]( int x, int y, glm::vec3 &w ) -> bool {
+            const glm::vec2 p( static_cast<float>( x ) + 0.5f, static_cast<float>( y ) + 0.5f );
+            if( !covers( p ) )
+                return false;
+            w = barycentric( p );
+            return true;
+        };
+        // То же у мелкого треугольника: покрытие из маски, рёбра из smallTriangleCoverage (деление то же,
+        // что в barycentricAt, — результат совпадает побитово)
+        auto smallBarycentric = [&]( int x, int y, glm::vec3 &w ) -> bool {
+            const int bit = ( y - minY ) * kSmallTriangleDim + ( x - minX );
+            if( ( ( smallMask >> bit ) & 1u ) == 0 )
+                return false;
+            w = smallEdges[bit] / area;
+            return true;
+        };
+        // Строка маски мелкого треугольника без покрытых пикселей
+        auto smallRowEmpty = [&]( int y ) {
+            return ( ( smallMask >> ( ( y - minY ) * kSmallTriangleDim ) ) & ( ( 1u << kSmallTriangleDim ) - 1 ) ) == 0;
+        };
+        // PS: интерполяция атрибутов в точке с барицентриками w и вызов шейдера
+        auto shade = [&]( const glm::vec3 &w, float denom, float depth ) {
+            ++stats.psInvocations;
+            return psStage.pixelShader( interpolate( tri, w, denom, depth ), ctx );
+        };
+
+        if( target->isMultisampled() )
+        {
+            const uint64_t passed = rasterizeTriMultisample( minX, minY, maxX, maxY, covers, barycentric, shade, zv,
+                                                             invWv, tri.dBdx, tri.dBdy );
+            if( activeQuery )
+                activeQuery->samples += passed;
+            return;
+        }
+
+        if( deferred )
+        {
+            // Буфер видимости: только глубина и номер треугольника, PS — при разрешении (flushVisibilityBuffer).
+            // Треугольник сохраняется, лишь когда хотя бы один его пиксель прошёл тест глубины
+            uint32_t triId = kNoTriangle;
+            uint64_t passed = 0;
+            // Покрытый пиксель (x, y) с барицентриками w: тест глубины, запись глубины и номера треугольника
+            auto visibilityPixel = [&]( int x, int y, const glm::vec3 &w ) {
+                if( glm::dot( w, invWv ) <= 0.0f )
+                    return;
+                const float depth = glm::dot( w, zv );
+                const size_t fbIndex = target->pixelIndex( static_cast<size_t>( x ), static_cast<size_t>( y ) );
+                if( !depthTest( omStage.depth.func, depth, target->depthBuffer[fbIndex] ) )
+                    return;
+                if( triId == kNoTriangle )
                 {
-                    // Связь: |edgeFunction(e,p)| = |e| * distance(p, edge)
-                    // Поэтому сравниваем с длиной ребра * допуск_в_пикселях
-                    const float epsPixels = 0.75f; // толщина линии ~1px
-                    float L0 = glm::length( s2 - s1 );
-                    float L1 = glm::length( s0 - s2 );
-                    float L2 = glm::length( s1 - s0 );
-                    onEdge = ( std::abs( w0 ) <= L0 * epsPixels ) || ( std::abs( w1 ) <= L1 * epsPixels ) ||
-                             ( std::abs( w2 ) <= L2 * epsPixels );
+                    triId = static_cast<uint32_t>( visTriangles.size() );
+                    tri.drawId = static_cast<uint32_t>( visDrawCount - 1 );
+                    visTriangles.push_back( tri );
                 }
+                ++passed;
+                target->depthBuffer[fbIndex] = depth;
+                visibilityIds[fbIndex] = triId;
+            };
+            if( small )
+            {
+                // Только биты маски, построчно
+                for( int bit = 0; bit < kSmallTriangleDim * kSmallTriangleDim; ++bit )
+                {
+                    if( ( smallMask >> bit ) & 1u )
+                        visibilityPixel( minX + bit % kSmallTriangleDim, minY + bit / kSmallTriangleDim,
+                                         smallEdges[bit] / area );
+                }
+            }
+            else
+            {
+                const int tile = static_cast<int>( RenderSurface::kTileDim );
+                for( int ty = minY & ~( tile - 1 ); ty <= maxY; ty += tile )
+                {
+                    const int rowEnd = std::min( ty + tile - 1, maxY );
+                    for( int bx = minX & ~( tile - 1 ); bx <= maxX; bx += tile )
+                    {
+                        const int colEnd = std::min( bx + tile - 1, maxX );
+                        for( int y = std::max( ty, minY ); y <= rowEnd; ++y )
+                        {
+                            for( int x = std::max( bx, minX ); x <= colEnd; ++x )
+                            {
+                                glm::vec3 w;
+                                if( coveredBarycentric( x, y, w ) )
+                                    visibilityPixel( x, y, w );
+                            }
+                        }
+                    }
+                }
+            }
+            if( triId != kNoTriangle )
+            {
+                const bool firstTriangle = visMaxX < visMinX;
+                visMinX = firstTriangle ? minX : std::min( visMinX, minX );
+                visMinY = firstTriangle ? minY : std::min( visMinY, minY );
+                visMaxX = firstTriangle ? maxX : std::max( visMaxX, maxX );
+                visMaxY = firstTriangle ? maxY : std::max( visMaxY, maxY );
+            }
+            if( activeQuery )
+                activeQuery->samples += passed;
+            return;
+        }
+
+        const BlendKernel blendKernel = omStage.blendKernel;
+        const bool halfTarget = target->isHalfColor();
+        const bool readsTarget = blendReadsTarget( omStage.blend );
+
+        // Без записи цвета PS не вызывается (без MSAA сюда доходит только wireframe, остальное — rasterizeDepthOnly)
+        const bool colorWrite = colorWriteEnabled();
+        const DepthFunc depthFunc = omStage.depth.depthEnable ? omStage.depth.func : DepthFunc::Always;
+        const bool depthWrite = omStage.depth.depthEnable && omStage.depth.depthWrite;
+        uint64_t passed = 0;
+
+        // Растеризация внутри ограничивающего прямоугольника; цвет пишется блоками по kBlendBlockSize пикселей
+        // через ядро смешивания OM, пиксели, не прошедшие тесты, исключаются маской покрытия блока
+        // Обход тайлами (полосы по kTileDim строк, в полосе — столбец блоков за столбцом): в тайловой раскладке
+        // тайл глубины — одна кэш-линия, а блок смешивания — строка тайла, лежащая подряд в обеих раскладках
+        static_assert( kBlendBlockSize == RenderSurface::kTileDim, "Блок смешивания — строка тайла поверхности" );
+        // Строка блока (bx, y): пиксели, для которых pixelBarycentric(x, y, w) вернул true, проходят тест глубины
+        // и PS, цвет смешивается блоком
+        auto blockRow = [&]( int bx, int y, const auto &pixelBarycentric ) {
+            const size_t blockIndex = target->pixelIndex( static_cast<size_t>( bx ), static_cast<size_t>( y ) );
+            glm::vec4 block[kBlendBlockSize];
+            uint32_t coverage = 0;
+            const int blockEnd = std::min( bx + kBlendBlockSize, maxX + 1 );
+            for( int x = std::max( bx, minX ); x < blockEnd; ++x )
+            {
+                glm::vec3 w;
+                if( !pixelBarycentric( x, y, w ) )
+                    continue;
+                // Перспективно-корректная интерполяция: используем 1/w как вес
+                float denom = glm::dot( w, invWv );
+                if( denom <= 0.0f )
+                    continue;
+                float depth = glm::dot( w, zv );
+
+                const size_t fbIndex = blockIndex + static_cast<size_t>( x - bx );
+                // Тест глубины
+                if( depthTest( depthFunc, depth, target->depthBuffer[fbIndex] ) )
+                {
+                    ++passed;
+                    // Цвет уходит в блок, глубина пишется сразу
+                    if( colorWrite )
+                    {
+                        block[x - bx] = shade( w, denom, depth );
+                        coverage |= 1u << ( x - bx );
+                    }
+                    if( depthWrite )
+                        target->depthBuffer[fbIndex] = depth;
+                }
+            }
+            if( coverage && halfTarget )
+                blendBlockHalf( blendKernel, readsTarget, target->colorBufferHalf.data() + blockIndex, block,
+                                coverage );
+            else if( coverage )
+                blendKernel( target->colorBuffer.data() + blockIndex, block, coverage );
+        };
+        if( small )
+        {
+            // Строки маски без покрытых пикселей пропускаются; строка мелкого треугольника — не больше двух блоков
+            for( int y = minY; y <= maxY; ++y )
+            {
+                if( smallRowEmpty( y ) )
+                    continue;
+                for( int bx = minX & ~( kBlendBlockSize - 1 ); bx <= maxX; bx += kBlendBlockSize )
+                    blockRow( bx, y, smallBarycentric );
+            }
+        }
+        else
+        {
+            for( int ty = minY & ~( kBlendBlockSize - 1 ); ty <= maxY; ty += kBlendBlockSize )
+            {
+                const int rowEnd = std::min( ty + kBlendBlockSize - 1, maxY );
+                for( int bx = minX & ~( kBlendBlockSize - 1 ); bx <= maxX; bx += kBlendBlockSize )
+                {
+                    for( int y = std::max( ty, minY ); y <= rowEnd; ++y )
+                        blockRow( bx, y, coveredBarycentric );
+                }
+            }
+        }
+        if( activeQuery )
+            activeQuery->samples += passed;
+    }
+
+    bool Device::colorWriteEnabled() const
+    {
+        return psStage.pixelShader && ( omStage.blend.writeMask & ColorWriteAll ) != 0 && target->hasColor();
+    }
+
+#if SWR_SSE2
+    namespace
+    {
+        // Рёбра треугольника для edgeFunction(a, b, p): начало a и (b - a)
+        struct DepthRowSetup
+        {
+            glm::vec2 a[3];
+            glm::vec2 e[3];
+            float area;
+            glm::vec3 zv;
+        };
+
+        // Покрытие (маска пикселей) и глубина строки из kBlendBlockSize пикселей начиная с (x0, y).
+        // Операции те же и в том же порядке, что edgeFunction, barycentricAt и dot(w, zv) полного пути, —
+        // глубина совпадает побитово
+        inline uint32_t depthRow( const DepthRowSetup &s, int x0, int y, __m128 &depth )
+        {
+            const __m128 px =
+                _mm_add_ps( _mm_set1_ps( static_cast<float>( x0 ) ), _mm_setr_ps( 0.5f, 1.5f, 2.5f, 3.5f ) );
+            const float py = static_cast<float>( y ) + 0.5f;
+            const __m128 zero = _mm_setzero_ps();
+            __m128 inside = _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+            __m128 w[3];
+            for( int i = 0; i < 3; ++i )
+            {
+                // (p.x - a.x) * (b.y - a.y) - (p.y - a.y) * (b.x - a.x)
+                const __m128 dx = _mm_mul_ps( _mm_sub_ps( px, _mm_set1_ps( s.a[i].x ) ), _mm_set1_ps( s.e[i].y ) );
+                const __m128 edge = _mm_sub_ps( dx, _mm_set1_ps( ( py - s.a[i].y ) * s.e[i].x ) );
+                inside = _mm_and_ps( inside, s.area > 0.0f ? _mm_cmpge_ps( edge, zero ) : _mm_cmple_ps( edge, zero ) );
+                w[i] = _mm_div_ps( edge, _mm_set1_ps( s.area ) );
+            }
+            const __m128 z01 = _mm_add_ps( _mm_mul_ps( w[0], _mm_set1_ps( s.zv.x ) ),
+                                           _mm_mul_ps( w[1], _mm_set1_ps( s.zv.y ) ) );
+            depth = _mm_add_ps( z01, _mm_mul_ps( w[2], _mm_set1_ps( s.zv.z ) ) );
+            return static_cast<uint32_t>( _mm_movemask_ps( inside ) );
+        }
+
+        inline uint32_t depthTestRow( DepthFunc func, __m128 d, __m128 stored )
+        {
+            switch( func )
+            {
+            case DepthFunc::Never:
+                return 0;
+            case DepthFunc::Less:
+                return static_cast<uint32_t>( _mm_movemask_ps( _mm_cmplt_ps( d, stored ) ) );
+            case DepthFunc::LessEqual:
+                return static_cast<uint32_t>( _mm_movemask_ps( _mm_cmple_ps( d, stored ) ) );
+            case DepthFunc::Equal:
+                return static_cast<uint32_t>( _mm_movemask_ps( _mm_cmpeq_ps( d, stored ) ) );
+            case DepthFunc::GreaterEqual:
+                return static_cast<uint32_t>( _mm_movemask_ps( _mm_cmpge_ps( d, stored ) ) );
+            case DepthFunc::Greater:
+                return static_cast<uint32_t>( _mm_movemask_ps( _mm_cmpgt_ps( d, stored ) ) );
+            case DepthFunc::Always:
+                return ( 1u << kBlendBlockSize ) - 1;
+            }
+            return 0;
+        }
 
-                if( inside && ( !rsStage.wireframe || onEdge ) )
+        // Биты маски — в полные дорожки регистра
+        inline __m128 laneMask( uint32_t mask )
+        {
+            return _mm_castsi128_ps( _mm_setr_epi32( ( mask & 1 ) ? -1 : 0, ( mask & 2 ) ? -1 : 0,
+                                                     ( mask & 4 ) ? -1 : 0, ( mask & 8 ) ? -1 : 0 ) );
+        }
+    } // unnamed namespace
+#endif
+
+    uint64_t Device::rasterizeDepthOnly( const TriangleSetup &tri )
+    {
+        const DepthFunc depthFunc = omStage.depth.depthEnable ? omStage.depth.func : DepthFunc::Always;
+        const bool depthWrite = omStage.depth.depthEnable && omStage.depth.depthWrite;
+        // Ни записи, ни подсчёта сэмплов — draw ничего не меняет
+        if( !depthWrite && !activeQuery )
+            return 0;
+
+#if SWR_SSE2
+        const DepthRowSetup s{
+            { tri.s1, tri.s2, tri.s0 }, { tri.s2 - tri.s1, tri.s0 - tri.s2, tri.s1 - tri.s0 }, tri.area, tri.zv };
+#endif
+        float *depthBuffer = target->depthBuffer.data();
+        uint64_t passed = 0;
+        for( int y = tri.minY; y <= tri.maxY; ++y )
+        {
+            for( int bx = tri.minX & ~( kBlendBlockSize - 1 ); bx <= tri.maxX; bx += kBlendBlockSize )
+            {
+                // Пиксели строки блока внутри прямоугольника треугольника; строка блока лежит подряд в обеих
+                // раскладках, поэтому полная строка читается и пишется одной векторной операцией
+                const int first = std::max( bx, tri.minX ) - bx;
+                const int last = std::min( bx + kBlendBlockSize - 1, tri.maxX ) - bx;
+                const uint32_t rangeMask = ( ( 1u << ( last + 1 ) ) - 1 ) & ~( ( 1u << first ) - 1 );
+                float *row = depthBuffer + target->pixelIndex( static_cast<size_t>( bx ), static_cast<size_t>( y ) );
+#if SWR_SSE2
+                const bool fullRow = rangeMask == ( 1u << kBlendBlockSize ) - 1;
+                __m128 depth;
+                uint32_t mask = depthRow( s, bx, y, depth ) & rangeMask;
+                if( mask == 0 )
+                    continue;
+                alignas( 16 ) float stored[kBlendBlockSize] = {};
+                if( fullRow )
+                {
+                    _mm_store_ps( stored, _mm_loadu_ps( row ) );
+                }
+                else
+                {
+                    for( int i = first; i <= last; ++i )
+                        stored[i] = row[i];
+                }
+                mask &= depthTestRow( depthFunc, depth, _mm_load_ps( stored ) );
+                if( mask == 0 )
+                    continue;
+                passed += countSamples( mask );
+                if( !depthWrite )
+                    continue;
+                if( fullRow )
                 {
-                    w0 /= area;
-                    w1 /= area;
-                    w2 /= area;
-
-                    // Перспективно-корректная интерполяция: используем 1/w как вес
-                    float invW0 = 1.0f / v0.position.w;
-                    float invW1 = 1.0f / v1.position.w;
-                    float invW2 = 1.0f / v2.position.w;
-                    float denom = w0 * invW0 + w1 * invW1 + w2 * invW2;
-                    if( denom <= 0.0f )
+                    // Непрошедшие пиксели сохраняют прежнюю глубину
+                    const __m128 lanes = laneMask( mask );
+                    const __m128 kept = _mm_andnot_ps( lanes, _mm_load_ps( stored ) );
+                    _mm_storeu_ps( row, _mm_or_ps( _mm_and_ps( lanes, depth ), kept ) );
+                    continue;
+                }
+                alignas( 16 ) float values[kBlendBlockSize];
+                _mm_store_ps( values, depth );
+                for( int i = first; i <= last; ++i )
+                {
+                    if( mask & ( 1u << i ) )
+                        row[i] = values[i];
+                }
+#else
+                (void)rangeMask;
+                for( int i = first; i <= last; ++i )
+                {
+                    const glm::vec2 p( static_cast<float>( bx + i ) + 0.5f, static_cast<float>( y ) + 0.5f );
+                    const float e0 = edgeFunction( tri.s1, tri.s2, p );
+                    const float e1 = edgeFunction( tri.s2, tri.s0, p );
+                    const float e2 = edgeFunction( tri.s0, tri.s1, p );
+                    const bool inside = ( tri.area > 0.0f && e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f ) ||
+                                        ( tri.area < 0.0f && e0 <= 0.0f && e1 <= 0.0f && e2 <= 0.0f );
+                    if( !inside )
                         continue;
+                    const float depth = glm::dot( glm::vec3( e0 / tri.area, e1 / tri.area, e2 / tri.area ), tri.zv );
+                    if( !depthTest( depthFunc, depth, row[i] ) )
+                        continue;
+                    ++passed;
+                    if( depthWrite )
+                        row[i] = depth;
+                }
+#endif
+            }
+        }
+        return passed;
+    }
 
-                    // Интерполяция глубины (z_ndc) с делением на общий знаменатель
-                    float depth = ( w0 * p0.z + w1 * p1.z + w2 * p2.z ) / denom;
+    template <typename CoverFn, typename BarycentricFn, typename ShadeFn>
+    uint64_t Device::rasterizeTriMultisample( int minX, int minY, int maxX, int maxY, const CoverFn &covers,
+                                          const BarycentricFn &barycentricAt, const ShadeFn &shade,
+                                          const glm::vec3 &zv, const glm::vec3 &invWv, const glm::vec3 &dBdx,
+                                          const glm::vec3 &dBdy )
+    {
+        static_assert( kMaxSampleCount == kBlendBlockSize, "Сэмплы пикселя смешиваются одним блоком" );
+        const uint32_t kAllSamples = ( 1u << kMaxSampleCount ) - 1;
+        const BlendKernel blendKernel = omStage.blendKernel;
+        const BlendState &blend = omStage.blend;
+        // Непрозрачная запись полностью покрытого пикселя даёт одинаковые сэмплы — пиксель можно сжать
+        const bool plainStore = blend.mode == BlendMode::Opaque && ( blend.writeMask & ColorWriteAll ) == ColorWriteAll;
+        const bool colorWrite = colorWriteEnabled();
+        const DepthFunc depthFunc = omStage.depth.depthEnable ? omStage.depth.func : DepthFunc::Always;
+        const bool depthWrite = omStage.depth.depthEnable && omStage.depth.depthWrite;
+        const float dZdx = glm::dot( zv, dBdx );
+        const float dZdy = glm::dot( zv, dBdy );
+        uint64_t passed = 0;
 
-                    size_t fbIndex = static_cast<size_t>( y ) * frameWidth + static_cast<size_t>( x );
-                    // Тест глубины
-                    if( depth < frameBuffers.depthBuffer[fbIndex] )
+        for( int y = minY; y <= maxY; ++y )
+        {
+            for( int x = minX; x <= maxX; ++x )
+            {
+                const glm::vec2 center( static_cast<float>( x ) + 0.5f, static_cast<float>( y ) + 0.5f );
+                const size_t pixel = target->pixelIndex( static_cast<size_t>( x ), static_cast<size_t>( y ) );
+                float *depths = &target->depthBuffer[pixel * kMaxSampleCount];
+
+                // Покрытие и тест глубины по сэмплам; глубина сэмпла — из плоскости z треугольника
+                const glm::vec3 wCenter = barycentricAt( center );
+                const float depthCenter = glm::dot( wCenter, zv );
+                float sampleDepth[kMaxSampleCount];
+                uint32_t sampleMask = 0;
+                int firstCovered = -1;
+                for( uint32_t s = 0; s < kMaxSampleCount; ++s )
+                {
+                    const glm::vec2 offset( kSamplePositions4[s][0], kSamplePositions4[s][1] );
+                    if( !covers( center + offset ) )
+                        continue;
+                    if( firstCovered < 0 )
+                        firstCovered = static_cast<int>( s );
+                    const float d = depthCenter + offset.x * dZdx + offset.y * dZdy;
+                    if( depthTest( depthFunc, d, depths[s] ) )
+                    {
+                        sampleDepth[s] = d;
+                        sampleMask |= 1u << s;
+                    }
+                }
+                if( sampleMask == 0 )
+                    continue;
+
+                if( !colorWrite )
+                {
+                    passed += countSamples( sampleMask );
+                    if( depthWrite )
                     {
-                        // PS - формируем входные данные и вызываем пиксельный шейдер
-                        PSInput psIn;
-                        // Цвет/любые атрибуты тоже интерполируем перспективно-корректно
-                        glm::vec3 colorNum = w0 * v0.color * invW0 + w1 * v1.color * invW1 + w2 * v2.color * invW2;
-                        psIn.color = colorNum / denom;
-                        psIn.barycentric = glm::vec3( w0, w1, w2 );
-                        psIn.depth = depth;
-
-                        glm::vec4 outColor = psStage.pixelShader( psIn, ctx );
-
-                        // Запись в буферы
-                        frameBuffers.colorBuffer[fbIndex] = outColor;
-                        frameBuffers.depthBuffer[fbIndex] = depth;
+                        for( uint32_t s = 0; s < kMaxSampleCount; ++s )
+                        {
+                            if( sampleMask & ( 1u << s ) )
+                                depths[s] = sampleDepth[s];
+                        }
                     }
+                    continue;
+                }
+
+                // PS один раз на пиксель. Если центр вне треугольника, атрибуты берутся в первом покрытом
+                // сэмпле (центроидная выборка), чтобы не экстраполировать их за ребро
+                glm::vec3 w = wCenter;
+                float depth = depthCenter;
+                if( !covers( center ) )
+                {
+                    const glm::vec2 offset( kSamplePositions4[firstCovered][0], kSamplePositions4[firstCovered][1] );
+                    w = barycentricAt( center + offset );
+                    depth = glm::dot( w, zv );
                 }
+                const float denom = glm::dot( w, invWv );
+                if( denom <= 0.0f )
+                    continue;
+                const glm::vec4 color = shade( w, denom, depth );
+
+                passed += countSamples( sampleMask );
+                for( uint32_t s = 0; s < kMaxSampleCount && depthWrite; ++s )
+                {
+                    if( sampleMask & ( 1u << s ) )
+                        depths[s] = sampleDepth[s];
+                }
+
+                glm::vec4 *samples = &target->sampleColor[pixel * kMaxSampleCount];
+                uint8_t &isCompressed = target->compressed[pixel];
+                if( sampleMask == kAllSamples )
+                {
+                    if( plainStore )
+                    {
+                        samples[0] = color;
+                        isCompressed = 1;
+                        continue;
+                    }
+                    if( isCompressed )
+                    {
+                        // Все сэмплы одинаковы и смешиваются с одним цветом — достаточно сэмпла 0
+                        blendKernel( samples, &color, 1u );
+                        continue;
+                    }
+                }
+                else if( isCompressed )
+                {
+                    // Частичное покрытие: распаковываем пиксель
+                    for( uint32_t s = 1; s < kMaxSampleCount; ++s )
+                        samples[s] = samples[0];
+                    isCompressed = 0;
+                }
+                const glm::vec4 src[kMaxSampleCount] = { color, color, color, color };
+                blendKernel( samples, src, sampleMask );
             }
         }
+        return passed;
     }
 
     // IAStage
@@ -473,16 +2174,113 @@ namespace swr
         inputLayout = std::move( layout );
     }
 
+    // Номер установленного шейдера: std::function не сравнить, поэтому записанные draw сравниваются по нему
+    static uint64_t nextShaderSerial()
+    {
+        static std::atomic<uint64_t> counter{ 0 };
+        return ++counter;
+    }
+
+    namespace
+    {
+        // Номер выдаётся при регистрации: повторная установка того же имени не делает draw новыми
+        template <typename Shader> struct NamedShader
+        {
+            Shader shader;
+            uint64_t serial;
+        };
+
+        struct ShaderRegistry
+        {
+            std::mutex mutex;
+            std::unordered_map<std::string, NamedShader<VertexShader>> vertexShaders;
+            std::unordered_map<std::string, NamedShader<PixelShader>> pixelShaders;
+        };
+
+        // Функция, а не глобальная переменная: регистрация идёт из статических инициализаторов других единиц
+        ShaderRegistry &shaderRegistry()
+        {
+            static ShaderRegistry registry;
+            return registry;
+        }
+
+        template <typename Shader>
+        NamedShader<Shader> findNamedShader( const std::unordered_map<std::string, NamedShader<Shader>> &shaders,
+                                             const std::string &name, const char *what )
+        {
+            std::lock_guard<std::mutex> lock( shaderRegistry().mutex );
+            auto it = shaders.find( name );
+            if( it == shaders.end() )
+                throw std::invalid_argument( std::string( what ) + ": unknown shader " + name );
+            return it->second;
+        }
+    } // unnamed namespace
+
+    void registerVertexShader( const std::string &name, VertexShader shader )
+    {
+        ShaderRegistry &registry = shaderRegistry();
+        std::lock_guard<std::mutex> lock( registry.mutex );
+        registry.vertexShaders[name] = { std::move( shader ), nextShaderSerial() };
+    }
+
+    void registerPixelShader( const std::string &name, PixelShader shader )
+    {
+        ShaderRegistry &registry = shaderRegistry();
+        std::lock_guard<std::mutex> lock( registry.mutex );
+        registry.pixelShaders[name] = { std::move( shader ), nextShaderSerial() };
+    }
+
+    bool isVertexShaderRegistered( const std::string &name )
+    {
+        ShaderRegistry &registry = shaderRegistry();
+        std::lock_guard<std::mutex> lock( registry.mutex );
+        return registry.vertexShaders.count( name ) != 0;
+    }
+
+    bool isPixelShaderRegistered( const std::string &name )
+    {
+        ShaderRegistry &registry = shaderRegistry();
+        std::lock_guard<std::mutex> lock( registry.mutex );
+        return registry.pixelShaders.count( name ) != 0;
+    }
+
     // VSStage
     void Device::VSStage::setVertexShader( VertexShader shader )
     {
         vertexShader = std::move( shader );
+        shaderName.clear();
+        shaderSerial = nextShaderSerial();
+    }
+    void Device::VSStage::setNamedVertexShader( const std::string &name )
+    {
+        NamedShader<VertexShader> named =
+            findNamedShader( shaderRegistry().vertexShaders, name, "setNamedVertexShader" );
+        vertexShader = std::move( named.shader );
+        shaderName = name;
+        shaderSerial = named.serial;
+    }
+    // Привязка буфера со смещением; смещение за пределами буфера — ошибка вызывающего
+    static ConstantBinding makeConstantBinding( std::shared_ptr<Buffer> buffer, size_t offset )
+    {
+        if( buffer && offset >= buffer->sizeInBytes() )
+            throw std::out_of_range( "setConstantBuffer: offset is outside of the buffer" );
+        return { std::move( buffer ), offset, false };
+    }
+
+    static void bindConstants( std::vector<ConstantBinding> &slots, size_t slot, ConstantBinding binding )
+    {
+        if( slot >= slots.size() )
+            slots.resize( slot + 1 );
+        slots[slot] = std::move( binding );
+    }
+
+    void Device::VSStage::setConstantBuffer( size_t slot, std::shared_ptr<Buffer> buffer, size_t offset )
+    {
+        bindConstants( constantBuffers, slot, makeConstantBinding( std::move( buffer ), offset ) );
     }
-    void Device::VSStage::setConstantBuffer( size_t slot, std::shared_ptr<Buffer> buffer )
+    void Device::VSStage::setConstants( size_t slot, const ConstantBinding &binding )
     {
-        if( slot >= constantBuffers.size() )
-            constantBuffers.resize( slot + 1 );
-        constantBuffers[slot] = std::move( buffer );
+        bindConstants( constantBuffers, slot, binding );
     }
 
     // RSStage
@@ -503,12 +2301,36 @@ namespace swr
     void Device::PSStage::setPixelShader( PixelShader shader )
     {
         pixelShader = std::move( shader );
+        shaderName.clear();
+        shaderSerial = nextShaderSerial();
     }
-    void Device::PSStage::setConstantBuffer( size_t slot, std::shared_ptr<Buffer> buffer )
+    void Device::PSStage::setNamedPixelShader( const std::string &name )
     {
-        if( slot >= constantBuffers.size() )
-            constantBuffers.resize( slot + 1 );
-        constantBuffers[slot] = std::move( buffer );
+        NamedShader<PixelShader> named = findNamedShader( shaderRegistry().pixelShaders, name, "setNamedPixelShader" );
+        pixelShader = std::move( named.shader );
+        shaderName = name;
+        shaderSerial = named.serial;
+    }
+    void Device::PSStage::setConstantBuffer( size_t slot, std::shared_ptr<Buffer> buffer, size_t offset )
+    {
+        bindConstants( constantBuffers, slot, makeConstantBinding( std::move( buffer ), offset ) );
+    }
+    void Device::PSStage::setConstants( size_t slot, const ConstantBinding &binding )
+    {
+        bindConstants( constantBuffers, slot, binding );
+    }
+
+    void Device::PSStage::setShaderResource( size_t slot, std::shared_ptr<Texture2D> texture )
+    {
+        if( slot >= textures.size() )
+            textures.resize( slot + 1 );
+        textures[slot] = std::move( texture );
+    }
+    void Device::PSStage::setSampler( size_t slot, const SamplerState &sampler )
+    {
+        if( slot >= samplers.size() )
+            samplers.resize( slot + 1 );
+        samplers[slot] = sampler;
     }
 
     // OMStage
@@ -532,4 +2354,88 @@ namespace swr
         return depthClear;
     }
 
+    void Device::OMStage::setRenderTarget( std::shared_ptr<Texture2D> texture )
+    {
+        if( auto dev = parentDevice.lock() )
+            dev->bindRenderTarget( texture );
+        renderTargetTexture = std::move( texture );
+    }
+
+    std::shared_ptr<Texture2D> Device::OMStage::renderTarget() const
+    {
+        return renderTargetTexture;
+    }
+
+    void Device::OMStage::setBlendState( const BlendState &state )
+    {
+        blend = state;
+        blendKernel = selectBlendKernel( state );
+    }
+
+    const BlendState &Device::OMStage::blendState() const
+    {
+        return blend;
+    }
+
+    void Device::OMStage::setDepthState( const DepthState &state )
+    {
+        depth = state;
+    }
+
+    const DepthState &Device::OMStage::depthState() const
+    {
+        return depth;
+    }
+
+    // Occlusion queries
+    std::shared_ptr<OcclusionQuery> Device::createOcclusionQuery()
+    {
+        std::weak_ptr<Device> wself = shared_from_this();
+        OcclusionQuery *raw = new OcclusionQuery();
+        auto deleter = [wself]( OcclusionQuery *p ) {
+            // Активный запрос не может пережить устройство: снимаем его с учёта
+            if( auto self = wself.lock() )
+            {
+                if( self->activeQuery == p )
+                    self->activeQuery = nullptr;
+            }
+            delete p;
+        };
+        return std::shared_ptr<OcclusionQuery>( raw, std::move( deleter ) );
+    }
+
+    void Device::beginQuery( const std::shared_ptr<OcclusionQuery> &query )
+    {
+        if( !query || activeQuery )
+        {
+            assert( false && "Null query or another occlusion query is already active" );
+            return;
+        }
+        // Результат запроса нужен в кадре, а записанные draw выполнились бы только в endFrame
+        if( recording )
+            stopRecording();
+        query->samples = 0;
+        query->active = true;
+        activeQuery = query.get();
+    }
+
+    void Device::endQuery( const std::shared_ptr<OcclusionQuery> &query )
+    {
+        if( !query || activeQuery != query.get() )
+        {
+            assert( false && "Query is not active" );
+            return;
+        }
+        query->active = false;
+        activeQuery = nullptr;
+    }
+
+    void Device::setPredication( std::shared_ptr<OcclusionQuery> query, bool value )
+    {
+        if( recording && query )
+            stopRecording();
+        predicate = std::move( query );
+        predicateValue = value;
+    }
+
 } // namespace swr
@@ -2,8 +2,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <string>
+#include <type_traits>
 
 #include <vector>
 
@@ -13,8 +17,16 @@
 struct SDL_Window;
 struct SDL_Renderer;
 struct SDL_Texture;
+struct SDL_PixelFormatDetails;
 
+#include "swrArena.h"
+#include "swrBlend.h"
 #include "swrBuffer.h"
+#include "swrHalf.h"
+#include "swrMemory.h"
+#include "swrQuery.h"
+#include "swrSurface.h"
+#include "swrTexture.h"
 
 namespace swr
 {
@@ -27,8 +39,19 @@ namespace swr
 
     struct VSOutput
     {
-        glm::vec4 position; // Позиция в  clip space (после world-view-projection)
-        glm::vec3 color;    // Цвет вершины, RGB 0..1
+        glm::vec4 position;            // Позиция в  clip space (после world-view-projection)
+        glm::vec3 color;               // Цвет вершины, RGB 0..1
+        glm::vec2 texcoord{ 0.0f };    // Текстурные координаты (0, если VS их не пишет)
+    };
+
+    // VSOutput в промежуточном хранилище конвейера при fp16-варьингах (Device::setHalfVaryings): цвет в half.
+    // Позиция и texcoord остаются float — у half не хватает точности (шаг texcoord около 20 — 1/64).
+    // 32 байта вместо 36: вершины не пересекают границу кэш-линии
+    struct PackedVSOutput
+    {
+        glm::vec4 position;
+        glm::vec2 texcoord;
+        Half4 color; // w не используется
     };
 
     struct PSInput
@@ -36,6 +59,9 @@ namespace swr
         glm::vec3 color;       // Цвет вершины, RGB 0..1
         glm::vec3 barycentric; // Барицентрические координаты
         float depth;           // Глубина пикселя
+        glm::vec2 texcoord;    // Текстурные координаты (перспективно-корректные)
+        glm::vec2 texcoordDdx; // d(texcoord)/dx по экрану — для выбора мипа
+        glm::vec2 texcoordDdy; // d(texcoord)/dy по экрану
     };
 
     // Input layout semantics
@@ -57,6 +83,9 @@ namespace swr
         R32G32B32A32_FLOAT, // 4 floats (vec4)
     };
 
+    // Size of one element of the format in bytes
+    size_t inputFormatSize( InputFormat format );
+
     // Description of a single input element
     struct InputElementDesc
     {
@@ -119,13 +148,42 @@ namespace swr
         InputLayoutDesc desc_;
     };
 
-    // Shader context - provides access to constant buffers
+    // Привязка константных данных к слоту: буфер и смещение в нём (байт).
+    // transient — память кольца констант устройства (Device::allocateConstants): до конца кадра она не
+    // перезаписывается, поэтому отложенный draw запоминает саму привязку, а не копию данных
+    struct ConstantBinding
+    {
+        std::shared_ptr<Buffer> buffer;
+        size_t offset = 0;
+        bool transient = false;
+        size_t size = 0; // Байт участка кольца (только transient)
+
+        const void *data() const
+        {
+            return static_cast<const uint8_t *>( buffer->data() ) + offset;
+        }
+        explicit operator bool() const
+        {
+            return buffer != nullptr;
+        }
+    };
+
+    // Участок кольца констант: данные пишутся через data до draw, в слот привязывается binding
+    struct ConstantAllocation
+    {
+        void *data = nullptr;
+        ConstantBinding binding;
+    };
+
+    // Shader context - provides access to constant buffers, textures and samplers
     class ShaderContext
     {
       public:
-        ShaderContext( const std::vector<std::shared_ptr<Buffer>> &vsBuffers,
-                       const std::vector<std::shared_ptr<Buffer>> &psBuffers )
-            : vsConstantBuffers( vsBuffers ), psConstantBuffers( psBuffers )
+        ShaderContext( const std::vector<ConstantBinding> &vsBuffers, const std::vector<ConstantBinding> &psBuffers,
+                       const std::vector<std::shared_ptr<Texture2D>> &psTextures,
+                       const std::vector<SamplerState> &psSamplers )
+            : vsConstantBuffers( vsBuffers ), psConstantBuffers( psBuffers ), psTextures( psTextures ),
+              psSamplers( psSamplers )
         {
         }
 
@@ -134,7 +192,7 @@ namespace swr
         {
             if( slot >= vsConstantBuffers.size() || !vsConstantBuffers[slot] )
                 return nullptr;
-            return static_cast<const T *>( vsConstantBuffers[slot]->data() );
+            return static_cast<const T *>( vsConstantBuffers[slot].data() );
         }
 
         template <typename T>
@@ -142,17 +200,90 @@ namespace swr
         {
             if( slot >= psConstantBuffers.size() || !psConstantBuffers[slot] )
                 return nullptr;
-            return static_cast<const T *>( psConstantBuffers[slot]->data() );
+            return static_cast<const T *>( psConstantBuffers[slot].data() );
+        }
+
+        // Номер экземпляра (SV_InstanceID): startInstanceLocation + номер экземпляра в draw.
+        // Задаётся для VS; в PS отложенного draw (буфер видимости) всегда 0
+        uint32_t instanceId() const
+        {
+            return instance;
+        }
+
+        // Номер вида (SV_ViewID) в многовидовом режиме (Device::setViews), иначе 0. Задаётся для PS:
+        // VS выполняется один раз на все виды
+        uint32_t viewId() const
+        {
+            return view;
+        }
+
+        const Texture2D *psTexture( size_t slot ) const
+        {
+            if( slot >= psTextures.size() )
+                return nullptr;
+            return psTextures[slot].get();
+        }
+
+        // Выборка из текстуры PS: мип выбирается по производным texcoord из PSInput
+        glm::vec4 sample( size_t textureSlot, size_t samplerSlot, const glm::vec2 &uv, const glm::vec2 &ddx,
+                          const glm::vec2 &ddy ) const
+        {
+            const Texture2D *tex = psTexture( textureSlot );
+            if( !tex || samplerSlot >= psSamplers.size() )
+                return glm::vec4( 0.0f );
+            return tex->sample( psSamplers[samplerSlot], uv, ddx, ddy );
+        }
+
+        glm::vec4 sample( size_t textureSlot, size_t samplerSlot, const PSInput &in ) const
+        {
+            return sample( textureSlot, samplerSlot, in.texcoord, in.texcoordDdx, in.texcoordDdy );
+        }
+
+        glm::vec4 sampleLevel( size_t textureSlot, size_t samplerSlot, const glm::vec2 &uv, float lod ) const
+        {
+            const Texture2D *tex = psTexture( textureSlot );
+            if( !tex || samplerSlot >= psSamplers.size() )
+                return glm::vec4( 0.0f );
+            return tex->sampleLevel( psSamplers[samplerSlot], uv, lod );
         }
 
       private:
-        const std::vector<std::shared_ptr<Buffer>> &vsConstantBuffers;
-        const std::vector<std::shared_ptr<Buffer>> &psConstantBuffers;
+        friend class Device;
+        const std::vector<ConstantBinding> &vsConstantBuffers;
+        const std::vector<ConstantBinding> &psConstantBuffers;
+        const std::vector<std::shared_ptr<Texture2D>> &psTextures;
+        const std::vector<SamplerState> &psSamplers;
+        uint32_t instance = 0;
+        uint32_t view = 0;
     };
 
     using VertexShader = std::function<VSOutput( const VertexInputView &, const ShaderContext & )>;
     using PixelShader = std::function<glm::vec4( const PSInput &, const ShaderContext & )>;
 
+    // Реестр именованных шейдеров процесса (потокобезопасный). Шейдер, установленный по имени
+    // (setNamedVertexShader/setNamedPixelShader), записывается в захват кадра именем, и swr_replay находит его
+    // в своём реестре. Повторная регистрация имени заменяет шейдер
+    void registerVertexShader( const std::string &name, VertexShader shader );
+    void registerPixelShader( const std::string &name, PixelShader shader );
+    bool isVertexShaderRegistered( const std::string &name );
+    bool isPixelShaderRegistered( const std::string &name );
+
+    // Регистрация из статического инициализатора: шейдеры единицы трансляции доступны любому исполняемому
+    // файлу, в который она собрана (приложению и swr_replay)
+    struct ShaderRegistration
+    {
+        ShaderRegistration( const char *name, VertexShader shader )
+        {
+            registerVertexShader( name, std::move( shader ) );
+        }
+        ShaderRegistration( const char *name, PixelShader shader )
+        {
+            registerPixelShader( name, std::move( shader ) );
+        }
+    };
+
+    class CaptureWriter;
+
     // Перечисление топологий примитивов
     enum class PrimitiveTopology
     {
@@ -166,8 +297,13 @@ namespace swr
         Unknown,
         R8G8B8A8_UNORM,
         D24_UNORM_S8_UINT,
+        D32_FLOAT, // Глубина float: текстура глубины (TextureBindDepthStencil), в шейдере читается как R
         R16_UINT, // Для индексных буферов (USHORT/UINT16)
         R32_UINT, // Для индексных буферов (UINT/UINT32)
+        R32G32B32A32_FLOAT, // Текстуры/цели рендеринга с плавающей точкой
+        R16G16B16A16_FLOAT, // То же в половинной точности (swrHalf): цель рендеринга RGBA16F
+        BC1_UNORM,          // Сжатые текстуры: блоки 4x4 по 8 байт (RGB + 1 бит альфы), см. swrBlockCompression
+        BC3_UNORM,          // Сжатые текстуры: блоки 4x4 по 16 байт (RGB + 8 бит альфы)
                   // Добавить другие форматы по мере необходимости
     };
 
@@ -182,6 +318,68 @@ namespace swr
         float maxDepth;
     };
 
+    // Вид многовидового рендеринга (Device::setViews): куда попадает треугольник в этом виде
+    struct ViewDesc
+    {
+        glm::mat4 viewProj{ 1.0f }; // Позиция из VS -> clip space вида
+        Viewport viewport{};        // Нулевой размер — вся цель вида, а для цели OM — вьюпорт RS
+        std::shared_ptr<Texture2D> renderTarget; // nullptr — цель OM
+    };
+
+    // Максимум видов: грани куба
+    constexpr size_t kMaxViews = 6;
+
+    // Запись аргументов drawIndirect (раскладка как у D3D12_DRAW_ARGUMENTS)
+    struct DrawArguments
+    {
+        uint32_t vertexCountPerInstance;
+        uint32_t instanceCount;
+        uint32_t startVertexLocation;
+        uint32_t startInstanceLocation;
+    };
+
+    // Запись аргументов drawIndexedIndirect/multiDrawIndexedIndirect (как D3D12_DRAW_INDEXED_ARGUMENTS)
+    struct DrawIndexedArguments
+    {
+        uint32_t indexCountPerInstance;
+        uint32_t instanceCount;
+        uint32_t startIndexLocation;
+        int32_t baseVertexLocation;
+        uint32_t startInstanceLocation;
+    };
+
+    // Размер пост-трансформ кэша вершин в drawIndexed (FIFO)
+    constexpr size_t kVertexCacheSize = 32;
+
+    // Счётчики конвейера с начала кадра (beginFrame)
+    struct PipelineStatistics
+    {
+        uint64_t vsInvocations = 0;  // Вызовы вершинного шейдера
+        uint64_t primitives = 0;     // Треугольники, поданные на растеризацию
+        uint64_t psInvocations = 0;  // Вызовы пиксельного шейдера
+        uint64_t predicatedDraws = 0; // Draw-вызовы, пропущенные по предикату (setPredication)
+        uint64_t redrawnTiles = 0;    // Перерисованные тайлы инкрементального кадра (setIncrementalRendering)
+    };
+
+    // Функция сравнения глубины фрагмента со значением в буфере
+    enum class DepthFunc
+    {
+        Never,
+        Less,
+        LessEqual,
+        Equal,
+        GreaterEqual,
+        Greater,
+        Always,
+    };
+
+    struct DepthState
+    {
+        bool depthEnable = true; // false — тест всегда проходит, глубина не пишется
+        bool depthWrite = true;
+        DepthFunc func = DepthFunc::Less;
+    };
+
     // Устройство рендеринга
     class Device : public std::enable_shared_from_this<Device>
     {
@@ -219,7 +417,12 @@ namespace swr
         {
           public:
             void setVertexShader( VertexShader shader );
-            void setConstantBuffer( size_t slot, std::shared_ptr<Buffer> buffer );
+            // Шейдер из реестра; незарегистрированное имя — std::invalid_argument
+            void setNamedVertexShader( const std::string &name );
+            // offset — начало констант в буфере (байт)
+            void setConstantBuffer( size_t slot, std::shared_ptr<Buffer> buffer, size_t offset = 0 );
+            // Привязка участка кольца констант (Device::allocateConstants/pushConstants)
+            void setConstants( size_t slot, const ConstantBinding &binding );
 
           private:
             friend class Device;
@@ -228,7 +431,9 @@ namespace swr
             }
             std::weak_ptr<Device> parentDevice;
             VertexShader vertexShader;
-            std::vector<std::shared_ptr<Buffer>> constantBuffers;
+            std::string shaderName;    // Пусто, если шейдер задан не по имени
+            uint64_t shaderSerial = 0; // Новый при каждом setVertexShader, у именованного — свой (сравнение draw)
+            std::vector<ConstantBinding> constantBuffers;
         };
 
         // RS (Rasterizer) stage
@@ -246,7 +451,7 @@ namespace swr
             {
             }
             std::weak_ptr<Device> parentDevice;
-            Viewport viewport;
+            Viewport viewport{};
             bool cullBackface = false;
             bool wireframe = false;
         };
@@ -256,16 +461,25 @@ namespace swr
         {
           public:
             void setPixelShader( PixelShader shader );
-            void setConstantBuffer( size_t slot, std::shared_ptr<Buffer> buffer );
+            void setNamedPixelShader( const std::string &name );
+            void setConstantBuffer( size_t slot, std::shared_ptr<Buffer> buffer, size_t offset = 0 );
+            void setConstants( size_t slot, const ConstantBinding &binding );
+            void setShaderResource( size_t slot, std::shared_ptr<Texture2D> texture );
+            void setSampler( size_t slot, const SamplerState &sampler );
 
           private:
             friend class Device;
-            PSStage( std::shared_ptr<Device> device ) : parentDevice( device ), constantBuffers( 8 )
+            PSStage( std::shared_ptr<Device> device )
+                : parentDevice( device ), constantBuffers( 8 ), textures( 8 ), samplers( 8 )
             {
             }
             std::weak_ptr<Device> parentDevice;
             PixelShader pixelShader;
-            std::vector<std::shared_ptr<Buffer>> constantBuffers;
+            std::string shaderName;
+            uint64_t shaderSerial = 0;
+            std::vector<ConstantBinding> constantBuffers;
+            std::vector<std::shared_ptr<Texture2D>> textures;
+            std::vector<SamplerState> samplers;
         };
 
         // OM Output Merger stage
@@ -276,15 +490,30 @@ namespace swr
             glm::vec4 clearColor() const;
             void setDepthClearValue( float depth );
             float depthClearValue() const;
-            // В будущем можно добавить настройки слияния вывода
+            // Цель рендеринга: текстура с TextureBindRenderTarget или nullptr (задний буфер устройства).
+            // Текстура глубины (TextureBindDepthStencil) — цель без цвета: draw пишут только глубину.
+            // При смене цели предыдущая текстура разрешается (resolveRenderSurface) и готова к выборке
+            void setRenderTarget( std::shared_ptr<Texture2D> texture );
+            std::shared_ptr<Texture2D> renderTarget() const;
+            // Смешивание цвета PS с целью; ядро выбирается здесь, а не в цикле растеризации
+            void setBlendState( const BlendState &state );
+            const BlendState &blendState() const;
+            void setDepthState( const DepthState &state );
+            const DepthState &depthState() const;
+
           private:
             friend class Device;
-            OMStage( std::shared_ptr<Device> device ) : parentDevice( device )
+            OMStage( std::shared_ptr<Device> device )
+                : parentDevice( device ), blendKernel( selectBlendKernel( BlendState{} ) )
             {
             }
             std::weak_ptr<Device> parentDevice;
             glm::vec4 clearColorValue;
             float depthClear = 1.0f;
+            std::shared_ptr<Texture2D> renderTargetTexture;
+            BlendState blend;
+            BlendKernel blendKernel;
+            DepthState depth;
         };
 
         // Доступ к стадиям конвейера
@@ -309,8 +538,55 @@ namespace swr
             return omStage;
         }
 
+        // Создание ресурсов (create*, wrapMemory) потокобезопасно и не трогает состояние конвейера:
+        // сцены загружаются в фоновых потоках параллельно с рендерингом (IScene::load)
+
         // Создание буфера (управляется shared_ptr с кастомным делетером)
-        std::shared_ptr<Buffer> createBuffer( size_t elementSize, size_t elementCount, BufferFormat format );
+        // options: выравнивание (например, 64 под SIMD) и отказ от обнуления памяти
+        std::shared_ptr<Buffer> createBuffer( size_t elementSize, size_t elementCount, BufferFormat format,
+                                              const BufferOptions &options = {} );
+        // Буфер поверх памяти вызывающего без копирования (запись разрешена).
+        // Память должна жить дольше буфера; owner (опционально) продлевает её жизнь автоматически
+        std::shared_ptr<Buffer> wrapMemory( size_t elementSize, size_t elementCount, BufferFormat format, void *data,
+                                            std::shared_ptr<void> owner = nullptr );
+        // Буфер только для чтения поверх внешней памяти без копирования (например, mmap файла меша).
+        // owner продлевает жизнь памяти до уничтожения буфера
+        std::shared_ptr<Buffer> createBufferFromMemory( size_t elementSize, size_t elementCount, BufferFormat format,
+                                                        const void *data, std::shared_ptr<const void> owner );
+
+        // Создание текстуры (управляется shared_ptr с кастомным делетером)
+        std::shared_ptr<Texture2D> createTexture2D( const TextureDesc &desc );
+
+        // Учёт памяти ресурсов: делетеры буферов и текстур сообщают устройству об освобождении, память
+        // буферов переиспользуется через пул классов размера (DeviceMemory). Вызывается из любого потока
+        MemoryStats memoryStats() const
+        {
+            return memory->stats();
+        }
+        // Бюджет собственной памяти ресурсов, байт (0 — без ограничения). create*, которому не хватает бюджета,
+        // бросает MemoryBudgetExceeded, не трогая уже созданные ресурсы
+        void setMemoryBudget( size_t bytes )
+        {
+            memory->setBudget( bytes );
+        }
+        // Сколько освобождённой памяти буферов пул держит для повторного использования
+        void setBufferPoolLimit( size_t bytes )
+        {
+            memory->setPoolLimit( bytes );
+        }
+        void trimBufferPool()
+        {
+            memory->trim();
+        }
+
+        // Запросы окклюзии. Одновременно активен один запрос; сэмплы считаются во всех draw между begin/end
+        std::shared_ptr<OcclusionQuery> createOcclusionQuery();
+        void beginQuery( const std::shared_ptr<OcclusionQuery> &query );
+        void endQuery( const std::shared_ptr<OcclusionQuery> &query );
+        // Предикатный рендеринг: draw-вызовы пропускаются, пока query->anySamplesPassed() == value.
+        // По умолчанию (value = false) пропускается то, что в запросе оказалось полностью закрыто; nullptr — выкл.
+        // Предикат, запрос которого ещё активен, игнорируется
+        void setPredication( std::shared_ptr<OcclusionQuery> query, bool value = false );
 
         // Создание input layout
         std::shared_ptr<InputLayout> createInputLayout( const InputLayoutDesc &desc );
@@ -327,27 +603,340 @@ namespace swr
         // Resize internal frame buffers (in pixels)
         void resize( size_t width, size_t height );
 
+        // Динамическое разрешение: задний буфер рендерится в renderScale от размера кадра (0.25..1) и
+        // растягивается в present билинейно, с опциональной резкостью (0 — выключена, 1 — максимум).
+        // Вьюпорты RS для заднего буфера задаются в пикселях кадра и пересчитываются во внутреннее разрешение
+        void setRenderScale( float scale );
+        float renderScale() const
+        {
+            return renderScaleValue;
+        }
+        size_t renderWidth() const
+        {
+            return frameBuffers.width;
+        }
+        size_t renderHeight() const
+        {
+            return frameBuffers.height;
+        }
+        void setUpscaleSharpness( float sharpness );
+        float upscaleSharpness() const
+        {
+            return sharpness;
+        }
+
+        // Число сэмплов заднего буфера: 1 или 4 (MSAA). Содержимое буфера сбрасывается.
+        // PS выполняется один раз на пиксель, покрытие и глубина — на сэмпл; resolve делается в present
+        void setSampleCount( uint32_t samples );
+        uint32_t sampleCount() const
+        {
+            return frameBuffers.sampleCount;
+        }
+
+        // Буфер видимости (отложенное затенение): растеризация пишет только глубину и номер треугольника,
+        // PS выполняется один раз на видимый пиксель при разрешении буфера. Разрешение происходит в present,
+        // при смене цели и перед draw, который нельзя отложить (смешивание, частичная маска записи, тест глубины
+        // кроме Less/LessEqual с записью, MSAA-цель) — такие draw идут прямым путём. Draw без записи цвета
+        // разрешения не вызывают. Константные буферы копируются в момент draw, текстуры читаются при разрешении
+        void setVisibilityBuffer( bool enable );
+        bool visibilityBuffer() const
+        {
+            return visibilityMode;
+        }
+        // Явное разрешение отложенных draw в текущую цель
+        void flushVisibilityBuffer();
+
+        // Раскладка пикселей заднего буфера (см. SurfaceLayout); в present он переводится в построчный порядок.
+        // Содержимое буфера сбрасывается
+        void setFramebufferLayout( SurfaceLayout layout );
+        SurfaceLayout framebufferLayout() const
+        {
+            return frameBuffers.layout;
+        }
+
+        // Формат цвета заднего буфера: RGBA16F вдвое сокращает трафик цели (смешивание по-прежнему во float).
+        // DepthOnly для заднего буфера не допускается. Содержимое буфера сбрасывается
+        void setBackBufferFormat( SurfaceFormat format );
+        SurfaceFormat backBufferFormat() const
+        {
+            return frameBuffers.colorFormat;
+        }
+
+        // fp16-варьинги: цвет вершин после VS хранится в half (см. PackedVSOutput) и интерполируется из
+        // округлённых значений. Позиции, глубина и texcoord остаются float
+        void setHalfVaryings( bool enable )
+        {
+            halfVaryingsMode = enable;
+        }
+        bool halfVaryings() const
+        {
+            return halfVaryingsMode;
+        }
+
+        // Инкрементальный рендеринг заднего буфера для статичных кадров: draw не выполняются сразу, а
+        // записываются (с копиями констант) и в endFrame сравниваются с draw прошлого кадра по параметрам,
+        // состоянию конвейера, содержимому констант и версиям буферов и текстур. Перерисовываются только
+        // тайлы kDirtyTileSize, которых касались изменившиеся draw (в прежнем и новом положении), а present
+        // выгружает в текстуру только их. Кадр без изменений не растеризуется и не выгружается.
+        // Шейдер считается новым после каждого setVertexShader/setPixelShader (именованный — только при смене
+        // имени); вершинные и индексные буферы и текстуры не должны меняться между draw одного кадра, а запись
+        // в обход uploadData/map — сопровождаться Buffer::markDirty. Кадр целиком рисуется сразу, если в нём
+        // есть другая цель, запросы, предикат, виды, косвенные draw или draw без предшествующего clear, а также
+        // при MSAA и renderScale < 1
+        static constexpr int kDirtyTileSize = 32;
+        void setIncrementalRendering( bool enable );
+        bool incrementalRendering() const
+        {
+            return incrementalMode;
+        }
+
+        // Завершение рендеринга кадра: разрешение буфера видимости, в инкрементальном режиме — перерисовка
+        // изменившихся тайлов. present вызывает его сам
+        void endFrame();
+
+        // Захват следующего кадра (от beginFrame до endFrame) в файл .swrc для swr_replay: содержимое
+        // используемых буферов и текстур, clear и draw с полным состоянием конвейера (см. swrCapture.h).
+        // Косвенные draw записываются прямыми с прочитанными аргументами, отброшенные предикатом — не
+        // записываются. Файл пишется в endFrame; ошибка записи — std::runtime_error
+        void captureFrame( const std::string &path );
+
         // Презентация отрендеренного кадра
         void present( SDL_Renderer *renderer, SDL_Texture *texture );
 
+        // Многовидовой рендеринг (стерео, грани кубической карты): каждый draw растеризуется во все виды,
+        // а VS выполняется один раз. Позиция из VS — до преобразования вида (обычно мировая), clip space
+        // вида v получается умножением на views[v].viewProj; остальные выходы VS общие. Треугольник
+        // растеризуется в вьюпорт и цель своего вида, номер вида в PS — ShaderContext::viewId().
+        // Пустой список выключает режим. Текстуры прежних видов при смене разрешаются, как цель OM.
+        // Больше kMaxViews видов — std::out_of_range
+        void setViews( const std::vector<ViewDesc> &views );
+        size_t viewCount() const
+        {
+            return viewDescs.size();
+        }
+
         // Управление рендерингом кадра
+        // Начало кадра: сброс кадровой арены (временная память конвейера предыдущего кадра освобождается)
+        // и кольца констант
+        void beginFrame();
+        // В многовидовом режиме очищаются и цели видов
         void clear();
         void draw( size_t vertexCount, size_t startVertexLocation );
         void drawIndexed( size_t indexCount, size_t startIndexLocation, size_t baseVertexLocation );
+        // Экземпляры прогоняются по очереди, номер экземпляра — ShaderContext::instanceId()
+        void drawInstanced( size_t vertexCountPerInstance, size_t instanceCount, size_t startVertexLocation,
+                            size_t startInstanceLocation );
+        void drawIndexedInstanced( size_t indexCountPerInstance, size_t instanceCount, size_t startIndexLocation,
+                                   int32_t baseVertexLocation, size_t startInstanceLocation );
+
+        // Косвенные draw: аргументы читаются из буфера args со смещения byteOffset (например, их записал
+        // проход отсечения). Проверка состояния конвейера, предикат и снимок состояния PS делаются один раз
+        // на вызов, а не на запись. Запись, выходящая за вершинный/индексный буфер, пропускается;
+        // args за пределами буфера — std::out_of_range
+        void drawIndirect( const std::shared_ptr<Buffer> &args, size_t byteOffset );
+        void drawIndexedIndirect( const std::shared_ptr<Buffer> &args, size_t byteOffset );
+        // maxDrawCount записей с шагом stride (0 — sizeof(DrawIndexedArguments)). Если задан countBuffer,
+        // число записей — min(maxDrawCount, uint32 по смещению countOffset), как в DrawIndexedIndirectCount
+        void multiDrawIndexedIndirect( const std::shared_ptr<Buffer> &args, size_t byteOffset, size_t maxDrawCount,
+                                       size_t stride = 0, const std::shared_ptr<Buffer> &countBuffer = nullptr,
+                                       size_t countOffset = 0 );
+
+        // Использование кадровой арены (VS output и прочие временные данные конвейера)
+        FrameMemoryStats frameMemoryStats() const
+        {
+            return frameArena.stats();
+        }
+
+        // Кольцо констант на кадр: вместо uploadData в один общий буфер перед каждым draw (что заставляет
+        // отложенные draw копировать буфер целиком) константы каждого draw пишутся в свой участок страницы
+        // и привязываются к слоту через VS()/PS().setConstants. Данные действительны до следующего beginFrame,
+        // начало участка выровнено на kConstantAlignment. Только для потока рендеринга
+        static constexpr size_t kConstantPageSize = 64 * 1024;
+        static constexpr size_t kConstantAlignment = 16;
+        ConstantAllocation allocateConstants( size_t bytes );
+
+        template <typename T> ConstantBinding pushConstants( const T &value )
+        {
+            static_assert( std::is_trivially_copyable<T>::value, "pushConstants: T must be trivially copyable" );
+            static_assert( alignof( T ) <= kConstantAlignment, "pushConstants: T is over-aligned" );
+            ConstantAllocation alloc = allocateConstants( sizeof( T ) );
+            std::memcpy( alloc.data, &value, sizeof( T ) );
+            return alloc.binding;
+        }
+
+        // Байт кольца констант, выделенных с начала кадра
+        size_t constantBytesThisFrame() const
+        {
+            return constantBytes;
+        }
+
+        const PipelineStatistics &pipelineStatistics() const
+        {
+            return stats;
+        }
 
       private:
-        // Внутренний метод растеризации одного треугольника (после VS)
-        void rasterizeTri( const VSOutput &v0, const VSOutput &v1, const VSOutput &v2, const ShaderContext &ctx );
-        // Приватный конструктор: инициализация внутренних буферов, без shared_from_this()
-        Device( size_t width, size_t height )
-            : iaStage( std::shared_ptr<Device>() ), vsStage( std::shared_ptr<Device>() ),
-              rsStage( std::shared_ptr<Device>() ), psStage( std::shared_ptr<Device>() ),
-              omStage( std::shared_ptr<Device>() ), frameWidth( width ), frameHeight( height )
+        // Переключение поверхности, в которую пишет растеризатор (вызывается из OMStage::setRenderTarget)
+        void bindRenderTarget( const std::shared_ptr<Texture2D> &texture );
+        ShaderContext makeShaderContext() const
         {
-            frameBuffers.colorBuffer.resize( width * height, glm::vec4( 0.0f ) );
-            frameBuffers.depthBuffer.resize( width * height, 1.0f );
+            return ShaderContext( vsStage.constantBuffers, psStage.constantBuffers, psStage.textures,
+                                  psStage.samplers );
         }
 
+        // Размер заднего буфера с учётом renderScale
+        size_t scaledSize( size_t size ) const;
+        void resizeBackBuffer( uint32_t samples, SurfaceLayout layout, SurfaceFormat format );
+        // Растяжение заднего буфера до размера кадра: копия при renderScale == 1, иначе билинейно
+        void upscaleToOutput( void *pixels, int pitch, const SDL_PixelFormatDetails *pf );
+
+        // true — draw пропускается по предикату
+        bool predicatedOff();
+        // Проверка состояния IA/VS перед draw (один раз на вызов, в том числе косвенный)
+        bool validateDraw( bool indexed ) const;
+        // Тело draw/drawIndexed для одного экземпляра (состояние уже проверено, ctx.instance задан)
+        void drawVertices( size_t vertexCount, size_t startVertexLocation, const ShaderContext &ctx, bool deferred );
+        void drawIndices( size_t indexCount, size_t startIndexLocation, uint32_t baseVertex, const ShaderContext &ctx,
+                          bool deferred );
+
+        // Треугольник после VS, подготовленный к обходу пикселей: экранные вершины, ограничивающий
+        // прямоугольник в цели и постоянные на треугольнике производные
+        struct TriangleSetup
+        {
+            glm::vec2 s0, s1, s2; // Экранные позиции вершин
+            float area;           // Ориентированная площадь (edgeFunction)
+            int minX, minY, maxX, maxY;
+            glm::vec3 invWv; // 1/w вершин
+            glm::vec3 zv;    // z_ndc вершин
+            glm::vec3 dBdx, dBdy;
+            glm::vec2 uvW0, uvW1, uvW2; // texcoord / w
+            glm::vec2 dUdx, dUdy;
+            float dWdx, dWdy;
+            glm::vec3 c0, c1, c2; // Цвета вершин
+            uint32_t drawId;      // Номер отложенного draw (только для буфера видимости)
+            uint32_t view;        // Номер вида (ShaderContext::viewId)
+        };
+
+        // Состояние PS отложенного draw; константные буферы — копии, сделанные при draw
+        // (участки кольца констант не копируются: они неизменны до конца кадра)
+        struct DeferredDraw
+        {
+            PixelShader pixelShader;
+            std::vector<ConstantBinding> vsConstantBuffers;
+            std::vector<ConstantBinding> psConstantBuffers;
+            std::vector<std::shared_ptr<Texture2D>> textures;
+            std::vector<SamplerState> samplers;
+        };
+
+        // Прямоугольник пикселей [minX, maxX] x [minY, maxY]; minX > maxX — пустой
+        struct PixelRect
+        {
+            int minX, minY, maxX, maxY;
+        };
+        static constexpr PixelRect kEmptyRect{ std::numeric_limits<int>::max(), std::numeric_limits<int>::max(),
+                                               std::numeric_limits<int>::min(), std::numeric_limits<int>::min() };
+        static constexpr PixelRect kNoScissor{ 0, 0, std::numeric_limits<int>::max(), std::numeric_limits<int>::max() };
+
+        // Draw инкрементального кадра: аргументы, снимок состояния конвейера и копии констант (vsConstants и
+        // psConstants подменяют привязки стадий при выполнении). bounds — пиксели, которых касались его
+        // треугольники, без учёта прямоугольника перерисовки
+        struct RecordedDraw
+        {
+            RecordedDraw( const IAStage &ia, const VSStage &vs, const RSStage &rs, const PSStage &ps,
+                          const OMStage &om )
+                : ia( ia ), vs( vs ), rs( rs ), ps( ps ), om( om )
+            {
+            }
+            bool indexed = false;
+            size_t count = 0;
+            size_t instanceCount = 0;
+            size_t start = 0;
+            int32_t baseVertex = 0;
+            size_t startInstance = 0;
+            IAStage ia;
+            VSStage vs;
+            RSStage rs;
+            PSStage ps;
+            OMStage om;
+            bool halfVaryings = false;
+            std::vector<ConstantBinding> vsConstants;
+            std::vector<ConstantBinding> psConstants;
+            uint64_t vertexVersion = 0;
+            uint64_t indexVersion = 0;
+            std::vector<uint64_t> textureVersions;
+            PixelRect bounds = kEmptyRect;
+        };
+
+        // Захват кадра (swrCapture.cpp): clear и выполняемые draw пишутся до выполнения
+        void beginCapture();
+        void captureClear();
+        void captureDraw( bool indexed, size_t count, size_t instanceCount, size_t start, int32_t baseVertex,
+                          size_t startInstance );
+        void finishCapture();
+
+        // Инкрементальный режим: draw записывается вместо выполнения; false — draw выполняется сразу
+        bool recordDraw( bool indexed, size_t count, size_t instanceCount, size_t start, int32_t baseVertex,
+                         size_t startInstance );
+        // Дальше кадр рисуется сразу: записанное выполняется целиком, следующий кадр сравнивать не с чем
+        void stopRecording();
+        // Выполнение записанного draw с его состоянием; deferrable — можно отложить в буфер видимости
+        void executeRecorded( RecordedDraw &draw, bool deferrable );
+        static bool sameDraw( const RecordedDraw &a, const RecordedDraw &b );
+        // Копии констант draw для записи: и обычные буферы, и участки кольца, которое переиспользуется в следующем
+        // кадре. Копии остаются в слоте записи и перезаписываются на месте, пока совпадает размер
+        void snapshotConstants( const std::vector<ConstantBinding> &src, std::vector<ConstantBinding> &dst );
+        // Сравнение записанного кадра с прошлым и перерисовка грязных тайлов (dirtyRects)
+        void renderIncrementalFrame();
+        // Больше kMaxDirtyRects прямоугольников сливаются в один общий
+        static constexpr size_t kMaxDirtyRects = 16;
+        void buildDirtyRects( int tilesX, int tilesY );
+
+        // Подготовка треугольника; false — треугольник отброшен (вырожден, задняя грань, вне цели).
+        // Без MSAA прямоугольник сужается до центров пикселей, так что треугольник, не накрывающий ни одного
+        // центра по ограничивающему прямоугольнику, отбрасывается здесь же
+        bool setupTriangle( const VSOutput &v0, const VSOutput &v1, const VSOutput &v2, TriangleSetup &tri ) const;
+        // Постоянные на треугольнике производные и атрибуты (после setupTriangle, только для растеризуемых)
+        static void setupAttributes( const VSOutput &v0, const VSOutput &v1, const VSOutput &v2, TriangleSetup &tri );
+        // Мелкий треугольник (прямоугольник не больше kSmallTriangleDim пикселей по каждой оси, без MSAA):
+        // покрытие центров сразу считается маской, бит (y - minY) * kSmallTriangleDim + (x - minX). edges
+        // получает значения edgeFunction в центрах покрытых пикселей (по номеру бита) для барицентриков
+        static constexpr int kSmallTriangleDim = 4;
+        static uint32_t smallTriangleCoverage( const TriangleSetup &tri, glm::vec3 *edges );
+        // Нормированные барицентрики точки и вход PS в ней (общие для прямого пути и буфера видимости)
+        static glm::vec3 barycentricAt( const TriangleSetup &tri, const glm::vec2 &p );
+        static PSInput interpolate( const TriangleSetup &tri, const glm::vec3 &w, float denom, float depth );
+        // Primitive assembly: треугольник после VS растеризуется один раз или, в многовидовом режиме,
+        // в каждый вид со своей позицией, вьюпортом и целью
+        void assembleTri( const VSOutput &v0, const VSOutput &v1, const VSOutput &v2, const ShaderContext &ctx,
+                          bool deferred );
+        // Вьюпорт текущего вида: свой у вида или RS (нулевой размер — вся цель)
+        const Viewport &activeViewport() const;
+        // Внутренний метод растеризации одного треугольника (после VS).
+        // deferred — треугольник пишется в буфер видимости, PS откладывается.
+        // Без записи цвета (PS не задан, маска записи пуста или цель без цвета) — только глубина
+        void rasterizeTri( const VSOutput &v0, const VSOutput &v1, const VSOutput &v2, const ShaderContext &ctx,
+                           bool deferred );
+        // Цвет draw может попасть в цель: есть PS, маска записи и буфер цвета
+        bool colorWriteEnabled() const;
+        // Проход только глубины (без MSAA и wireframe): без атрибутов и PS, строка блока из kBlendBlockSize
+        // пикселей проверяется и пишется векторно. Глубина в точности та же, что в полном пути, поэтому
+        // Z-prepass и последующий проход с DepthFunc::Equal совпадают. Возвращает число прошедших пикселей
+        uint64_t rasterizeDepthOnly( const TriangleSetup &tri );
+        // Начало draw в режиме буфера видимости: true — draw откладывается (состояние PS сохранено),
+        // false — draw идёт прямым путём (при необходимости отложенное перед ним уже разрешено)
+        bool beginDeferredDraw();
+        void copyConstantBuffers( const std::vector<ConstantBinding> &src, std::vector<ConstantBinding> &dst );
+        // Отложенные треугольники отбрасываются без затенения (цель очищена или пересоздана)
+        void discardVisibilityBuffer();
+        // Обход пикселей треугольника для цели с MSAA (функторы покрытия/барицентрик/PS — из rasterizeTri)
+        template <typename CoverFn, typename BarycentricFn, typename ShadeFn>
+        uint64_t rasterizeTriMultisample( int minX, int minY, int maxX, int maxY, const CoverFn &covers,
+                                      const BarycentricFn &barycentricAt, const ShadeFn &shade, const glm::vec3 &zv,
+                                      const glm::vec3 &invWv, const glm::vec3 &dBdx, const glm::vec3 &dBdy );
+        // Приватный конструктор: инициализация внутренних буферов, без shared_from_this().
+        // Определён в swrDevice.cpp: члену capture нужен полный тип CaptureWriter
+        Device( size_t width, size_t height );
+
         // Инициализация стадий после создания shared_ptr<Device>
         void initStages( const std::shared_ptr<Device> &self )
         {
@@ -363,15 +952,69 @@ namespace swr
         PSStage psStage;
         OMStage omStage;
 
-        struct InternalFrameBuffers
-        {
-            std::vector<glm::vec4> colorBuffer; // RGBA color buffer
-            std::vector<float> depthBuffer;     // Depth buffer
-        };
-
-        InternalFrameBuffers frameBuffers;
-        size_t frameWidth;
+        RenderSurface frameBuffers;             // Задний буфер (выводится в present)
+        RenderSurface *target = &frameBuffers; // Текущая цель растеризатора
+        // Временная память конвейера, живущая не дольше кадра (по арене на поток)
+        FrameArena frameArena;
+        // Учёт памяти ресурсов и пул буферов; делетеры держат его сами, поэтому ресурс может пережить устройство
+        std::shared_ptr<DeviceMemory> memory = std::make_shared<DeviceMemory>();
+        // Кольцо констант: страницы по kConstantPageSize, заполняются подряд и переиспользуются с beginFrame
+        std::vector<std::shared_ptr<Buffer>> constantPages;
+        size_t constantPage = 0;   // Текущая страница
+        size_t constantOffset = 0; // Занято байт в текущей странице
+        size_t constantBytes = 0;  // Выделено за кадр (с выравниванием)
+        PipelineStatistics stats;
+        size_t frameWidth;  // Размер выходного кадра (текстуры present)
         size_t frameHeight;
+        OcclusionQuery *activeQuery = nullptr; // Запрос между beginQuery/endQuery
+        std::shared_ptr<OcclusionQuery> predicate;
+        bool predicateValue = false;
+        float renderScaleValue = 1.0f;
+        float sharpness = 0.0f;
+        bool halfVaryingsMode = false;
+        std::vector<glm::vec4> sharpenScratch; // Задний буфер после повышения резкости (только при апскейле)
+        std::vector<glm::vec4> linearScratch;  // Тайловый или RGBA16F задний буфер построчно во float (present)
+
+        // Буфер видимости: номер треугольника в visTriangles на пиксель текущей цели (kNoTriangle — пусто).
+        // visDraws не укорачивается, чтобы копии константных буферов переиспользовались между кадрами
+        static constexpr uint32_t kNoTriangle = UINT32_MAX;
+        bool visibilityMode = false;
+        std::vector<uint32_t> visibilityIds;
+        std::vector<TriangleSetup> visTriangles;
+        std::vector<DeferredDraw> visDraws;
+        size_t visDrawCount = 0;
+        int visMinX = 0, visMinY = 0, visMaxX = -1, visMaxY = -1; // Прямоугольник с отложенными пикселями
+
+        // Многовидовой режим: описания видов и их поверхности (nullptr — цель OM), текущий вид растеризации
+        std::vector<ViewDesc> viewDescs;
+        std::vector<RenderSurface *> viewSurfaces;
+        uint32_t currentView = 0;
+
+        // Инкрементальный рендеринг: draw текущего и прошлого кадра (слоты переиспользуются между кадрами)
+        bool incrementalMode = false;
+        bool recording = false;     // Draw кадра записываются (до endFrame или stopRecording)
+        bool frameCleared = false;  // В записываемом кадре был clear до первого draw
+        bool previousValid = false; // previousDraws — полный кадр заднего буфера, с ним можно сравнивать
+        bool uploadAll = true;      // present выгружает кадр целиком, иначе только dirtyRects
+        glm::vec4 recordedClearColor{ 0.0f };
+        float recordedClearDepth = 1.0f;
+        glm::vec4 previousClearColor{ 0.0f };
+        float previousClearDepth = 1.0f;
+        std::vector<RecordedDraw> recordedDraws;
+        size_t recordedCount = 0;
+        std::vector<RecordedDraw> previousDraws;
+        size_t previousCount = 0;
+        std::vector<uint8_t> dirtyTiles;   // На тайл kDirtyTileSize: 1 — перерисовывается
+        std::vector<PixelRect> dirtyRects; // Грязные тайлы, объединённые в прямоугольники
+        SDL_Texture *presentedTexture = nullptr; // Текстура прошлого present: в другую выгружается весь кадр
+        // Растеризация ограничена прямоугольником scissor; пиксели выполняемого записанного draw копятся
+        // в drawBounds
+        PixelRect scissor = kNoScissor;
+        PixelRect *drawBounds = nullptr;
+
+        // Захват кадра: путь ждёт следующего beginFrame, capture пишет кадр до endFrame
+        std::string capturePath;
+        std::unique_ptr<CaptureWriter> capture;
     };
 
-} // namespace swr
\ No newline at end of file
+} // namespace swr
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "swrDynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace swr
+{
+    DynamicResolutionController::DynamicResolutionController( const DynamicResolutionSettings &settings )
+        : config( settings )
+    {
+        reset( config.maxScale );
+    }
+
+    void DynamicResolutionController::reset( float scale )
+    {
+        currentScale = std::clamp( scale, config.minScale, config.maxScale );
+        averageMs = 0.0f;
+        hasSamples = false;
+    }
+
+    float DynamicResolutionController::update( float renderMs )
+    {
+        if( !( renderMs > 0.0f ) )
+            return currentScale;
+
+        averageMs = hasSamples ? averageMs + ( renderMs - averageMs ) * config.smoothing : renderMs;
+        hasSamples = true;
+
+        const float budget = config.targetFrameMs * config.headroom;
+        const float desired = currentScale * std::sqrt( budget / averageMs );
+        if( std::abs( desired - currentScale ) <= config.deadband * currentScale )
+            return currentScale;
+
+        float next = std::clamp( desired, currentScale - config.maxStep, currentScale + config.maxStep );
+        next = std::clamp( next, config.minScale, config.maxScale );
+        if( next != currentScale )
+        {
+            // Прогноз: среднее время пересчитывается под новый масштаб, иначе регулятор
+            // ещё несколько кадров реагировал бы на время старого разрешения и перелетал цель
+            averageMs *= ( next * next ) / ( currentScale * currentScale );
+            currentScale = next;
+        }
+        return currentScale;
+    }
+} // namespace swr
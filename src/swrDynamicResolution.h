@@ -0,0 +1,47 @@
+#pragma once
+
+namespace swr
+{
+    struct DynamicResolutionSettings
+    {
+        float targetFrameMs = 16.6f; // Целевое время рендеринга кадра
+        float headroom = 0.9f;       // Целимся чуть ниже цели, чтобы всплески не выбивали за бюджет
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        float smoothing = 0.15f; // Вес нового замера в скользящем среднем времени кадра
+        float maxStep = 0.05f;   // Максимальное изменение масштаба за кадр
+        float deadband = 0.03f;  // Относительное отклонение, в пределах которого масштаб не меняется
+    };
+
+    // Регулятор масштаба внутреннего разрешения (Device::setRenderScale) по измеренному времени кадра.
+    // Стоимость кадра считается пропорциональной числу пикселей, т.е. квадрату масштаба:
+    // s' = s * sqrt(target / t). Сглаживание, мёртвая зона и ограничение шага убирают «дрожание» разрешения
+    class DynamicResolutionController
+    {
+      public:
+        explicit DynamicResolutionController( const DynamicResolutionSettings &settings = {} );
+
+        // Учитывает время рендеринга кадра (мс, без ожидания vsync) и возвращает масштаб для следующего кадра
+        float update( float renderMs );
+        void reset( float scale = 1.0f );
+
+        float scale() const
+        {
+            return currentScale;
+        }
+        float smoothedFrameMs() const
+        {
+            return averageMs;
+        }
+        const DynamicResolutionSettings &settings() const
+        {
+            return config;
+        }
+
+      private:
+        DynamicResolutionSettings config;
+        float currentScale = 1.0f;
+        float averageMs = 0.0f;
+        bool hasSamples = false;
+    };
+} // namespace swr
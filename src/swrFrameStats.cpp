@@ -0,0 +1,107 @@
+#include "swrFrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ostream>
+#include <string>
+
+namespace swr
+{
+    namespace
+    {
+        // Корзины гистограммы: [0, 0.25), [0.25, 0.5), ... , [512, 1024), [1024, inf) мс
+        constexpr double kFirstBucketMs = 0.25;
+        constexpr int kBucketCount = 14;
+        constexpr int kBarWidth = 50;
+
+        int bucketOf( double ms )
+        {
+            if( ms < kFirstBucketMs )
+                return 0;
+            const int b = 1 + static_cast<int>( std::floor( std::log2( ms / kFirstBucketMs ) ) );
+            return std::min( b, kBucketCount - 1 );
+        }
+
+        double bucketLow( int b )
+        {
+            return b == 0 ? 0.0 : kFirstBucketMs * std::ldexp( 1.0, b - 1 );
+        }
+    } // unnamed namespace
+
+    void FrameTimeStats::reserve( size_t frames )
+    {
+        samples.reserve( frames );
+    }
+
+    void FrameTimeStats::add( double ms )
+    {
+        samples.push_back( ms );
+        sum += ms;
+    }
+
+    void FrameTimeStats::reset()
+    {
+        samples.clear();
+        sum = 0.0;
+    }
+
+    double FrameTimeStats::mean() const
+    {
+        return samples.empty() ? 0.0 : sum / static_cast<double>( samples.size() );
+    }
+
+    double FrameTimeStats::min() const
+    {
+        return samples.empty() ? 0.0 : *std::min_element( samples.begin(), samples.end() );
+    }
+
+    double FrameTimeStats::max() const
+    {
+        return samples.empty() ? 0.0 : *std::max_element( samples.begin(), samples.end() );
+    }
+
+    double FrameTimeStats::percentile( double p ) const
+    {
+        if( samples.empty() )
+            return 0.0;
+        // nearest-rank: наименьшее значение, не меньше которого p% замеров
+        const size_t n = samples.size();
+        const double rank = std::ceil( std::clamp( p, 0.0, 100.0 ) / 100.0 * static_cast<double>( n ) );
+        const size_t k = std::min( n - 1, static_cast<size_t>( std::max( rank, 1.0 ) ) - 1 );
+        std::vector<double> sorted( samples );
+        std::nth_element( sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>( k ), sorted.end() );
+        return sorted[k];
+    }
+
+    void FrameTimeStats::print( std::ostream &out, const char *label ) const
+    {
+        char line[160];
+        if( samples.empty() )
+        {
+            out << label << ": no frames" << std::endl;
+            return;
+        }
+        std::snprintf( line, sizeof( line ),
+                       "%s: %zu frames, %.1f fps | min %.3f  mean %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f ms",
+                       label, samples.size(), sum > 0.0 ? 1000.0 * static_cast<double>( samples.size() ) / sum : 0.0,
+                       min(), mean(), percentile( 50.0 ), percentile( 95.0 ), percentile( 99.0 ), max() );
+        out << line << std::endl;
+
+        size_t counts[kBucketCount] = {};
+        for( double ms : samples )
+            ++counts[bucketOf( ms )];
+        const size_t peak = *std::max_element( counts, counts + kBucketCount );
+        const int first = bucketOf( min() ), last = bucketOf( max() );
+        for( int b = first; b <= last; ++b )
+        {
+            const int bar = static_cast<int>( ( counts[b] * kBarWidth + peak - 1 ) / peak );
+            if( b == kBucketCount - 1 )
+                std::snprintf( line, sizeof( line ), "  %8.2f -     inf ms %7zu |", bucketLow( b ), counts[b] );
+            else
+                std::snprintf( line, sizeof( line ), "  %8.2f - %7.2f ms %7zu |", bucketLow( b ), bucketLow( b + 1 ),
+                               counts[b] );
+            out << line << std::string( static_cast<size_t>( bar ), '#' ) << std::endl;
+        }
+    }
+} // namespace swr
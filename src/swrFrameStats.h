@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+namespace swr
+{
+    // Накопитель времён кадра (мс) для бенчмарка: перцентили и гистограмма по завершении прогона.
+    // Хранит все замеры — перцентили точные, а не приближённые по корзинам
+    class FrameTimeStats
+    {
+      public:
+        void reserve( size_t frames );
+        void add( double ms );
+        void reset();
+
+        size_t count() const
+        {
+            return samples.size();
+        }
+        double total() const
+        {
+            return sum;
+        }
+        double mean() const;
+        double min() const;
+        double max() const;
+        // Перцентиль по рангу (p в [0, 100]); 0 при отсутствии замеров
+        double percentile( double p ) const;
+
+        // Сводка (min/mean/p50/p95/p99/max, кадров в секунду) и гистограмма в корзинах по степеням двойки
+        void print( std::ostream &out, const char *label ) const;
+
+      private:
+        std::vector<double> samples;
+        double sum = 0.0;
+    };
+} // namespace swr
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+#include "swrSimd.h"
+
+namespace swr
+{
+    // Число половинной точности (IEEE 754 binary16): знак, 5 бит порядка, 10 бит мантиссы.
+    // Относительная точность ~1/2048, максимум 65504 — для цвета с запасом, а памяти вдвое меньше, чем у float
+    using half = uint16_t;
+
+    // Четыре half подряд (RGBA16F, 8 байт): пиксель цели или цвет вершины
+    struct Half4
+    {
+        half x, y, z, w;
+    };
+
+    namespace detail
+    {
+        // Программное преобразование с округлением к ближайшему чётному (как F16C с _MM_FROUND_TO_NEAREST_INT)
+        inline half floatToHalfSoft( float f )
+        {
+            uint32_t x;
+            std::memcpy( &x, &f, sizeof( x ) );
+            const half sign = static_cast<half>( ( x >> 16 ) & 0x8000u );
+            x &= 0x7FFFFFFFu;
+            if( x >= 0x7F800000u ) // Inf, NaN (остаётся тихим NaN)
+                return sign | 0x7C00u | ( x > 0x7F800000u ? 0x0200u : 0u );
+            if( x >= 0x47800000u ) // >= 65536: переполнение в Inf
+                return sign | 0x7C00u;
+            if( x < 0x38800000u )
+            {
+                // Меньше 2^-14: денормализованное half или ноль
+                if( x < 0x33000000u )
+                    return sign;
+                const uint32_t mant = ( x & 0x7FFFFFu ) | 0x800000u;
+                const uint32_t shift = 126u - ( x >> 23 );
+                const uint32_t rem = mant & ( ( 1u << shift ) - 1u ), halfway = 1u << ( shift - 1u );
+                uint32_t r = mant >> shift;
+                if( rem > halfway || ( rem == halfway && ( r & 1u ) ) )
+                    ++r;
+                return static_cast<half>( sign | r );
+            }
+            // Нормализованное: смена смещения порядка 127 -> 15; перенос при округлении корректно даёт Inf
+            uint32_t r = ( x - 0x38000000u ) >> 13;
+            const uint32_t rem = x & 0x1FFFu;
+            if( rem > 0x1000u || ( rem == 0x1000u && ( r & 1u ) ) )
+                ++r;
+            return static_cast<half>( sign | r );
+        }
+
+        inline float halfToFloatSoft( half h )
+        {
+            const uint32_t sign = static_cast<uint32_t>( h & 0x8000u ) << 16;
+            uint32_t exp = ( h >> 10 ) & 0x1Fu, mant = h & 0x3FFu;
+            uint32_t bits;
+            if( exp == 0x1Fu )
+                bits = sign | 0x7F800000u | ( mant << 13 );
+            else if( exp != 0 )
+                bits = sign | ( ( exp + 112u ) << 23 ) | ( mant << 13 );
+            else if( mant == 0 )
+                bits = sign;
+            else
+            {
+                // Денормализованное half — нормализованное float
+                exp = 113u;
+                while( !( mant & 0x400u ) )
+                {
+                    mant <<= 1;
+                    --exp;
+                }
+                bits = sign | ( exp << 23 ) | ( ( mant & 0x3FFu ) << 13 );
+            }
+            float f;
+            std::memcpy( &f, &bits, sizeof( f ) );
+            return f;
+        }
+    } // namespace detail
+
+    inline half floatToHalf( float f )
+    {
+#if SWR_F16C
+        return static_cast<half>( _cvtss_sh( f, _MM_FROUND_TO_NEAREST_INT ) );
+#else
+        return detail::floatToHalfSoft( f );
+#endif
+    }
+
+    inline float halfToFloat( half h )
+    {
+#if SWR_F16C
+        return _cvtsh_ss( h );
+#else
+        return detail::halfToFloatSoft( h );
+#endif
+    }
+
+    inline Half4 packHalf4( const glm::vec4 &v )
+    {
+        Half4 h;
+#if SWR_F16C
+        // Одна инструкция на 4 компоненты
+        _mm_storel_epi64( reinterpret_cast<__m128i *>( &h ),
+                          _mm_cvtps_ph( _mm_loadu_ps( &v.x ), _MM_FROUND_TO_NEAREST_INT ) );
+#else
+        h.x = detail::floatToHalfSoft( v.x );
+        h.y = detail::floatToHalfSoft( v.y );
+        h.z = detail::floatToHalfSoft( v.z );
+        h.w = detail::floatToHalfSoft( v.w );
+#endif
+        return h;
+    }
+
+    inline glm::vec4 unpackHalf4( const Half4 &h )
+    {
+#if SWR_F16C
+        glm::vec4 v;
+        _mm_storeu_ps( &v.x, _mm_cvtph_ps( _mm_loadl_epi64( reinterpret_cast<const __m128i *>( &h ) ) ) );
+        return v;
+#else
+        return glm::vec4( detail::halfToFloatSoft( h.x ), detail::halfToFloatSoft( h.y ),
+                          detail::halfToFloatSoft( h.z ), detail::halfToFloatSoft( h.w ) );
+#endif
+    }
+} // namespace swr
@@ -0,0 +1,92 @@
+#include "swrMappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace swr
+{
+
+#ifdef _WIN32
+    std::shared_ptr<MappedFile> MappedFile::open( const std::string &path )
+    {
+        std::shared_ptr<MappedFile> mf( new MappedFile() );
+        HANDLE file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+        if( file == INVALID_HANDLE_VALUE )
+            throw std::runtime_error( "MappedFile: cannot open " + path );
+        mf->fileHandle = file;
+
+        LARGE_INTEGER size;
+        if( !GetFileSizeEx( file, &size ) )
+            throw std::runtime_error( "MappedFile: cannot query size of " + path );
+        mf->length = static_cast<size_t>( size.QuadPart );
+        if( mf->length == 0 )
+            return mf; // Пустой файл отображать нельзя, но это не ошибка
+
+        HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+        if( !mapping )
+            throw std::runtime_error( "MappedFile: CreateFileMapping failed for " + path );
+        mf->mappingHandle = mapping;
+
+        void *view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+        if( !view )
+            throw std::runtime_error( "MappedFile: MapViewOfFile failed for " + path );
+        mf->base = static_cast<const uint8_t *>( view );
+        return mf;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if( base )
+            UnmapViewOfFile( base );
+        if( mappingHandle )
+            CloseHandle( static_cast<HANDLE>( mappingHandle ) );
+        if( fileHandle )
+            CloseHandle( static_cast<HANDLE>( fileHandle ) );
+    }
+#else
+    std::shared_ptr<MappedFile> MappedFile::open( const std::string &path )
+    {
+        std::shared_ptr<MappedFile> mf( new MappedFile() );
+        mf->fd = ::open( path.c_str(), O_RDONLY );
+        if( mf->fd < 0 )
+            throw std::runtime_error( "MappedFile: cannot open " + path );
+
+        struct stat st;
+        if( fstat( mf->fd, &st ) != 0 )
+            throw std::runtime_error( "MappedFile: cannot stat " + path );
+        mf->length = static_cast<size_t>( st.st_size );
+        if( mf->length == 0 )
+            return mf; // Пустой файл отображать нельзя, но это не ошибка
+
+        void *addr = mmap( nullptr, mf->length, PROT_READ, MAP_PRIVATE, mf->fd, 0 );
+        if( addr == MAP_FAILED )
+            throw std::runtime_error( "MappedFile: mmap failed for " + path );
+        mf->base = static_cast<const uint8_t *>( addr );
+        return mf;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if( base )
+            munmap( const_cast<uint8_t *>( base ), length );
+        if( fd >= 0 )
+            ::close( fd );
+    }
+#endif
+
+} // namespace swr
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace swr
+{
+    // Файл, отображённый в память только для чтения (mmap / MapViewOfFile).
+    // Страницы подгружаются ОС по требованию, поэтому "загрузка" большого файла мгновенная,
+    // а данные не дублируются в куче.
+    class MappedFile
+    {
+      public:
+        // Открывает и отображает файл целиком; бросает std::runtime_error при ошибке
+        static std::shared_ptr<MappedFile> open( const std::string &path );
+
+        ~MappedFile();
+        MappedFile( const MappedFile & ) = delete;
+        MappedFile &operator=( const MappedFile & ) = delete;
+
+        const uint8_t *data() const
+        {
+            return base;
+        }
+
+        size_t size() const
+        {
+            return length;
+        }
+
+      private:
+        MappedFile() = default;
+
+        const uint8_t *base = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        void *fileHandle = nullptr;
+        void *mappingHandle = nullptr;
+#else
+        int fd = -1;
+#endif
+    };
+} // namespace swr
@@ -0,0 +1,188 @@
+#include "swrMemory.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace swr
+{
+    DeviceMemory::~DeviceMemory()
+    {
+        trimTo( 0 );
+    }
+
+    size_t DeviceMemory::sizeClass( size_t bytes )
+    {
+        if( bytes <= kMinBlockSize )
+            return 0;
+        // 2^shift < bytes <= 2^(shift+1): интервал делится на 4 класса с шагом 2^(shift-2)
+        size_t shift = 8;
+        while( ( size_t( 2 ) << shift ) < bytes )
+            ++shift;
+        const size_t step = size_t( 1 ) << ( shift - 2 );
+        const size_t sub = ( bytes - ( size_t( 1 ) << shift ) - 1 ) / step;
+        return ( shift - 8 ) * 4 + sub + 1;
+    }
+
+    size_t DeviceMemory::classSize( size_t index )
+    {
+        if( index == 0 )
+            return kMinBlockSize;
+        const size_t shift = 8 + ( index - 1 ) / 4;
+        return ( size_t( 1 ) << shift ) + ( ( index - 1 ) % 4 + 1 ) * ( size_t( 1 ) << ( shift - 2 ) );
+    }
+
+    void DeviceMemory::add( ResourceKind kind, size_t bytes )
+    {
+        ResourceMemoryStats &k = counters.kinds[static_cast<size_t>( kind )];
+        k.liveBytes += bytes;
+        k.peakBytes = std::max( k.peakBytes, k.liveBytes );
+        ++k.count;
+        if( kind == ResourceKind::External )
+            return;
+        counters.liveBytes += bytes;
+        counters.peakBytes = std::max( counters.peakBytes, counters.liveBytes );
+    }
+
+    void DeviceMemory::remove( ResourceKind kind, size_t bytes )
+    {
+        ResourceMemoryStats &k = counters.kinds[static_cast<size_t>( kind )];
+        k.liveBytes -= bytes;
+        --k.count;
+        if( kind != ResourceKind::External )
+            counters.liveBytes -= bytes;
+    }
+
+    void DeviceMemory::trimTo( size_t limit )
+    {
+        // Сначала крупные блоки: меньше вызовов кучи на освобождённый байт
+        for( size_t index = freeBlocks.size(); index-- > 0 && counters.pooledBytes > limit; )
+        {
+            std::vector<void *> &list = freeBlocks[index];
+            while( !list.empty() && counters.pooledBytes > limit )
+            {
+                ::operator delete( list.back(), std::align_val_t( kPoolAlignment ) );
+                list.pop_back();
+                counters.pooledBytes -= classSize( index );
+            }
+        }
+    }
+
+    bool DeviceMemory::reserve( size_t bytes )
+    {
+        if( counters.budget == 0 )
+            return true;
+        if( counters.liveBytes + bytes > counters.budget )
+            return false;
+        // Свободные блоки пула тоже занимают память: при нехватке они возвращаются в кучу
+        if( counters.liveBytes + counters.pooledBytes + bytes > counters.budget )
+            trimTo( counters.budget - counters.liveBytes - bytes );
+        return true;
+    }
+
+    DeviceMemory::Block DeviceMemory::allocate( size_t bytes, size_t alignment )
+    {
+        const size_t align = std::max<size_t>( alignment, alignof( std::max_align_t ) );
+        if( align & ( align - 1 ) )
+            throw std::invalid_argument( "Buffer alignment must be a power of two" );
+        const bool pooled = bytes <= kMaxPooledSize && align <= kPoolAlignment;
+        const size_t index = pooled ? sizeClass( bytes ) : 0;
+        Block block;
+        block.size = pooled ? classSize( index ) : std::max<size_t>( bytes, 1 );
+        block.alignment = pooled ? 0 : align;
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            if( pooled && index < freeBlocks.size() && !freeBlocks[index].empty() )
+            {
+                // Блок пула уже занимает память, бюджет проверяется только по живым ресурсам
+                if( counters.budget != 0 && counters.liveBytes + block.size > counters.budget )
+                    throw MemoryBudgetExceeded();
+                block.data = freeBlocks[index].back();
+                freeBlocks[index].pop_back();
+                counters.pooledBytes -= block.size;
+                ++counters.poolHits;
+                add( ResourceKind::Buffer, block.size );
+                return block;
+            }
+            if( !reserve( block.size ) )
+                throw MemoryBudgetExceeded();
+            if( pooled )
+                ++counters.poolMisses;
+            // Учитывается до выделения, чтобы параллельные создания не прошли бюджет вдвоём
+            add( ResourceKind::Buffer, block.size );
+        }
+        try
+        {
+            block.data = ::operator new( block.size, std::align_val_t( pooled ? kPoolAlignment : align ) );
+        }
+        catch( ... )
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            remove( ResourceKind::Buffer, block.size );
+            throw;
+        }
+        return block;
+    }
+
+    void DeviceMemory::release( const Block &block )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            remove( ResourceKind::Buffer, block.size );
+            const bool keep = block.alignment == 0 && counters.pooledBytes + block.size <= poolLimit &&
+                              ( counters.budget == 0 ||
+                                counters.liveBytes + counters.pooledBytes + block.size <= counters.budget );
+            if( keep )
+            {
+                const size_t index = sizeClass( block.size );
+                if( freeBlocks.size() <= index )
+                    freeBlocks.resize( index + 1 );
+                freeBlocks[index].push_back( block.data );
+                counters.pooledBytes += block.size;
+                return;
+            }
+        }
+        const size_t align = block.alignment == 0 ? kPoolAlignment : block.alignment;
+        ::operator delete( block.data, std::align_val_t( align ) );
+    }
+
+    void DeviceMemory::track( ResourceKind kind, size_t bytes )
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        if( kind != ResourceKind::External && !reserve( bytes ) )
+            throw MemoryBudgetExceeded();
+        add( kind, bytes );
+    }
+
+    void DeviceMemory::untrack( ResourceKind kind, size_t bytes )
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        remove( kind, bytes );
+    }
+
+    void DeviceMemory::setBudget( size_t bytes )
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        counters.budget = bytes;
+        if( bytes != 0 && counters.liveBytes + counters.pooledBytes > bytes )
+            trimTo( bytes > counters.liveBytes ? bytes - counters.liveBytes : 0 );
+    }
+
+    void DeviceMemory::setPoolLimit( size_t bytes )
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        poolLimit = bytes;
+        trimTo( bytes );
+    }
+
+    void DeviceMemory::trim()
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        trimTo( 0 );
+    }
+
+    MemoryStats DeviceMemory::stats() const
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        return counters;
+    }
+} // namespace swr
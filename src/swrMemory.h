@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace swr
+{
+    // Вид ресурса в учёте памяти устройства
+    enum class ResourceKind
+    {
+        Buffer,   // Буфер с собственной памятью (createBuffer)
+        Texture,  // Тексели всех мипов и поверхность рендеринга в текстуру
+        External, // Буфер поверх чужой памяти (createBufferFromMemory, wrapMemory): бюджет не расходует
+        Count
+    };
+
+    struct ResourceMemoryStats
+    {
+        size_t liveBytes = 0; // Занято живыми ресурсами
+        size_t peakBytes = 0; // Максимум liveBytes
+        size_t count = 0;     // Живых ресурсов
+    };
+
+    // Снимок учёта памяти устройства (Device::memoryStats)
+    struct MemoryStats
+    {
+        ResourceMemoryStats kinds[static_cast<size_t>( ResourceKind::Count )];
+        size_t liveBytes = 0;   // Собственная память живых ресурсов (Buffer + Texture)
+        size_t peakBytes = 0;   // Максимум liveBytes
+        size_t pooledBytes = 0; // Свободные блоки пула буферов
+        uint64_t poolHits = 0;  // Буферы, получившие блок из пула
+        uint64_t poolMisses = 0;
+        size_t budget = 0; // 0 — без ограничения
+
+        const ResourceMemoryStats &operator[]( ResourceKind kind ) const
+        {
+            return kinds[static_cast<size_t>( kind )];
+        }
+    };
+
+    // Создание ресурса превысило бы бюджет памяти устройства (Device::setMemoryBudget)
+    class MemoryBudgetExceeded : public std::bad_alloc
+    {
+      public:
+        const char *what() const noexcept override
+        {
+            return "swr: device memory budget exceeded";
+        }
+    };
+
+    // Учёт памяти ресурсов устройства и пул памяти буферов.
+    // Память буфера округляется вверх до класса размера (4 класса на степень двойки, потеря не больше 25%);
+    // освобождённый блок возвращается в список своего класса и отдаётся следующему буферу того же класса,
+    // так что поток геометрии одинаковых размеров не обращается к куче и не дробит её.
+    // Ресурсы создаются и уничтожаются из любых потоков (сцены загружаются в фоне), поэтому всё под мьютексом.
+    // Делетеры ресурсов держат DeviceMemory через shared_ptr: ресурс может пережить устройство
+    class DeviceMemory
+    {
+      public:
+        static constexpr size_t kMinBlockSize = 256;
+        static constexpr size_t kMaxPooledSize = size_t( 16 ) << 20; // Крупнее — напрямую из кучи
+        static constexpr size_t kPoolAlignment = 64;                  // Выравнивание блоков пула
+        static constexpr size_t kDefaultPoolLimit = size_t( 64 ) << 20;
+
+        // Блок памяти буфера
+        struct Block
+        {
+            void *data = nullptr;
+            size_t size = 0;      // Байт выделено (класс размера или точный размер вне пула)
+            size_t alignment = 0; // Выравнивание выделения вне пула; 0 — блок пула
+        };
+
+        DeviceMemory() = default;
+        ~DeviceMemory();
+        DeviceMemory( const DeviceMemory & ) = delete;
+        DeviceMemory &operator=( const DeviceMemory & ) = delete;
+
+        // Память под буфер из bytes байт с началом, выровненным на alignment (степень двойки).
+        // Бросает MemoryBudgetExceeded, если буфер не помещается в бюджет
+        Block allocate( size_t bytes, size_t alignment );
+        // Возврат памяти буфера (делетер буфера)
+        void release( const Block &block );
+
+        // Учёт ресурса, память которого выделена не пулом. Бросает MemoryBudgetExceeded (кроме External)
+        void track( ResourceKind kind, size_t bytes );
+        void untrack( ResourceKind kind, size_t bytes );
+
+        // 0 — без ограничения. Уже живые ресурсы не освобождаются, отказ получат только новые
+        void setBudget( size_t bytes );
+        // Объём свободных блоков, который пул держит для повторного использования
+        void setPoolLimit( size_t bytes );
+        // Освобождение всех свободных блоков пула
+        void trim();
+
+        MemoryStats stats() const;
+
+      private:
+        // Класс размера для bytes байт (не больше kMaxPooledSize) и размер блоков класса
+        static size_t sizeClass( size_t bytes );
+        static size_t classSize( size_t index );
+        void add( ResourceKind kind, size_t bytes );
+        void remove( ResourceKind kind, size_t bytes );
+        // Освобождает свободные блоки, пока в пуле больше limit байт
+        void trimTo( size_t limit );
+        // Бюджет позволяет занять ещё bytes байт; при нехватке сначала отдаётся память пула
+        bool reserve( size_t bytes );
+
+        mutable std::mutex mutex;
+        std::vector<std::vector<void *>> freeBlocks; // По классам размера
+        MemoryStats counters;
+        size_t poolLimit = kDefaultPoolLimit;
+    };
+} // namespace swr
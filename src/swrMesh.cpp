@@ -0,0 +1,537 @@
+#include "swrMesh.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "swrMappedFile.h"
+
+namespace swr
+{
+    static_assert( sizeof( MeshFileHeader ) == 80, "MeshFileHeader layout must stay stable" );
+    static_assert( sizeof( MeshFileElement ) == 16, "MeshFileElement layout must stay stable" );
+
+    namespace
+    {
+        size_t alignUp( size_t v, size_t a )
+        {
+            return ( v + a - 1 ) / a * a;
+        }
+
+        // Разбор и проверка заголовка .swrm; возвращает layout и заголовок
+        MeshFileHeader parseHeader( const uint8_t *bytes, size_t size, const std::string &path,
+                                    InputLayoutDesc &layout )
+        {
+            auto fail = [&]( const char *what ) { throw std::runtime_error( "Mesh " + path + ": " + what ); };
+
+            if( size < sizeof( MeshFileHeader ) )
+                fail( "file too small" );
+            MeshFileHeader hdr;
+            std::memcpy( &hdr, bytes, sizeof( hdr ) );
+            if( hdr.magic != kMeshFileMagic )
+                fail( "bad magic" );
+            if( hdr.version != kMeshFileVersion )
+                fail( "unsupported version" );
+            if( hdr.vertexStride == 0 )
+                fail( "zero vertex stride" );
+            if( hdr.indexSize != 2 && hdr.indexSize != 4 )
+                fail( "unsupported index size" );
+
+            const size_t elementsEnd =
+                sizeof( MeshFileHeader ) + size_t( hdr.elementCount ) * sizeof( MeshFileElement );
+            if( elementsEnd > size )
+                fail( "truncated layout" );
+
+            layout.elements.clear();
+            layout.stride = hdr.vertexStride;
+            for( uint32_t i = 0; i < hdr.elementCount; ++i )
+            {
+                MeshFileElement fe;
+                std::memcpy( &fe, bytes + sizeof( MeshFileHeader ) + i * sizeof( MeshFileElement ), sizeof( fe ) );
+                if( fe.semantic > static_cast<uint32_t>( Semantic::NORMAL0 ) ||
+                    fe.format > static_cast<uint32_t>( InputFormat::R32G32B32A32_FLOAT ) )
+                    fail( "bad layout element" );
+                InputElementDesc e{ static_cast<Semantic>( fe.semantic ), static_cast<InputFormat>( fe.format ),
+                                    fe.offset };
+                if( e.offset + inputFormatSize( e.format ) > hdr.vertexStride )
+                    fail( "layout element outside vertex" );
+                layout.elements.push_back( e );
+            }
+
+            // Проверки границ потоков с защитой от переполнения
+            auto streamFits = [&]( uint64_t offset, uint64_t count, uint64_t elemSize ) {
+                if( offset % kMeshStreamAlignment != 0 || offset < elementsEnd || offset > size )
+                    return false;
+                return count <= ( size - offset ) / elemSize;
+            };
+            if( !streamFits( hdr.vertexDataOffset, hdr.vertexCount, hdr.vertexStride ) )
+                fail( "vertex stream out of bounds" );
+            if( !streamFits( hdr.indexDataOffset, hdr.indexCount, hdr.indexSize ) )
+                fail( "index stream out of bounds" );
+            return hdr;
+        }
+
+        // Индексы идут в drawIndices без проверки: один последовательный проход по индексному потоку
+        // (вершинные страницы не трогаются)
+        template <typename Index>
+        void checkIndices( const uint8_t *stream, const MeshFileHeader &hdr, const std::string &path )
+        {
+            for( uint64_t i = 0; i < hdr.indexCount; ++i )
+            {
+                Index v;
+                std::memcpy( &v, stream + i * sizeof( Index ), sizeof( Index ) );
+                if( v >= hdr.vertexCount )
+                    throw std::runtime_error( "Mesh " + path + ": index out of range" );
+            }
+        }
+
+        void checkIndices( const uint8_t *fileData, const MeshFileHeader &hdr, const std::string &path )
+        {
+            const uint8_t *stream = fileData + hdr.indexDataOffset;
+            if( hdr.indexSize == 2 )
+                checkIndices<uint16_t>( stream, hdr, path );
+            else
+                checkIndices<uint32_t>( stream, hdr, path );
+        }
+
+        struct ObjVertex
+        {
+            glm::vec3 position;
+            glm::vec3 normal;
+            glm::vec2 texcoord;
+        };
+
+        // MeshData в стандартном layout: POSITION0, NORMAL0, TEXCOORD0
+        MeshData makeMeshData( const std::vector<ObjVertex> &vertices, std::vector<uint32_t> indices )
+        {
+            MeshData mesh;
+            mesh.layout.elements = {
+                { Semantic::POSITION0, InputFormat::R32G32B32_FLOAT, offsetof( ObjVertex, position ) },
+                { Semantic::NORMAL0, InputFormat::R32G32B32_FLOAT, offsetof( ObjVertex, normal ) },
+                { Semantic::TEXCOORD0, InputFormat::R32G32_FLOAT, offsetof( ObjVertex, texcoord ) },
+            };
+            mesh.layout.stride = sizeof( ObjVertex );
+            mesh.vertexCount = vertices.size();
+            mesh.vertices.resize( vertices.size() * sizeof( ObjVertex ) );
+            if( !vertices.empty() )
+                std::memcpy( mesh.vertices.data(), vertices.data(), mesh.vertices.size() );
+            mesh.indices = std::move( indices );
+            computeBounds( mesh );
+            return mesh;
+        }
+
+        struct ObjKey
+        {
+            int v, t, n;
+            bool operator==( const ObjKey &o ) const
+            {
+                return v == o.v && t == o.t && n == o.n;
+            }
+        };
+
+        struct ObjKeyHash
+        {
+            size_t operator()( const ObjKey &k ) const
+            {
+                uint64_t h = static_cast<uint32_t>( k.v );
+                h = h * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>( k.t );
+                h = h * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>( k.n );
+                return static_cast<size_t>( h ^ ( h >> 29 ) );
+            }
+        };
+
+        // OBJ индексы 1-базные, отрицательные — относительно конца списка
+        int resolveObjIndex( long idx, size_t count )
+        {
+            if( idx > 0 )
+                return static_cast<int>( idx - 1 );
+            if( idx < 0 )
+                return static_cast<int>( static_cast<long>( count ) + idx );
+            return -1;
+        }
+    } // unnamed namespace
+
+    void computeBounds( MeshData &mesh )
+    {
+        const InputElementDesc *pos = nullptr;
+        for( const auto &e : mesh.layout.elements )
+            if( e.semantic == Semantic::POSITION0 )
+                pos = &e;
+        if( !pos || mesh.vertexCount == 0 )
+        {
+            mesh.boundsMin = mesh.boundsMax = glm::vec3( 0.0f );
+            return;
+        }
+        glm::vec3 lo( std::numeric_limits<float>::max() );
+        glm::vec3 hi( -std::numeric_limits<float>::max() );
+        for( size_t i = 0; i < mesh.vertexCount; ++i )
+        {
+            float p[3];
+            std::memcpy( p, mesh.vertices.data() + i * mesh.layout.stride + pos->offset, sizeof( p ) );
+            glm::vec3 v( p[0], p[1], p[2] );
+            lo = glm::min( lo, v );
+            hi = glm::max( hi, v );
+        }
+        mesh.boundsMin = lo;
+        mesh.boundsMax = hi;
+    }
+
+    MeshData importObj( const std::string &path )
+    {
+        std::ifstream in( path );
+        if( !in )
+            throw std::runtime_error( "OBJ " + path + ": cannot open" );
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> texcoords;
+        std::vector<ObjVertex> vertices;
+        std::vector<int> vertexPosition; // Индекс позиции для каждой выходной вершины
+        std::vector<bool> vertexHasNormal;
+        std::vector<uint32_t> indices;
+        std::unordered_map<ObjKey, uint32_t, ObjKeyHash> dedup;
+
+        std::vector<uint32_t> face;
+        std::string line;
+        while( std::getline( in, line ) )
+        {
+            const char *s = line.c_str();
+            while( *s == ' ' || *s == '\t' )
+                ++s;
+            char *end = nullptr;
+            if( s[0] == 'v' && s[1] == ' ' )
+            {
+                glm::vec3 p;
+                p.x = std::strtof( s + 2, &end );
+                p.y = std::strtof( end, &end );
+                p.z = std::strtof( end, &end );
+                positions.push_back( p );
+            }
+            else if( s[0] == 'v' && s[1] == 'n' && s[2] == ' ' )
+            {
+                glm::vec3 n;
+                n.x = std::strtof( s + 3, &end );
+                n.y = std::strtof( end, &end );
+                n.z = std::strtof( end, &end );
+                normals.push_back( n );
+            }
+            else if( s[0] == 'v' && s[1] == 't' && s[2] == ' ' )
+            {
+                glm::vec2 t;
+                t.x = std::strtof( s + 3, &end );
+                t.y = std::strtof( end, &end );
+                texcoords.push_back( t );
+            }
+            else if( s[0] == 'f' && s[1] == ' ' )
+            {
+                face.clear();
+                const char *p = s + 2;
+                while( *p )
+                {
+                    while( *p == ' ' || *p == '\t' || *p == '\r' )
+                        ++p;
+                    if( !*p )
+                        break;
+                    long vi = std::strtol( p, &end, 10 ), ti = 0, ni = 0;
+                    if( end == p )
+                        throw std::runtime_error( "OBJ " + path + ": malformed face: " + line );
+                    p = end;
+                    if( *p == '/' )
+                    {
+                        ++p;
+                        if( *p != '/' )
+                        {
+                            ti = std::strtol( p, &end, 10 );
+                            p = end;
+                        }
+                        if( *p == '/' )
+                        {
+                            ++p;
+                            ni = std::strtol( p, &end, 10 );
+                            p = end;
+                        }
+                    }
+
+                    ObjKey key{ resolveObjIndex( vi, positions.size() ), resolveObjIndex( ti, texcoords.size() ),
+                                resolveObjIndex( ni, normals.size() ) };
+                    // -1 у t/n — атрибут не задан; отрицательный индекс левее начала списка — ошибка
+                    if( key.v < 0 || key.v >= static_cast<int>( positions.size() ) || ( ti != 0 && key.t < 0 ) ||
+                        key.t >= static_cast<int>( texcoords.size() ) || ( ni != 0 && key.n < 0 ) ||
+                        key.n >= static_cast<int>( normals.size() ) )
+                        throw std::runtime_error( "OBJ " + path + ": index out of range: " + line );
+
+                    auto it = dedup.find( key );
+                    if( it == dedup.end() )
+                    {
+                        ObjVertex v;
+                        v.position = positions[key.v];
+                        v.normal = key.n >= 0 ? normals[key.n] : glm::vec3( 0.0f );
+                        v.texcoord = key.t >= 0 ? texcoords[key.t] : glm::vec2( 0.0f );
+                        it = dedup.emplace( key, static_cast<uint32_t>( vertices.size() ) ).first;
+                        vertices.push_back( v );
+                        vertexPosition.push_back( key.v );
+                        vertexHasNormal.push_back( key.n >= 0 );
+                    }
+                    face.push_back( it->second );
+                }
+                // Триангуляция веером
+                for( size_t i = 2; i < face.size(); ++i )
+                {
+                    indices.push_back( face[0] );
+                    indices.push_back( face[i - 1] );
+                    indices.push_back( face[i] );
+                }
+            }
+        }
+
+        // Сглаженные нормали для вершин без нормали из файла
+        bool needNormals = false;
+        for( bool has : vertexHasNormal )
+            needNormals |= !has;
+        if( needNormals )
+        {
+            std::vector<glm::vec3> accum( positions.size(), glm::vec3( 0.0f ) );
+            for( size_t i = 0; i + 2 < indices.size(); i += 3 )
+            {
+                int a = vertexPosition[indices[i]], b = vertexPosition[indices[i + 1]],
+                    c = vertexPosition[indices[i + 2]];
+                // Ненормированная нормаль взвешивает вклад грани по площади
+                glm::vec3 n = glm::cross( positions[b] - positions[a], positions[c] - positions[a] );
+                accum[a] += n;
+                accum[b] += n;
+                accum[c] += n;
+            }
+            for( size_t i = 0; i < vertices.size(); ++i )
+            {
+                if( vertexHasNormal[i] )
+                    continue;
+                glm::vec3 n = accum[vertexPosition[i]];
+                float len = glm::length( n );
+                vertices[i].normal = len > 0.0f ? n / len : glm::vec3( 0.0f, 0.0f, 1.0f );
+            }
+        }
+
+        return makeMeshData( vertices, std::move( indices ) );
+    }
+
+    MeshData createSphereMeshData( float radius, uint32_t slices, uint32_t stacks )
+    {
+        slices = std::max( slices, 3u );
+        stacks = std::max( stacks, 2u );
+        const float pi = 3.14159265358979f;
+        std::vector<ObjVertex> vertices;
+        vertices.reserve( static_cast<size_t>( slices + 1 ) * ( stacks + 1 ) );
+        for( uint32_t j = 0; j <= stacks; ++j )
+        {
+            const float theta = pi * static_cast<float>( j ) / static_cast<float>( stacks );
+            for( uint32_t i = 0; i <= slices; ++i )
+            {
+                const float phi = 2.0f * pi * static_cast<float>( i ) / static_cast<float>( slices );
+                ObjVertex v;
+                v.normal = glm::vec3( std::sin( theta ) * std::cos( phi ), std::cos( theta ),
+                                      -std::sin( theta ) * std::sin( phi ) );
+                v.position = v.normal * radius;
+                v.texcoord = glm::vec2( static_cast<float>( i ) / static_cast<float>( slices ),
+                                        static_cast<float>( j ) / static_cast<float>( stacks ) );
+                vertices.push_back( v );
+            }
+        }
+        std::vector<uint32_t> indices;
+        indices.reserve( static_cast<size_t>( slices ) * stacks * 6 );
+        for( uint32_t j = 0; j < stacks; ++j )
+        {
+            for( uint32_t i = 0; i < slices; ++i )
+            {
+                const uint32_t a = j * ( slices + 1 ) + i, b = a + 1, c = a + slices + 1, d = c + 1;
+                // Против часовой стрелки при взгляде снаружи; вырожденные треугольники у полюсов пропускаются
+                if( j != 0 )
+                    indices.insert( indices.end(), { a, c, b } );
+                if( j + 1 != stacks )
+                    indices.insert( indices.end(), { b, c, d } );
+            }
+        }
+        return makeMeshData( vertices, std::move( indices ) );
+    }
+
+    MeshData createBoxMeshData( const glm::vec3 &boundsMin, const glm::vec3 &boundsMax )
+    {
+        // По 4 вершины на грань, чтобы нормали были плоскими
+        const glm::vec3 normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 },
+                                       { 0, 0, -1 } };
+        std::vector<ObjVertex> vertices;
+        std::vector<uint32_t> indices;
+        for( const glm::vec3 &n : normals )
+        {
+            // Базис грани (u, v) с u x v = n — обход против часовой стрелки снаружи
+            const glm::vec3 u = std::abs( n.y ) > 0.5f ? glm::vec3( 1, 0, 0 ) : glm::vec3( 0, 1, 0 );
+            const glm::vec3 v = glm::cross( n, u );
+            const uint32_t base = static_cast<uint32_t>( vertices.size() );
+            const glm::vec2 corners[4] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+            for( const glm::vec2 &c : corners )
+            {
+                const glm::vec3 unit = n + u * c.x + v * c.y; // Угол куба [-1, 1]^3
+                ObjVertex vert;
+                vert.position = glm::mix( boundsMin, boundsMax, unit * 0.5f + 0.5f );
+                vert.normal = n;
+                vert.texcoord = c * 0.5f + 0.5f;
+                vertices.push_back( vert );
+            }
+            indices.insert( indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 } );
+        }
+        return makeMeshData( vertices, std::move( indices ) );
+    }
+
+    void saveMeshData( const std::string &path, const MeshData &mesh )
+    {
+        if( mesh.vertices.size() != mesh.vertexCount * mesh.layout.stride )
+            throw std::runtime_error( "Mesh " + path + ": vertex data size mismatch" );
+
+        const uint32_t indexSize = mesh.vertexCount <= 0x10000 ? 2 : 4;
+
+        MeshFileHeader hdr{};
+        hdr.magic = kMeshFileMagic;
+        hdr.version = kMeshFileVersion;
+        hdr.vertexStride = static_cast<uint32_t>( mesh.layout.stride );
+        hdr.elementCount = static_cast<uint32_t>( mesh.layout.elements.size() );
+        hdr.vertexCount = mesh.vertexCount;
+        hdr.indexCount = mesh.indices.size();
+        hdr.indexSize = indexSize;
+        const size_t elementsEnd = sizeof( MeshFileHeader ) + mesh.layout.elements.size() * sizeof( MeshFileElement );
+        hdr.vertexDataOffset = alignUp( elementsEnd, kMeshStreamAlignment );
+        hdr.indexDataOffset = alignUp( hdr.vertexDataOffset + mesh.vertices.size(), kMeshStreamAlignment );
+        for( int i = 0; i < 3; ++i )
+        {
+            hdr.boundsMin[i] = mesh.boundsMin[i];
+            hdr.boundsMax[i] = mesh.boundsMax[i];
+        }
+
+        std::ofstream out( path, std::ios::binary | std::ios::trunc );
+        if( !out )
+            throw std::runtime_error( "Mesh " + path + ": cannot open for writing" );
+
+        auto pad = [&]( size_t target ) {
+            static const char zeros[kMeshStreamAlignment] = {};
+            size_t pos = static_cast<size_t>( out.tellp() );
+            if( target > pos )
+                out.write( zeros, static_cast<std::streamsize>( target - pos ) );
+        };
+
+        out.write( reinterpret_cast<const char *>( &hdr ), sizeof( hdr ) );
+        for( const auto &e : mesh.layout.elements )
+        {
+            MeshFileElement fe{ static_cast<uint32_t>( e.semantic ), static_cast<uint32_t>( e.format ),
+                                static_cast<uint32_t>( e.offset ), 0 };
+            out.write( reinterpret_cast<const char *>( &fe ), sizeof( fe ) );
+        }
+        pad( hdr.vertexDataOffset );
+        out.write( reinterpret_cast<const char *>( mesh.vertices.data() ),
+                   static_cast<std::streamsize>( mesh.vertices.size() ) );
+        pad( hdr.indexDataOffset );
+        if( indexSize == 2 )
+        {
+            std::vector<uint16_t> idx16( mesh.indices.begin(), mesh.indices.end() );
+            out.write( reinterpret_cast<const char *>( idx16.data() ),
+                       static_cast<std::streamsize>( idx16.size() * sizeof( uint16_t ) ) );
+        }
+        else
+        {
+            out.write( reinterpret_cast<const char *>( mesh.indices.data() ),
+                       static_cast<std::streamsize>( mesh.indices.size() * sizeof( uint32_t ) ) );
+        }
+        if( !out )
+            throw std::runtime_error( "Mesh " + path + ": write failed" );
+    }
+
+    MeshData loadMeshData( const std::string &path )
+    {
+        auto file = MappedFile::open( path );
+        MeshData mesh;
+        MeshFileHeader hdr = parseHeader( file->data(), file->size(), path, mesh.layout );
+        checkIndices( file->data(), hdr, path );
+
+        mesh.vertexCount = static_cast<size_t>( hdr.vertexCount );
+        const uint8_t *vsrc = file->data() + hdr.vertexDataOffset;
+        mesh.vertices.assign( vsrc, vsrc + mesh.vertexCount * hdr.vertexStride );
+
+        mesh.indices.resize( static_cast<size_t>( hdr.indexCount ) );
+        const uint8_t *isrc = file->data() + hdr.indexDataOffset;
+        for( size_t i = 0; i < mesh.indices.size(); ++i )
+        {
+            if( hdr.indexSize == 2 )
+            {
+                uint16_t v;
+                std::memcpy( &v, isrc + i * 2, 2 );
+                mesh.indices[i] = v;
+            }
+            else
+            {
+                std::memcpy( &mesh.indices[i], isrc + i * 4, 4 );
+            }
+        }
+        mesh.boundsMin = glm::vec3( hdr.boundsMin[0], hdr.boundsMin[1], hdr.boundsMin[2] );
+        mesh.boundsMax = glm::vec3( hdr.boundsMax[0], hdr.boundsMax[1], hdr.boundsMax[2] );
+        return mesh;
+    }
+
+    Mesh loadMesh( Device &device, const std::string &path )
+    {
+        std::shared_ptr<const MappedFile> file = MappedFile::open( path );
+        Mesh mesh;
+        InputLayoutDesc layout;
+        MeshFileHeader hdr = parseHeader( file->data(), file->size(), path, layout );
+        checkIndices( file->data(), hdr, path );
+
+        mesh.vertexCount = static_cast<size_t>( hdr.vertexCount );
+        mesh.indexCount = static_cast<size_t>( hdr.indexCount );
+        mesh.boundsMin = glm::vec3( hdr.boundsMin[0], hdr.boundsMin[1], hdr.boundsMin[2] );
+        mesh.boundsMax = glm::vec3( hdr.boundsMax[0], hdr.boundsMax[1], hdr.boundsMax[2] );
+        mesh.inputLayout = device.createInputLayout( layout );
+
+        // Оба буфера держат отображение живым; страницы подтягиваются при первом обращении
+        mesh.vertexBuffer = device.createBufferFromMemory( hdr.vertexStride, mesh.vertexCount, BufferFormat::Unknown,
+                                                           file->data() + hdr.vertexDataOffset, file );
+        mesh.indexBuffer = device.createBufferFromMemory(
+            hdr.indexSize, mesh.indexCount, hdr.indexSize == 2 ? BufferFormat::R16_UINT : BufferFormat::R32_UINT,
+            file->data() + hdr.indexDataOffset, file );
+        return mesh;
+    }
+
+    Mesh createMesh( Device &device, const MeshData &data )
+    {
+        Mesh mesh;
+        mesh.vertexCount = data.vertexCount;
+        mesh.indexCount = data.indices.size();
+        mesh.boundsMin = data.boundsMin;
+        mesh.boundsMax = data.boundsMax;
+        mesh.inputLayout = device.createInputLayout( data.layout );
+
+        // Содержимое сразу перезаписывается, обнулять не нужно; начало потока по кэш-линии
+        BufferOptions opts;
+        opts.alignment = kMeshStreamAlignment;
+        opts.zeroInitialize = false;
+        mesh.vertexBuffer = device.createBuffer( data.layout.stride, data.vertexCount, BufferFormat::Unknown, opts );
+        if( data.vertexCount )
+            mesh.vertexBuffer->uploadData( data.vertices.data(), data.vertexCount );
+
+        if( data.vertexCount <= 0x10000 )
+        {
+            std::vector<uint16_t> idx16( data.indices.begin(), data.indices.end() );
+            mesh.indexBuffer = device.createBuffer( sizeof( uint16_t ), idx16.size(), BufferFormat::R16_UINT, opts );
+            if( !idx16.empty() )
+                mesh.indexBuffer->uploadData( idx16.data(), idx16.size() );
+        }
+        else
+        {
+            mesh.indexBuffer =
+                device.createBuffer( sizeof( uint32_t ), data.indices.size(), BufferFormat::R32_UINT, opts );
+            if( !data.indices.empty() )
+                mesh.indexBuffer->uploadData( data.indices.data(), data.indices.size() );
+        }
+        return mesh;
+    }
+
+} // namespace swr
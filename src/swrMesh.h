@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "swrDevice.h"
+
+namespace swr
+{
+    // Бинарный формат меша (.swrm), little-endian:
+    //
+    //   MeshFileHeader
+    //   MeshFileElement[header.elementCount]   — описание input layout
+    //   (выравнивание до kMeshStreamAlignment)
+    //   вершинный поток: vertexCount * vertexStride байт
+    //   (выравнивание до kMeshStreamAlignment)
+    //   индексный поток: indexCount * indexSize байт
+    //
+    // Потоки выровнены, поэтому после mmap их можно отдавать в Buffer как есть, без копирования.
+    constexpr uint32_t kMeshFileMagic = 0x4D525753; // "SWRM"
+    constexpr uint32_t kMeshFileVersion = 1;
+    constexpr size_t kMeshStreamAlignment = 64;
+
+    struct MeshFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexStride;     // Размер одной вершины в байтах
+        uint32_t elementCount;     // Число MeshFileElement после заголовка
+        uint64_t vertexCount;
+        uint64_t indexCount;
+        uint32_t indexSize;        // 2 (R16_UINT) или 4 (R32_UINT)
+        uint32_t reserved;
+        uint64_t vertexDataOffset; // Смещение вершинного потока от начала файла
+        uint64_t indexDataOffset;  // Смещение индексного потока от начала файла
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    // Элемент input layout в файле; semantic/format — числовые значения Semantic/InputFormat
+    struct MeshFileElement
+    {
+        uint32_t semantic;
+        uint32_t format;
+        uint32_t offset;
+        uint32_t reserved;
+    };
+
+    // Меш в памяти процесса: результат импорта/конвертации, вход для сохранения
+    struct MeshData
+    {
+        InputLayoutDesc layout;
+        std::vector<uint8_t> vertices; // vertexCount * layout.stride байт
+        std::vector<uint32_t> indices; // Список треугольников
+        size_t vertexCount = 0;
+        glm::vec3 boundsMin{ 0.0f };
+        glm::vec3 boundsMax{ 0.0f };
+    };
+
+    // Меш, готовый к отрисовке: буферы устройства + layout
+    struct Mesh
+    {
+        std::shared_ptr<Buffer> vertexBuffer;
+        std::shared_ptr<Buffer> indexBuffer;
+        std::shared_ptr<InputLayout> inputLayout;
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        glm::vec3 boundsMin{ 0.0f };
+        glm::vec3 boundsMax{ 0.0f };
+    };
+
+    // Импорт Wavefront OBJ (v/vt/vn/f, полигоны триангулируются веером).
+    // Layout результата: POSITION0 (vec3), NORMAL0 (vec3), TEXCOORD0 (vec2).
+    // Если нормалей в файле нет, они вычисляются усреднением нормалей граней.
+    MeshData importObj( const std::string &path );
+
+    // Процедурные меши в том же layout, что и у importObj (обход против часовой стрелки снаружи)
+    MeshData createSphereMeshData( float radius, uint32_t slices, uint32_t stacks );
+    MeshData createBoxMeshData( const glm::vec3 &boundsMin, const glm::vec3 &boundsMax );
+
+    // Запись/чтение .swrm; ошибки сообщаются через std::runtime_error
+    void saveMeshData( const std::string &path, const MeshData &mesh );
+    MeshData loadMeshData( const std::string &path );
+
+    // Загрузка .swrm через mmap: буферы ссылаются прямо на отображённый файл (zero-copy, только чтение)
+    Mesh loadMesh( Device &device, const std::string &path );
+
+    // Создание буферов устройства из меша в памяти (с копированием)
+    Mesh createMesh( Device &device, const MeshData &mesh );
+
+    // Пересчёт ограничивающего объёма по атрибуту POSITION0
+    void computeBounds( MeshData &mesh );
+} // namespace swr
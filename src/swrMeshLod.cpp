@@ -0,0 +1,399 @@
+#include "swrMeshLod.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include "swrMeshOptimizer.h"
+
+namespace swr
+{
+    namespace
+    {
+        // Квадрика ошибки: сумма квадратов расстояний до плоскостей смежных треугольников (симметричная 4x4,
+        // 10 коэффициентов) с весом по площади. Ошибка делится на суммарный вес — средний квадрат расстояния
+        struct Quadric
+        {
+            double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0, w = 0;
+
+            void addPlane( const glm::vec3 &normal, double d, double weight )
+            {
+                const double nx = normal.x, ny = normal.y, nz = normal.z;
+                a2 += nx * nx * weight;
+                ab += nx * ny * weight;
+                ac += nx * nz * weight;
+                ad += nx * d * weight;
+                b2 += ny * ny * weight;
+                bc += ny * nz * weight;
+                bd += ny * d * weight;
+                c2 += nz * nz * weight;
+                cd += nz * d * weight;
+                d2 += d * d * weight;
+                w += weight;
+            }
+
+            Quadric &operator+=( const Quadric &q )
+            {
+                a2 += q.a2;
+                ab += q.ab;
+                ac += q.ac;
+                ad += q.ad;
+                b2 += q.b2;
+                bc += q.bc;
+                bd += q.bd;
+                c2 += q.c2;
+                cd += q.cd;
+                d2 += q.d2;
+                w += q.w;
+                return *this;
+            }
+
+            double error( const glm::vec3 &p ) const
+            {
+                const double x = p.x, y = p.y, z = p.z;
+                const double e = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * ( ab * x * y + ac * x * z + bc * y * z ) +
+                                 2.0 * ( ad * x + bd * y + cd * z ) + d2;
+                return w > 0.0 ? std::max( e, 0.0 ) / w : 0.0;
+            }
+        };
+
+        // Ключ точной позиции; -0.0 и 0.0 считаются одной позицией
+        struct PositionKey
+        {
+            uint32_t x, y, z;
+
+            explicit PositionKey( const glm::vec3 &p )
+            {
+                const glm::vec3 q = p + glm::vec3( 0.0f );
+                std::memcpy( &x, &q.x, 4 );
+                std::memcpy( &y, &q.y, 4 );
+                std::memcpy( &z, &q.z, 4 );
+            }
+            bool operator==( const PositionKey &o ) const
+            {
+                return x == o.x && y == o.y && z == o.z;
+            }
+        };
+
+        struct PositionKeyHash
+        {
+            size_t operator()( const PositionKey &k ) const
+            {
+                return ( k.x * 73856093u ) ^ ( k.y * 19349663u ) ^ ( k.z * 83492791u );
+            }
+        };
+
+        // Список смежности вершина -> треугольники в виде CSR (как в swrMeshOptimizer)
+        struct Adjacency
+        {
+            std::vector<uint32_t> offsets; // vertexCount + 1
+            std::vector<uint32_t> triangles;
+
+            Adjacency( const std::vector<uint32_t> &indices, size_t vertexCount ) : offsets( vertexCount + 1, 0 )
+            {
+                for( uint32_t v : indices )
+                    ++offsets[v + 1];
+                for( size_t v = 0; v < vertexCount; ++v )
+                    offsets[v + 1] += offsets[v];
+                triangles.resize( indices.size() );
+                std::vector<uint32_t> fill( offsets.begin(), offsets.end() - 1 );
+                for( size_t i = 0; i < indices.size(); ++i )
+                    triangles[fill[indices[i]]++] = static_cast<uint32_t>( i / 3 );
+            }
+        };
+
+        // Стягивание вершины from в соседнюю to
+        struct Collapse
+        {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+
+        // Наибольший размер ограничивающего объёма: ошибки упрощения задаются в долях от него
+        float meshExtent( const std::vector<glm::vec3> &positions )
+        {
+            glm::vec3 lo( FLT_MAX ), hi( -FLT_MAX );
+            for( const glm::vec3 &p : positions )
+            {
+                lo = glm::min( lo, p );
+                hi = glm::max( hi, p );
+            }
+            return positions.empty() ? 0.0f : std::max( { hi.x - lo.x, hi.y - lo.y, hi.z - lo.z } );
+        }
+
+        glm::vec3 triangleNormal( const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2 )
+        {
+            return glm::cross( p1 - p0, p2 - p0 );
+        }
+
+        // Вершины, которые нельзя двигать: на швах атрибутов (позицию делят несколько вершин) и на границах
+        // (ребро, по позициям, принадлежит не ровно двум треугольникам)
+        std::vector<uint8_t> findLockedVertices( const std::vector<uint32_t> &indices,
+                                                 const std::vector<glm::vec3> &positions )
+        {
+            const size_t vertexCount = positions.size();
+            std::vector<uint32_t> canonical( vertexCount );
+            std::vector<uint32_t> groupSize( vertexCount, 0 );
+            std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstAt;
+            firstAt.reserve( vertexCount );
+            for( uint32_t v = 0; v < vertexCount; ++v )
+            {
+                canonical[v] = firstAt.emplace( PositionKey( positions[v] ), v ).first->second;
+                ++groupSize[canonical[v]];
+            }
+
+            std::vector<uint8_t> locked( vertexCount, 0 );
+            for( uint32_t v = 0; v < vertexCount; ++v )
+                locked[v] = groupSize[canonical[v]] > 1;
+
+            auto edgeKey = [&]( uint32_t a, uint32_t b ) {
+                const uint64_t ca = canonical[a], cb = canonical[b];
+                return ca < cb ? ( ca << 32 ) | cb : ( cb << 32 ) | ca;
+            };
+            std::unordered_map<uint64_t, uint32_t> edgeUse;
+            edgeUse.reserve( indices.size() );
+            for( size_t i = 0; i < indices.size(); i += 3 )
+            {
+                for( int k = 0; k < 3; ++k )
+                    ++edgeUse[edgeKey( indices[i + k], indices[i + ( k + 1 ) % 3] )];
+            }
+            for( size_t i = 0; i < indices.size(); i += 3 )
+            {
+                for( int k = 0; k < 3; ++k )
+                {
+                    const uint32_t a = indices[i + k], b = indices[i + ( k + 1 ) % 3];
+                    if( edgeUse[edgeKey( a, b )] != 2 )
+                        locked[a] = locked[b] = 1;
+                }
+            }
+            return locked;
+        }
+    } // unnamed namespace
+
+    std::vector<uint32_t> simplifyIndices( const std::vector<uint32_t> &indices,
+                                           const std::vector<glm::vec3> &positions, size_t targetIndexCount,
+                                           float targetError, float *resultError )
+    {
+        std::vector<uint32_t> result( indices.begin(), indices.begin() + ( indices.size() / 3 ) * 3 );
+        if( resultError )
+            *resultError = 0.0f;
+        const size_t vertexCount = positions.size();
+        const float extent = meshExtent( positions );
+        if( result.size() <= targetIndexCount || extent <= 0.0f )
+            return result;
+        const double errorLimit = static_cast<double>( targetError ) * targetError * extent * extent;
+
+        const std::vector<uint8_t> locked = findLockedVertices( result, positions );
+        std::vector<Quadric> quadrics( vertexCount );
+        for( size_t i = 0; i < result.size(); i += 3 )
+        {
+            const glm::vec3 &p0 = positions[result[i]];
+            glm::vec3 n = triangleNormal( p0, positions[result[i + 1]], positions[result[i + 2]] );
+            const float len = glm::length( n );
+            if( len == 0.0f )
+                continue;
+            n /= len;
+            for( int k = 0; k < 3; ++k )
+                quadrics[result[i + k]].addPlane( n, -glm::dot( n, p0 ), len * 0.5 );
+        }
+
+        // Проходы: кандидаты всех рёбер сортируются по ошибке, за проход стягиваются непересекающиеся
+        // (окрестность стянутой вершины до конца прохода не трогается, так что проверки по исходному
+        // состоянию остаются верными). Затем индексы переписываются и вырожденные треугольники удаляются
+        std::vector<uint32_t> remap( vertexCount );
+        std::vector<uint8_t> touched( vertexCount );
+        std::vector<Collapse> collapses;
+        size_t triangleCount = result.size() / 3;
+        const size_t targetTriangles = targetIndexCount / 3;
+        double maxError = 0.0;
+        while( triangleCount > targetTriangles )
+        {
+            const Adjacency adjacency( result, vertexCount );
+            collapses.clear();
+            for( size_t i = 0; i < result.size(); i += 3 )
+            {
+                for( int k = 0; k < 3; ++k )
+                {
+                    const uint32_t a = result[i + k], b = result[i + ( k + 1 ) % 3];
+                    Quadric q = quadrics[a];
+                    q += quadrics[b];
+                    if( !locked[a] )
+                    {
+                        const double cost = q.error( positions[b] );
+                        if( cost <= errorLimit )
+                            collapses.push_back( { a, b, cost } );
+                    }
+                    if( !locked[b] )
+                    {
+                        const double cost = q.error( positions[a] );
+                        if( cost <= errorLimit )
+                            collapses.push_back( { b, a, cost } );
+                    }
+                }
+            }
+            if( collapses.empty() )
+                break;
+            std::sort( collapses.begin(), collapses.end(), []( const Collapse &l, const Collapse &r ) {
+                if( l.cost != r.cost )
+                    return l.cost < r.cost;
+                return l.from != r.from ? l.from < r.from : l.to < r.to;
+            } );
+
+            std::iota( remap.begin(), remap.end(), 0u );
+            std::fill( touched.begin(), touched.end(), 0 );
+            size_t applied = 0;
+            for( const Collapse &c : collapses )
+            {
+                if( triangleCount <= targetTriangles )
+                    break;
+                if( touched[c.from] || touched[c.to] )
+                    continue;
+                // Треугольники с ребром from-to вырождаются; остальные не должны перевернуться или сплющиться
+                bool valid = true;
+                size_t removed = 0;
+                for( uint32_t a = adjacency.offsets[c.from]; valid && a < adjacency.offsets[c.from + 1]; ++a )
+                {
+                    const uint32_t *t = &result[adjacency.triangles[a] * 3];
+                    if( t[0] == c.to || t[1] == c.to || t[2] == c.to )
+                    {
+                        ++removed;
+                        continue;
+                    }
+                    glm::vec3 p[3], q[3];
+                    for( int k = 0; k < 3; ++k )
+                    {
+                        p[k] = positions[t[k]];
+                        q[k] = positions[t[k] == c.from ? c.to : t[k]];
+                    }
+                    const glm::vec3 n0 = triangleNormal( p[0], p[1], p[2] );
+                    const glm::vec3 n1 = triangleNormal( q[0], q[1], q[2] );
+                    valid = glm::dot( n0, n1 ) > 0.25f * glm::length( n0 ) * glm::length( n1 );
+                }
+                if( !valid )
+                    continue;
+
+                remap[c.from] = c.to;
+                quadrics[c.to] += quadrics[c.from];
+                maxError = std::max( maxError, c.cost );
+                touched[c.to] = 1;
+                for( uint32_t a = adjacency.offsets[c.from]; a < adjacency.offsets[c.from + 1]; ++a )
+                {
+                    const uint32_t *t = &result[adjacency.triangles[a] * 3];
+                    touched[t[0]] = touched[t[1]] = touched[t[2]] = 1;
+                }
+                triangleCount -= std::min( removed, triangleCount );
+                ++applied;
+            }
+            if( applied == 0 )
+                break;
+
+            size_t write = 0;
+            for( size_t i = 0; i < result.size(); i += 3 )
+            {
+                const uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+                if( a == b || b == c || a == c )
+                    continue;
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+            result.resize( write );
+            triangleCount = write / 3;
+        }
+
+        if( resultError )
+            *resultError = static_cast<float>( std::sqrt( maxError ) ) / extent;
+        return result;
+    }
+
+    std::vector<MeshLodLevel> buildLodChain( MeshData &mesh, const LodChainOptions &options )
+    {
+        const std::vector<glm::vec3> positions = extractPositions( mesh );
+        const float extent = meshExtent( positions );
+
+        std::vector<std::vector<uint32_t>> levels{ mesh.indices };
+        std::vector<float> errors{ 0.0f };
+        while( levels.size() < options.maxLevels )
+        {
+            const std::vector<uint32_t> &prev = levels.back();
+            const size_t prevTriangles = prev.size() / 3;
+            if( prevTriangles <= options.minTriangles )
+                break;
+            const size_t target =
+                std::max( static_cast<size_t>( static_cast<float>( prevTriangles ) * options.reduction ),
+                          options.minTriangles );
+            float error = 0.0f;
+            std::vector<uint32_t> next = simplifyIndices( prev, positions, target * 3, options.maxError, &error );
+            // Меньше 10% выигрыша — дальше упрощать нечего (всё заблокировано или предел ошибки)
+            if( next.size() * 10 > prev.size() * 9 )
+                break;
+            // Уровень упрощается из предыдущего, поэтому ошибки накапливаются
+            errors.push_back( errors.back() + error * extent );
+            levels.push_back( optimizeVertexCache( next, mesh.vertexCount ) );
+        }
+
+        std::vector<MeshLodLevel> ranges;
+        std::vector<uint32_t> combined;
+        for( size_t i = 0; i < levels.size(); ++i )
+        {
+            ranges.push_back( { combined.size(), levels[i].size(), errors[i] } );
+            combined.insert( combined.end(), levels[i].begin(), levels[i].end() );
+        }
+        mesh.indices = std::move( combined );
+        return ranges;
+    }
+
+    LodMesh createLodMesh( Device &device, MeshData data, const LodChainOptions &options )
+    {
+        LodMesh result;
+        computeBounds( data );
+        result.levels = buildLodChain( data, options );
+        result.mesh = createMesh( device, data );
+        result.center = ( data.boundsMin + data.boundsMax ) * 0.5f;
+        result.radius = glm::length( data.boundsMax - data.boundsMin ) * 0.5f;
+        return result;
+    }
+
+    LodView makeLodView( const glm::vec3 &eye, const glm::mat4 &proj, float viewportHeight, float pixelError )
+    {
+        return { eye, proj[1][1] * viewportHeight * 0.5f, pixelError };
+    }
+
+    size_t selectLod( const LodMesh &mesh, const glm::mat4 &world, const LodView &view )
+    {
+        // Масштаб — наибольший по осям: ошибка и радиус не должны оказаться заниженными
+        const float scale = std::max( { glm::length( glm::vec3( world[0] ) ), glm::length( glm::vec3( world[1] ) ),
+                                        glm::length( glm::vec3( world[2] ) ) } );
+        const glm::vec3 center( world * glm::vec4( mesh.center, 1.0f ) );
+        // Расстояние до ближайшей точки сферы; камера внутри — уровень 0
+        const float distance = glm::length( center - view.eye ) - mesh.radius * scale;
+        if( distance <= 0.0f )
+            return 0;
+        const float pixelsPerUnit = view.pixelScale * scale / distance;
+        for( size_t i = mesh.levels.size(); i-- > 1; )
+        {
+            if( mesh.levels[i].error * pixelsPerUnit <= view.pixelError )
+                return i;
+        }
+        return 0;
+    }
+
+    size_t drawLodMesh( Device &device, const LodMesh &mesh, const glm::mat4 &world, const LodView &view )
+    {
+        device.IA().setVertexBuffer( mesh.mesh.vertexBuffer );
+        device.IA().setIndexBuffer( mesh.mesh.indexBuffer );
+        device.IA().setInputLayout( mesh.mesh.inputLayout );
+        if( mesh.levels.empty() )
+        {
+            device.drawIndexed( mesh.mesh.indexCount, 0, 0 );
+            return 0;
+        }
+        const size_t level = selectLod( mesh, world, view );
+        device.drawIndexed( mesh.levels[level].indexCount, mesh.levels[level].startIndex, 0 );
+        return level;
+    }
+} // namespace swr
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "swrMesh.h"
+
+namespace swr
+{
+    // Упрощение мешей и уровни детализации (LOD):
+    //   1. simplifyIndices — стягивание рёбер по квадрикам ошибки (Garland-Heckbert), вершина стягивается
+    //      в соседнюю, поэтому новые вершины не появляются и все LOD делят один вершинный буфер;
+    //   2. buildLodChain   — цепочка LOD в одном индексном буфере (диапазоны по уровням);
+    //   3. selectLod       — выбор уровня по проекции геометрической ошибки на экран.
+
+    // Упрощение списка треугольников до targetIndexCount индексов, пока ошибка не превышает targetError
+    // (доля от наибольшего размера ограничивающего объёма). Вершины на границах меша и на швах атрибутов
+    // (несколько вершин в одной позиции) не двигаются, чтобы не появлялись дыры и разрывы текстуры.
+    // resultError — достигнутая ошибка в тех же единицах
+    std::vector<uint32_t> simplifyIndices( const std::vector<uint32_t> &indices,
+                                           const std::vector<glm::vec3> &positions, size_t targetIndexCount,
+                                           float targetError, float *resultError = nullptr );
+
+    // Уровень детализации: диапазон индексного буфера и геометрическая ошибка в единицах объекта
+    struct MeshLodLevel
+    {
+        size_t startIndex = 0;
+        size_t indexCount = 0;
+        float error = 0.0f;
+    };
+
+    struct LodChainOptions
+    {
+        size_t maxLevels = 6;     // Вместе с исходным уровнем
+        float reduction = 0.5f;   // Доля треугольников предыдущего уровня, к которой стремится следующий
+        float maxError = 0.1f;    // Предел ошибки уровня (доля размера меша)
+        size_t minTriangles = 16; // Меньше не упрощаем
+    };
+
+    // Строит цепочку LOD: mesh.indices заменяются на уровни подряд (уровень 0 — исходные треугольники).
+    // Каждый уровень упрощается из предыдущего и переупорядочивается под кэш вершин
+    std::vector<MeshLodLevel> buildLodChain( MeshData &mesh, const LodChainOptions &options = {} );
+
+    // Меш с цепочкой LOD и ограничивающей сферой для выбора уровня
+    struct LodMesh
+    {
+        Mesh mesh;
+        std::vector<MeshLodLevel> levels;
+        glm::vec3 center{ 0.0f };
+        float radius = 0.0f;
+    };
+
+    LodMesh createLodMesh( Device &device, MeshData data, const LodChainOptions &options = {} );
+
+    // Параметры вида для выбора LOD. pixelScale — пикселей на единицу размера на расстоянии 1
+    // (proj[1][1] * высота кадра / 2), pixelError — допустимая ошибка на экране в пикселях (0 — всегда уровень 0)
+    struct LodView
+    {
+        glm::vec3 eye{ 0.0f };
+        float pixelScale = 1.0f;
+        float pixelError = 1.0f;
+    };
+
+    LodView makeLodView( const glm::vec3 &eye, const glm::mat4 &proj, float viewportHeight, float pixelError = 1.0f );
+
+    // Самый грубый уровень, ошибка которого в проекции не больше view.pixelError
+    size_t selectLod( const LodMesh &mesh, const glm::mat4 &world, const LodView &view );
+
+    // Привязка буферов меша к IA и drawIndexed выбранного уровня; константы объекта задаёт вызывающий.
+    // Возвращает номер нарисованного уровня
+    size_t drawLodMesh( Device &device, const LodMesh &mesh, const glm::mat4 &world, const LodView &view );
+} // namespace swr
@@ -0,0 +1,416 @@
+#include "swrMeshOptimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace swr
+{
+    namespace
+    {
+        // FIFO-кэш с той же политикой вытеснения, что и в Device::drawIndexed
+        class FifoCache
+        {
+          public:
+            explicit FifoCache( size_t size ) : tags( size, UINT32_MAX )
+            {
+            }
+
+            // true при промахе (вершина добавлена в кэш)
+            bool access( uint32_t v )
+            {
+                for( uint32_t t : tags )
+                    if( t == v )
+                        return false;
+                tags[head] = v;
+                head = ( head + 1 ) % tags.size();
+                return true;
+            }
+
+            void reset()
+            {
+                std::fill( tags.begin(), tags.end(), UINT32_MAX );
+                head = 0;
+            }
+
+          private:
+            std::vector<uint32_t> tags;
+            size_t head = 0;
+        };
+
+        // Список смежности вершина -> треугольники в виде CSR
+        struct Adjacency
+        {
+            std::vector<uint32_t> offsets; // vertexCount + 1
+            std::vector<uint32_t> triangles;
+
+            Adjacency( const std::vector<uint32_t> &indices, size_t vertexCount ) : offsets( vertexCount + 1, 0 )
+            {
+                for( uint32_t v : indices )
+                    ++offsets[v + 1];
+                for( size_t v = 0; v < vertexCount; ++v )
+                    offsets[v + 1] += offsets[v];
+                triangles.resize( indices.size() );
+                std::vector<uint32_t> fill( offsets.begin(), offsets.end() - 1 );
+                for( size_t i = 0; i < indices.size(); ++i )
+                    triangles[fill[indices[i]]++] = static_cast<uint32_t>( i / 3 );
+            }
+        };
+
+        void validateIndices( const std::vector<uint32_t> &indices, size_t vertexCount )
+        {
+            if( indices.size() % 3 != 0 )
+                throw std::invalid_argument( "Mesh optimizer: index count is not a multiple of 3" );
+            for( uint32_t v : indices )
+                if( v >= vertexCount )
+                    throw std::out_of_range( "Mesh optimizer: index out of range" );
+        }
+    } // unnamed namespace
+
+    VertexCacheStats analyzeVertexCache( const std::vector<uint32_t> &indices, size_t vertexCount, size_t cacheSize )
+    {
+        VertexCacheStats s;
+        FifoCache cache( cacheSize );
+        std::vector<bool> used( vertexCount, false );
+        size_t unique = 0;
+        for( uint32_t v : indices )
+        {
+            if( cache.access( v ) )
+                ++s.vertexShaderInvocations;
+            if( v < vertexCount && !used[v] )
+            {
+                used[v] = true;
+                ++unique;
+            }
+        }
+        size_t triCount = indices.size() / 3;
+        s.acmr = triCount ? static_cast<float>( s.vertexShaderInvocations ) / triCount : 0.0f;
+        s.atvr = unique ? static_cast<float>( s.vertexShaderInvocations ) / unique : 0.0f;
+        return s;
+    }
+
+    OverdrawStats analyzeOverdraw( const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions )
+    {
+        constexpr int kGrid = 256;
+        OverdrawStats s;
+        if( indices.empty() )
+            return s;
+
+        glm::vec3 lo( std::numeric_limits<float>::max() ), hi( -std::numeric_limits<float>::max() );
+        for( uint32_t v : indices )
+        {
+            lo = glm::min( lo, positions[v] );
+            hi = glm::max( hi, positions[v] );
+        }
+        const float extent = std::max( std::max( hi.x - lo.x, hi.y - lo.y ), std::max( hi.z - lo.z, 1e-6f ) );
+        const float scale = ( kGrid - 1 ) / extent;
+
+        std::vector<float> depth( kGrid * kGrid );
+        std::vector<uint8_t> covered( kGrid * kGrid );
+
+        // Ортографические виды вдоль ±X, ±Y, ±Z
+        for( int axis = 0; axis < 3; ++axis )
+        {
+            for( int side = 0; side < 2; ++side )
+            {
+                std::fill( depth.begin(), depth.end(), std::numeric_limits<float>::max() );
+                std::fill( covered.begin(), covered.end(), 0 );
+                const int ax = ( axis + 1 ) % 3, ay = ( axis + 2 ) % 3;
+                const float dir = side ? -1.0f : 1.0f; // Наблюдатель смотрит вдоль dir * axis
+
+                auto project = [&]( const glm::vec3 &p ) {
+                    return glm::vec3( ( p[ax] - lo[ax] ) * scale, ( p[ay] - lo[ay] ) * scale,
+                                      ( p[axis] - lo[axis] ) * dir );
+                };
+
+                for( size_t i = 0; i + 2 < indices.size(); i += 3 )
+                {
+                    glm::vec3 a = project( positions[indices[i]] );
+                    glm::vec3 b = project( positions[indices[i + 1]] );
+                    glm::vec3 c = project( positions[indices[i + 2]] );
+                    // Нормаль грани смотрит на наблюдателя <=> ориентированная площадь в проекции нужного знака.
+                    // Для side=1 ось глубины отражена, вместе с ней меняется и ожидаемый знак
+                    float area = ( b.x - a.x ) * ( c.y - a.y ) - ( b.y - a.y ) * ( c.x - a.x );
+                    if( ( area * dir ) >= 0.0f )
+                        continue;
+
+                    int minX = std::max( 0, static_cast<int>( std::floor( std::min( { a.x, b.x, c.x } ) ) ) );
+                    int maxX = std::min( kGrid - 1, static_cast<int>( std::ceil( std::max( { a.x, b.x, c.x } ) ) ) );
+                    int minY = std::max( 0, static_cast<int>( std::floor( std::min( { a.y, b.y, c.y } ) ) ) );
+                    int maxY = std::min( kGrid - 1, static_cast<int>( std::ceil( std::max( { a.y, b.y, c.y } ) ) ) );
+                    const float invArea = 1.0f / area;
+                    for( int y = minY; y <= maxY; ++y )
+                    {
+                        for( int x = minX; x <= maxX; ++x )
+                        {
+                            float px = x + 0.5f, py = y + 0.5f;
+                            float w0 = ( ( c.x - b.x ) * ( py - b.y ) - ( c.y - b.y ) * ( px - b.x ) ) * invArea;
+                            float w1 = ( ( a.x - c.x ) * ( py - c.y ) - ( a.y - c.y ) * ( px - c.x ) ) * invArea;
+                            float w2 = 1.0f - w0 - w1;
+                            if( w0 < 0.0f || w1 < 0.0f || w2 < 0.0f )
+                                continue;
+                            float z = w0 * a.z + w1 * b.z + w2 * c.z;
+                            size_t idx = static_cast<size_t>( y ) * kGrid + x;
+                            if( z < depth[idx] )
+                            {
+                                depth[idx] = z;
+                                ++s.pixelsShaded;
+                                if( !covered[idx] )
+                                {
+                                    covered[idx] = 1;
+                                    ++s.pixelsCovered;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        s.overdraw = s.pixelsCovered ? static_cast<float>( s.pixelsShaded ) / s.pixelsCovered : 0.0f;
+        return s;
+    }
+
+    // Tipsify (Sander, Nehab, Barczak 2007): обход "веером" вокруг вершин с выбором следующей вершины,
+    // которая с наибольшей вероятностью ещё в FIFO-кэше. Линейное время, без скоринга всех треугольников
+    std::vector<uint32_t> optimizeVertexCache( const std::vector<uint32_t> &indices, size_t vertexCount,
+                                               size_t cacheSize )
+    {
+        validateIndices( indices, vertexCount );
+        const size_t triCount = indices.size() / 3;
+        std::vector<uint32_t> out;
+        out.reserve( indices.size() );
+        if( triCount == 0 )
+            return out;
+
+        Adjacency adj( indices, vertexCount );
+        std::vector<uint32_t> live( vertexCount );
+        for( size_t v = 0; v < vertexCount; ++v )
+            live[v] = adj.offsets[v + 1] - adj.offsets[v];
+
+        std::vector<uint32_t> timestamp( vertexCount, 0 );
+        std::vector<bool> emitted( triCount, false );
+        std::vector<uint32_t> deadEnd; // Стек недавно использованных вершин
+        std::vector<uint32_t> candidates;
+        const uint32_t k = static_cast<uint32_t>( cacheSize );
+        uint32_t time = k + 1;
+        size_t cursor = 0;
+
+        auto skipDeadEnd = [&]() -> int64_t {
+            while( !deadEnd.empty() )
+            {
+                uint32_t d = deadEnd.back();
+                deadEnd.pop_back();
+                if( live[d] > 0 )
+                    return d;
+            }
+            while( cursor < vertexCount )
+            {
+                if( live[cursor] > 0 )
+                    return static_cast<int64_t>( cursor );
+                ++cursor;
+            }
+            return -1;
+        };
+
+        int64_t fan = indices[0];
+        while( fan >= 0 )
+        {
+            candidates.clear();
+            for( uint32_t a = adj.offsets[fan]; a < adj.offsets[fan + 1]; ++a )
+            {
+                uint32_t t = adj.triangles[a];
+                if( emitted[t] )
+                    continue;
+                for( int c = 0; c < 3; ++c )
+                {
+                    uint32_t v = indices[t * 3 + c];
+                    out.push_back( v );
+                    deadEnd.push_back( v );
+                    candidates.push_back( v );
+                    --live[v];
+                    if( time - timestamp[v] > k )
+                        timestamp[v] = time++;
+                }
+                emitted[t] = true;
+            }
+
+            // Следующая вершина: с живыми треугольниками, которая ещё будет в кэше после их обхода
+            int64_t next = -1;
+            int64_t bestPriority = -1;
+            for( uint32_t v : candidates )
+            {
+                if( live[v] == 0 )
+                    continue;
+                int64_t priority = 0;
+                if( time - timestamp[v] + 2 * live[v] <= k )
+                    priority = time - timestamp[v];
+                if( priority > bestPriority )
+                {
+                    bestPriority = priority;
+                    next = v;
+                }
+            }
+            fan = next >= 0 ? next : skipDeadEnd();
+        }
+        return out;
+    }
+
+    std::vector<uint32_t> optimizeOverdraw( const std::vector<uint32_t> &indices,
+                                            const std::vector<glm::vec3> &positions, float threshold,
+                                            size_t cacheSize )
+    {
+        validateIndices( indices, positions.size() );
+        const size_t triCount = indices.size() / 3;
+        if( triCount == 0 )
+            return indices;
+
+        // Жёсткие границы: треугольник, не разделяющий ни одной вершины с кэшем, — кэш и так "холодный"
+        std::vector<size_t> hard;
+        {
+            FifoCache cache( cacheSize );
+            for( size_t t = 0; t < triCount; ++t )
+            {
+                int misses = 0;
+                for( int c = 0; c < 3; ++c )
+                    misses += cache.access( indices[t * 3 + c] ) ? 1 : 0;
+                if( t == 0 || misses == 3 )
+                    hard.push_back( t );
+            }
+            hard.push_back( triCount );
+        }
+
+        // Мягкие границы: внутри жёсткого кластера режем там, где ACMR префикса (с холодного кэша)
+        // не хуже threshold * ACMR всего кластера — перестановка таких кусков почти не портит кэш
+        std::vector<size_t> bounds;
+        FifoCache cache( cacheSize );
+        for( size_t h = 0; h + 1 < hard.size(); ++h )
+        {
+            const size_t begin = hard[h], end = hard[h + 1];
+            cache.reset();
+            size_t clusterMisses = 0;
+            for( size_t i = begin * 3; i < end * 3; ++i )
+                clusterMisses += cache.access( indices[i] ) ? 1 : 0;
+            const float clusterAcmr = static_cast<float>( clusterMisses ) / ( end - begin );
+
+            cache.reset();
+            size_t start = begin, misses = 0;
+            bounds.push_back( begin );
+            for( size_t t = begin; t < end; ++t )
+            {
+                for( int c = 0; c < 3; ++c )
+                    misses += cache.access( indices[t * 3 + c] ) ? 1 : 0;
+                const float acmr = static_cast<float>( misses ) / ( t - start + 1 );
+                if( t + 1 < end && acmr <= clusterAcmr * threshold )
+                {
+                    start = t + 1;
+                    misses = 0;
+                    cache.reset();
+                    bounds.push_back( start );
+                }
+            }
+        }
+        bounds.push_back( triCount );
+
+        // Сортировка кластеров: сначала обращённые "наружу" (видимые с большинства направлений)
+        glm::vec3 meshCentroid( 0.0f );
+        float meshArea = 0.0f;
+        struct Cluster
+        {
+            size_t begin, end;
+            float sortKey;
+        };
+        std::vector<Cluster> clusters;
+        std::vector<glm::vec3> centroids, normals;
+        for( size_t b = 0; b + 1 < bounds.size(); ++b )
+        {
+            glm::vec3 centroid( 0.0f ), normal( 0.0f );
+            float area = 0.0f;
+            for( size_t t = bounds[b]; t < bounds[b + 1]; ++t )
+            {
+                const glm::vec3 &p0 = positions[indices[t * 3]];
+                const glm::vec3 &p1 = positions[indices[t * 3 + 1]];
+                const glm::vec3 &p2 = positions[indices[t * 3 + 2]];
+                glm::vec3 n = glm::cross( p1 - p0, p2 - p0 );
+                float a = glm::length( n );
+                centroid += ( p0 + p1 + p2 ) * ( a / 3.0f );
+                normal += n;
+                area += a;
+            }
+            meshCentroid += centroid;
+            meshArea += area;
+            centroids.push_back( area > 0.0f ? centroid / area : positions[indices[bounds[b] * 3]] );
+            normals.push_back( normal );
+            clusters.push_back( { bounds[b], bounds[b + 1], 0.0f } );
+        }
+        if( meshArea > 0.0f )
+            meshCentroid /= meshArea;
+        for( size_t c = 0; c < clusters.size(); ++c )
+        {
+            float len = glm::length( normals[c] );
+            clusters[c].sortKey = len > 0.0f ? glm::dot( centroids[c] - meshCentroid, normals[c] / len ) : 0.0f;
+        }
+        std::stable_sort( clusters.begin(), clusters.end(),
+                          []( const Cluster &a, const Cluster &b ) { return a.sortKey > b.sortKey; } );
+
+        std::vector<uint32_t> out;
+        out.reserve( indices.size() );
+        for( const auto &c : clusters )
+            out.insert( out.end(), indices.begin() + c.begin * 3, indices.begin() + c.end * 3 );
+        return out;
+    }
+
+    size_t optimizeVertexFetch( std::vector<uint8_t> &vertices, std::vector<uint32_t> &indices, size_t vertexCount,
+                                size_t stride )
+    {
+        validateIndices( indices, vertexCount );
+        std::vector<uint32_t> remap( vertexCount, UINT32_MAX );
+        uint32_t next = 0;
+        for( uint32_t &v : indices )
+        {
+            if( remap[v] == UINT32_MAX )
+                remap[v] = next++;
+            v = remap[v];
+        }
+
+        std::vector<uint8_t> reordered( static_cast<size_t>( next ) * stride );
+        for( size_t v = 0; v < vertexCount; ++v )
+        {
+            if( remap[v] != UINT32_MAX )
+                std::memcpy( reordered.data() + remap[v] * stride, vertices.data() + v * stride, stride );
+        }
+        vertices.swap( reordered );
+        return next;
+    }
+
+    std::vector<glm::vec3> extractPositions( const MeshData &mesh )
+    {
+        const InputElementDesc *pos = nullptr;
+        for( const auto &e : mesh.layout.elements )
+            if( e.semantic == Semantic::POSITION0 )
+                pos = &e;
+        if( !pos )
+            throw std::invalid_argument( "Mesh optimizer: mesh has no POSITION0 attribute" );
+
+        std::vector<glm::vec3> out( mesh.vertexCount );
+        for( size_t i = 0; i < mesh.vertexCount; ++i )
+        {
+            float p[3];
+            std::memcpy( p, mesh.vertices.data() + i * mesh.layout.stride + pos->offset, sizeof( p ) );
+            out[i] = glm::vec3( p[0], p[1], p[2] );
+        }
+        return out;
+    }
+
+    void optimizeMesh( MeshData &mesh, const MeshOptimizeOptions &options )
+    {
+        if( options.vertexCache )
+            mesh.indices = optimizeVertexCache( mesh.indices, mesh.vertexCount, options.cacheSize );
+        if( options.overdraw )
+            mesh.indices = optimizeOverdraw( mesh.indices, extractPositions( mesh ), options.overdrawThreshold,
+                                             options.cacheSize );
+        if( options.vertexFetch )
+            mesh.vertexCount = optimizeVertexFetch( mesh.vertices, mesh.indices, mesh.vertexCount, mesh.layout.stride );
+    }
+} // namespace swr
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "swrMesh.h"
+
+namespace swr
+{
+    // Офлайн-оптимизация порядка треугольников и вершин под программный конвейер:
+    //   1. optimizeVertexCache — порядок треугольников под FIFO пост-трансформ кэш drawIndexed (Tipsify);
+    //   2. optimizeOverdraw    — перестановка кластеров "спереди назад" без заметной потери в кэше;
+    //   3. optimizeVertexFetch — вершины в порядке первого использования (локальность выборки).
+
+    // Результаты симуляции пост-трансформ кэша
+    struct VertexCacheStats
+    {
+        size_t vertexShaderInvocations = 0;
+        float acmr = 0.0f; // Average Cache Miss Ratio: вызовы VS на треугольник (идеал ~0.5, худший 3)
+        float atvr = 0.0f; // Average Transformed Vertex Ratio: вызовы VS на уникальную вершину (идеал 1)
+    };
+
+    // Результаты оценки перерисовки (растеризация с 6 осевых направлений)
+    struct OverdrawStats
+    {
+        size_t pixelsCovered = 0; // Пиксели, покрытые хотя бы одним треугольником
+        size_t pixelsShaded = 0;  // Пиксели, прошедшие тест глубины в момент отрисовки (вызовы PS)
+        float overdraw = 0.0f;    // pixelsShaded / pixelsCovered (идеал 1)
+    };
+
+    VertexCacheStats analyzeVertexCache( const std::vector<uint32_t> &indices, size_t vertexCount,
+                                         size_t cacheSize = kVertexCacheSize );
+
+    // Треугольники считаются лицевыми при обходе против часовой стрелки (как в OBJ)
+    OverdrawStats analyzeOverdraw( const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions );
+
+    std::vector<uint32_t> optimizeVertexCache( const std::vector<uint32_t> &indices, size_t vertexCount,
+                                               size_t cacheSize = kVertexCacheSize );
+
+    // Ожидает индексы после optimizeVertexCache. threshold — допустимое ухудшение ACMR (1.05 = +5%)
+    std::vector<uint32_t> optimizeOverdraw( const std::vector<uint32_t> &indices,
+                                            const std::vector<glm::vec3> &positions, float threshold = 1.05f,
+                                            size_t cacheSize = kVertexCacheSize );
+
+    // Переупорядочивает вершины в порядке первого использования, неиспользуемые отбрасываются.
+    // indices переназначаются на месте; возвращает новое число вершин
+    size_t optimizeVertexFetch( std::vector<uint8_t> &vertices, std::vector<uint32_t> &indices, size_t vertexCount,
+                                size_t stride );
+
+    // Позиции вершин меша (атрибут POSITION0)
+    std::vector<glm::vec3> extractPositions( const MeshData &mesh );
+
+    struct MeshOptimizeOptions
+    {
+        bool vertexCache = true;
+        bool overdraw = true;
+        bool vertexFetch = true;
+        float overdrawThreshold = 1.05f;
+        size_t cacheSize = kVertexCacheSize;
+    };
+
+    // Полный конвейер оптимизации над мешем в памяти
+    void optimizeMesh( MeshData &mesh, const MeshOptimizeOptions &options = {} );
+} // namespace swr
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace swr
+{
+    // Forward decl device class
+    class Device;
+
+    // Запрос окклюзии: число сэмплов, прошедших тест глубины, в draw-вызовах между Device::beginQuery и
+    // Device::endQuery. Рендеринг синхронный, поэтому результат готов сразу после endQuery
+    class OcclusionQuery
+    {
+      public:
+        uint64_t samplesPassed() const
+        {
+            return samples;
+        }
+        bool anySamplesPassed() const
+        {
+            return samples != 0;
+        }
+        bool isActive() const
+        {
+            return active;
+        }
+
+      private:
+        friend class Device;
+        OcclusionQuery() = default;
+
+        uint64_t samples = 0;
+        bool active = false;
+    };
+} // namespace swr
@@ -0,0 +1,18 @@
+#pragma once
+
+// Определение доступных наборов SIMD-инструкций на этапе компиляции.
+// SWR_SSE2 — x86-64 (SSE2 входит в базовый набор) или x86 с /arch:SSE2 / -msse2
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define SWR_SSE2 1
+#include <emmintrin.h>
+#else
+#define SWR_SSE2 0
+#endif
+
+// SWR_F16C — аппаратное преобразование float <-> half (GCC/Clang: -mf16c или -march=native; MSVC: /arch:AVX2)
+#if SWR_SSE2 && ( defined( __F16C__ ) || ( defined( _MSC_VER ) && defined( __AVX2__ ) ) )
+#define SWR_F16C 1
+#include <immintrin.h>
+#else
+#define SWR_F16C 0
+#endif
@@ -0,0 +1,136 @@
+#include "swrSurface.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace swr
+{
+    void RenderSurface::resize( size_t w, size_t h, const glm::vec4 &clearColor, float clearDepth, uint32_t samples,
+                                SurfaceLayout surfaceLayout, SurfaceFormat format )
+    {
+        if( samples != 1 && samples != kMaxSampleCount )
+            throw std::invalid_argument( "RenderSurface: unsupported sample count" );
+        if( format == SurfaceFormat::DepthOnly && samples != 1 )
+            throw std::invalid_argument( "RenderSurface: multisampled depth-only surface is not supported" );
+        width = w;
+        height = h;
+        sampleCount = samples;
+        layout = surfaceLayout;
+        colorFormat = format;
+        size_t pixels = w * h;
+        if( layout == SurfaceLayout::Tiled )
+        {
+            tilesX = ( w + kTileDim - 1 ) / kTileDim;
+            pixels = tilesX * ( ( h + kTileDim - 1 ) / kTileDim ) * kTileDim * kTileDim;
+        }
+        if( isHalfColor() )
+            colorBufferHalf.assign( pixels, packHalf4( clearColor ) );
+        else if( hasColor() )
+            colorBuffer.assign( pixels, clearColor );
+        if( !isHalfColor() )
+        {
+            colorBufferHalf.clear();
+            colorBufferHalf.shrink_to_fit();
+        }
+        if( isHalfColor() || !hasColor() )
+        {
+            colorBuffer.clear();
+            colorBuffer.shrink_to_fit();
+        }
+        depthBuffer.assign( pixels * samples, clearDepth );
+        if( isMultisampled() )
+        {
+            sampleColor.assign( pixels * samples, clearColor );
+            compressed.assign( pixels, 1 );
+        }
+        else
+        {
+            sampleColor.clear();
+            sampleColor.shrink_to_fit();
+            compressed.clear();
+            compressed.shrink_to_fit();
+        }
+    }
+
+    void RenderSurface::clear( const glm::vec4 &clearColor, float clearDepth )
+    {
+        if( isHalfColor() )
+            std::fill( colorBufferHalf.begin(), colorBufferHalf.end(), packHalf4( clearColor ) );
+        else
+            std::fill( colorBuffer.begin(), colorBuffer.end(), clearColor );
+        std::fill( depthBuffer.begin(), depthBuffer.end(), clearDepth );
+        if( isMultisampled() )
+        {
+            // Достаточно сэмпла 0: все пиксели становятся сжатыми
+            for( size_t i = 0; i < compressed.size(); ++i )
+                sampleColor[i * sampleCount] = clearColor;
+            std::fill( compressed.begin(), compressed.end(), uint8_t( 1 ) );
+        }
+    }
+
+    void RenderSurface::clearRect( size_t x0, size_t y0, size_t x1, size_t y1, const glm::vec4 &clearColor,
+                                   float clearDepth )
+    {
+        const Half4 clearHalf = packHalf4( clearColor );
+        for( size_t y = y0; y < y1; ++y )
+        {
+            for( size_t x = x0; x < x1; ++x )
+            {
+                const size_t index = pixelIndex( x, y );
+                if( isHalfColor() )
+                    colorBufferHalf[index] = clearHalf;
+                else if( hasColor() )
+                    colorBuffer[index] = clearColor;
+                std::fill_n( depthBuffer.begin() + index * sampleCount, sampleCount, clearDepth );
+                if( isMultisampled() )
+                {
+                    sampleColor[index * sampleCount] = clearColor;
+                    compressed[index] = 1;
+                }
+            }
+        }
+    }
+
+    void RenderSurface::resolve()
+    {
+        if( !isMultisampled() )
+            return;
+        const float invSamples = 1.0f / static_cast<float>( sampleCount );
+        const size_t pixels = pixelCount();
+        for( size_t i = 0; i < pixels; ++i )
+        {
+            const glm::vec4 *samples = &sampleColor[i * sampleCount];
+            if( compressed[i] )
+            {
+                storeColor( i, samples[0] );
+                continue;
+            }
+            glm::vec4 sum( 0.0f );
+            for( uint32_t s = 0; s < sampleCount; ++s )
+                sum += samples[s];
+            storeColor( i, sum * invSamples );
+        }
+    }
+
+    void RenderSurface::readColorRow( size_t y, glm::vec4 *dst ) const
+    {
+        if( isHalfColor() )
+        {
+            for( size_t x = 0; x < width; ++x )
+                dst[x] = unpackHalf4( colorBufferHalf[pixelIndex( x, y )] );
+            return;
+        }
+        if( layout == SurfaceLayout::Linear )
+        {
+            std::memcpy( dst, colorBuffer.data() + y * width, width * sizeof( glm::vec4 ) );
+            return;
+        }
+        // Строка тайла лежит подряд: копируем по kTileDim пикселей
+        for( size_t x = 0; x < width; x += kTileDim )
+        {
+            const size_t n = std::min( kTileDim, width - x );
+            std::memcpy( dst + x, colorBuffer.data() + pixelIndex( x, y ), n * sizeof( glm::vec4 ) );
+        }
+    }
+} // namespace swr
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "swrHalf.h"
+
+namespace swr
+{
+    // Поддерживаемые числа сэмплов: 1 (без MSAA) и 4
+    constexpr uint32_t kMaxSampleCount = 4;
+
+    // Позиции сэмплов 4x MSAA относительно центра пикселя (повёрнутая решётка, как в D3D)
+    constexpr float kSamplePositions4[kMaxSampleCount][2] = {
+        { -0.125f, -0.375f },
+        { 0.375f, -0.125f },
+        { -0.375f, 0.125f },
+        { 0.125f, 0.375f },
+    };
+
+    // Порядок пикселей в буферах поверхности
+    enum class SurfaceLayout
+    {
+        Linear, // Построчно: y * width + x
+        Tiled,  // Тайлы 4x4 построчно, внутри тайла — построчно: тайл глубины занимает одну кэш-линию,
+                // строка тайла цвета — одну линию, и высокий треугольник не проходит по линии на каждую строку
+    };
+
+    // Формат хранения цвета поверхности. Смешивание всегда считается во float; RGBA16F вдвое сокращает
+    // трафик памяти цели ценой точности (~3 десятичных знака) и преобразования при чтении и записи
+    enum class SurfaceFormat
+    {
+        RGBA32F,   // colorBuffer
+        RGBA16F,   // colorBufferHalf
+        DepthOnly, // Без цвета, только depthBuffer (текстура глубины, например карта теней)
+    };
+
+    // Поверхность рендеринга: буферы цвета и глубины, в которые пишет растеризатор.
+    // Задний буфер устройства и текстуры с флагом RenderTarget используют одну и ту же структуру.
+    //
+    // При sampleCount > 1 глубина и цвет хранятся на сэмпл (сэмплы пикселя подряд), а colorBuffer
+    // заполняется только в resolve(). Пиксель, все сэмплы которого одинаковы (внутренность треугольников),
+    // хранится сжатым: флаг compressed и единственный валидный сэмпл 0 — запись и resolve таких пикселей
+    // стоят как без MSAA.
+    //
+    // Все буферы индексируются номером пикселя pixelIndex(x, y). В тайловой раскладке размер дополняется до
+    // целых тайлов; kTileDim соседних пикселей строки, начиная с x, кратного kTileDim, лежат подряд в обеих
+    // раскладках.
+    //
+    // Цвет хранится в одном из двух буферов по colorFormat; второй пуст (при DepthOnly пусты оба).
+    // Сэмплы MSAA всегда во float — в формат поверхности переводится только результат resolve
+    struct RenderSurface
+    {
+        static constexpr size_t kTileDim = 4;
+
+        size_t width = 0;
+        size_t height = 0;
+        uint32_t sampleCount = 1;
+        SurfaceLayout layout = SurfaceLayout::Linear;
+        size_t tilesX = 0; // Тайлов в строке (только Tiled)
+        SurfaceFormat colorFormat = SurfaceFormat::RGBA32F;
+        std::vector<glm::vec4> colorBuffer; // RGBA color buffer (при MSAA — результат resolve)
+        std::vector<Half4> colorBufferHalf; // То же в RGBA16F
+        std::vector<float> depthBuffer;     // Depth buffer, width * height * sampleCount
+        std::vector<glm::vec4> sampleColor; // Цвет сэмплов, width * height * sampleCount (только MSAA)
+        std::vector<uint8_t> compressed;    // На пиксель: 1 — все сэмплы равны сэмплу 0 (только MSAA)
+
+        void resize( size_t w, size_t h, const glm::vec4 &clearColor, float clearDepth, uint32_t samples = 1,
+                     SurfaceLayout surfaceLayout = SurfaceLayout::Linear,
+                     SurfaceFormat format = SurfaceFormat::RGBA32F );
+        void clear( const glm::vec4 &clearColor, float clearDepth );
+        // Очистка прямоугольника [x0, x1) x [y0, y1) (перерисовка части цели)
+        void clearRect( size_t x0, size_t y0, size_t x1, size_t y1, const glm::vec4 &clearColor, float clearDepth );
+        // Усреднение сэмплов в colorBuffer; без MSAA ничего не делает
+        void resolve();
+        // Строка y из colorBuffer в линейный массив из width пикселей
+        void readColorRow( size_t y, glm::vec4 *dst ) const;
+
+        size_t pixelIndex( size_t x, size_t y ) const
+        {
+            if( layout == SurfaceLayout::Linear )
+                return y * width + x;
+            return ( ( y / kTileDim ) * tilesX + x / kTileDim ) * kTileDim * kTileDim + ( y % kTileDim ) * kTileDim +
+                   x % kTileDim;
+        }
+        // Число пикселей в буферах (с дополнением до тайлов)
+        size_t pixelCount() const
+        {
+            return depthBuffer.size() / sampleCount;
+        }
+        // Память всех буферов поверхности, байт
+        size_t memorySize() const
+        {
+            return colorBuffer.size() * sizeof( glm::vec4 ) + colorBufferHalf.size() * sizeof( Half4 ) +
+                   depthBuffer.size() * sizeof( float ) + sampleColor.size() * sizeof( glm::vec4 ) +
+                   compressed.size();
+        }
+
+        bool isHalfColor() const
+        {
+            return colorFormat == SurfaceFormat::RGBA16F;
+        }
+        bool hasColor() const
+        {
+            return colorFormat != SurfaceFormat::DepthOnly;
+        }
+        // Цвет пикселя с номером pixelIndex() в любом формате
+        glm::vec4 loadColor( size_t index ) const
+        {
+            return isHalfColor() ? unpackHalf4( colorBufferHalf[index] ) : colorBuffer[index];
+        }
+        void storeColor( size_t index, const glm::vec4 &color )
+        {
+            if( isHalfColor() )
+                colorBufferHalf[index] = packHalf4( color );
+            else
+                colorBuffer[index] = color;
+        }
+
+        bool isMultisampled() const
+        {
+            return sampleCount > 1;
+        }
+    };
+} // namespace swr
@@ -0,0 +1,391 @@
+#include "swrTexture.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include "swrBlockCompression.h"
+#include "swrDevice.h"
+
+namespace swr
+{
+    namespace
+    {
+        constexpr size_t kStorageAlignment = 64; // Тайл RGBA8 = одна кэш-линия
+
+        // Ширина зоны смешивания мипов при трилинейной фильтрации (доля от единицы LOD).
+        // Вне зоны читается один мип — вдвое меньше выборок и рабочий набор в одном уровне
+        constexpr float kTrilinearBand = 0.5f;
+
+        size_t formatTexelSize( BufferFormat fmt )
+        {
+            switch( fmt )
+            {
+            case BufferFormat::R8G8B8A8_UNORM:
+                return 4;
+            case BufferFormat::R32G32B32A32_FLOAT:
+                return 16;
+            case BufferFormat::R16G16B16A16_FLOAT:
+                return 8;
+            case BufferFormat::D32_FLOAT:
+                return 4;
+            case BufferFormat::BC1_UNORM:
+            case BufferFormat::BC3_UNORM:
+                return 0; // Хранятся блоками, см. tileBytes
+            default:
+                throw std::invalid_argument( "Texture2D: unsupported format" );
+            }
+        }
+
+        int wrapCoord( int c, int size, TextureAddressMode mode )
+        {
+            if( mode == TextureAddressMode::Clamp )
+                return std::min( std::max( c, 0 ), size - 1 );
+            c %= size;
+            return c < 0 ? c + size : c;
+        }
+
+        // Метки уникальны в пределах процесса, так что блок по тому же адресу, но другого содержимого
+        // (перезаписанный мип или новая текстура на месте старой) в кэше не найдётся
+        uint64_t nextContentStamp()
+        {
+            static std::atomic<uint64_t> counter{ 0 };
+            return ++counter;
+        }
+
+        // Кэш распакованных блоков, свой у каждого потока: билинейная выборка и соседние пиксели чаще всего
+        // читают один и тот же блок 4x4, поэтому он распаковывается один раз на серию выборок
+        constexpr size_t kBlockCacheSize = 64;
+        struct DecodedBlockCache
+        {
+            struct Entry
+            {
+                const uint8_t *block = nullptr;
+                uint64_t stamp = 0;
+                uint8_t texels[kBlockTexels * 4];
+            };
+            Entry entries[kBlockCacheSize];
+        };
+        thread_local DecodedBlockCache blockCache;
+    } // unnamed namespace
+
+    Texture2D::Texture2D( const TextureDesc &desc )
+        : desc_( desc ), texelSize( formatTexelSize( desc.format ) ), contentStamp( nextContentStamp() )
+    {
+        if( desc.width == 0 || desc.height == 0 )
+            throw std::invalid_argument( "Texture2D: zero size" );
+        if( texelSize == 0 && ( desc.bindFlags & TextureBindRenderTarget ) )
+            throw std::invalid_argument( "Texture2D: block-compressed format cannot be a render target" );
+        const bool depthFormat = desc.format == BufferFormat::D32_FLOAT;
+        if( ( desc.bindFlags & TextureBindDepthStencil ) && !depthFormat )
+            throw std::invalid_argument( "Texture2D: depth-stencil binding requires D32_FLOAT" );
+        if( depthFormat && ( desc.bindFlags & TextureBindRenderTarget ) )
+            throw std::invalid_argument( "Texture2D: depth format cannot be a color render target" );
+        if( ( desc.bindFlags & TextureBindDepthStencil ) && desc.sampleCount != 1 )
+            throw std::invalid_argument( "Texture2D: multisampled depth textures are not supported" );
+        tileBytes = texelSize == 0 ? blockBytes( desc.format ) : kTileSize * kTileSize * texelSize;
+
+        uint32_t maxLevels = 1;
+        for( size_t s = std::max( desc.width, desc.height ); s > 1; s >>= 1 )
+            ++maxLevels;
+        uint32_t levels = desc.mipLevels == 0 ? maxLevels : std::min( desc.mipLevels, maxLevels );
+        desc_.mipLevels = levels;
+
+        size_t offset = 0;
+        for( uint32_t i = 0; i < levels; ++i )
+        {
+            MipLevel m;
+            m.width = std::max<size_t>( desc.width >> i, 1 );
+            m.height = std::max<size_t>( desc.height >> i, 1 );
+            m.tilesX = ( m.width + kTileSize - 1 ) / kTileSize;
+            size_t tilesY = ( m.height + kTileSize - 1 ) / kTileSize;
+            m.offset = offset;
+            offset += m.tilesX * tilesY * tileBytes;
+            mips.push_back( m );
+        }
+        storageBytes = offset;
+
+        void *mem = ::operator new( offset, std::align_val_t( kStorageAlignment ) );
+        std::memset( mem, 0, offset );
+        storage = std::shared_ptr<uint8_t>( static_cast<uint8_t *>( mem ), []( uint8_t *p ) {
+            ::operator delete( p, std::align_val_t( kStorageAlignment ) );
+        } );
+
+        if( desc.bindFlags & TextureBindRenderTarget )
+        {
+            surface = std::make_unique<RenderSurface>();
+            // Цель RGBA16F рендерится в поверхность того же формата, остальные — во float
+            const SurfaceFormat surfaceFormat = desc.format == BufferFormat::R16G16B16A16_FLOAT
+                                                    ? SurfaceFormat::RGBA16F
+                                                    : SurfaceFormat::RGBA32F;
+            surface->resize( desc.width, desc.height, glm::vec4( 0.0f ), 1.0f, desc.sampleCount,
+                             SurfaceLayout::Linear, surfaceFormat );
+        }
+        else if( desc.bindFlags & TextureBindDepthStencil )
+        {
+            surface = std::make_unique<RenderSurface>();
+            surface->resize( desc.width, desc.height, glm::vec4( 0.0f ), 1.0f, 1, SurfaceLayout::Linear,
+                             SurfaceFormat::DepthOnly );
+        }
+    }
+
+    const uint8_t *Texture2D::decodedBlock( const uint8_t *block ) const
+    {
+        DecodedBlockCache::Entry &e =
+            blockCache.entries[( reinterpret_cast<uintptr_t>( block ) / tileBytes ) & ( kBlockCacheSize - 1 )];
+        if( e.block != block || e.stamp != contentStamp )
+        {
+            if( desc_.format == BufferFormat::BC1_UNORM )
+                decodeBC1Block( block, e.texels );
+            else
+                decodeBC3Block( block, e.texels );
+            e.block = block;
+            e.stamp = contentStamp;
+        }
+        return e.texels;
+    }
+
+    glm::vec4 Texture2D::load( size_t x, size_t y, uint32_t mip ) const
+    {
+        constexpr float k = 1.0f / 255.0f;
+        if( texelSize == 0 )
+        {
+            const MipLevel &m = mips[mip];
+            const uint8_t *block = storage.get() + m.offset + ( ( y >> 2 ) * m.tilesX + ( x >> 2 ) ) * tileBytes;
+            const uint8_t *p = decodedBlock( block ) + ( ( y & 3 ) * kTileSize + ( x & 3 ) ) * 4;
+            return glm::vec4( p[0] * k, p[1] * k, p[2] * k, p[3] * k );
+        }
+        const uint8_t *p = storage.get() + texelOffset( mips[mip], x, y );
+        if( desc_.format == BufferFormat::R8G8B8A8_UNORM )
+        {
+            return glm::vec4( p[0] * k, p[1] * k, p[2] * k, p[3] * k );
+        }
+        if( desc_.format == BufferFormat::R16G16B16A16_FLOAT )
+        {
+            Half4 h;
+            std::memcpy( &h, p, sizeof( h ) );
+            return unpackHalf4( h );
+        }
+        if( desc_.format == BufferFormat::D32_FLOAT )
+        {
+            // Глубина — в канале R, как у R32_FLOAT
+            float d;
+            std::memcpy( &d, p, sizeof( d ) );
+            return glm::vec4( d, 0.0f, 0.0f, 1.0f );
+        }
+        glm::vec4 v;
+        std::memcpy( &v[0], p, sizeof( float ) * 4 );
+        return v;
+    }
+
+    void Texture2D::store( size_t x, size_t y, uint32_t mip, const glm::vec4 &value )
+    {
+        if( texelSize == 0 )
+            throw std::logic_error( "Texture2D::store on block-compressed texture" );
+        ++contentVersion;
+        uint8_t *p = storage.get() + texelOffset( mips[mip], x, y );
+        if( desc_.format == BufferFormat::R8G8B8A8_UNORM )
+        {
+            for( int c = 0; c < 4; ++c )
+                p[c] = static_cast<uint8_t>( glm::clamp( value[c], 0.0f, 1.0f ) * 255.0f + 0.5f );
+            return;
+        }
+        if( desc_.format == BufferFormat::R16G16B16A16_FLOAT )
+        {
+            const Half4 h = packHalf4( value );
+            std::memcpy( p, &h, sizeof( h ) );
+            return;
+        }
+        if( desc_.format == BufferFormat::D32_FLOAT )
+        {
+            std::memcpy( p, &value.x, sizeof( float ) );
+            return;
+        }
+        std::memcpy( p, &value[0], sizeof( float ) * 4 );
+    }
+
+    void Texture2D::uploadData( const void *srcData, size_t rowPitch, uint32_t mip )
+    {
+        if( mip >= mips.size() )
+            throw std::out_of_range( "Texture2D::uploadData mip out of range" );
+        const MipLevel &m = mips[mip];
+        const uint8_t *src = static_cast<const uint8_t *>( srcData );
+        contentStamp = nextContentStamp();
+        ++contentVersion;
+        if( texelSize == 0 )
+        {
+            // Блоки уже лежат в порядке хранения: копируем ряды блоков целиком
+            const size_t rowBytes = m.tilesX * tileBytes;
+            if( rowPitch == 0 )
+                rowPitch = rowBytes;
+            const size_t blockRows = ( m.height + kTileSize - 1 ) / kTileSize;
+            for( size_t by = 0; by < blockRows; ++by )
+                std::memcpy( storage.get() + m.offset + by * rowBytes, src + by * rowPitch, rowBytes );
+            return;
+        }
+        if( rowPitch == 0 )
+            rowPitch = m.width * texelSize;
+        // Перестановка из линейных строк в тайлы; формат совпадает, так что копируем тексели байтами
+        for( size_t y = 0; y < m.height; ++y )
+        {
+            const uint8_t *row = src + y * rowPitch;
+            for( size_t x = 0; x < m.width; ++x )
+                std::memcpy( storage.get() + texelOffset( m, x, y ), row + x * texelSize, texelSize );
+        }
+    }
+
+    void Texture2D::uploadRawData( const void *data )
+    {
+        contentStamp = nextContentStamp();
+        ++contentVersion;
+        std::memcpy( storage.get(), data, storageBytes );
+    }
+
+    void Texture2D::generateMips()
+    {
+        if( texelSize == 0 )
+        {
+            generateCompressedMips();
+            return;
+        }
+        for( uint32_t i = 1; i < mips.size(); ++i )
+        {
+            const MipLevel &src = mips[i - 1];
+            const MipLevel &dst = mips[i];
+            for( size_t y = 0; y < dst.height; ++y )
+            {
+                size_t y0 = std::min( y * 2, src.height - 1 ), y1 = std::min( y * 2 + 1, src.height - 1 );
+                for( size_t x = 0; x < dst.width; ++x )
+                {
+                    size_t x0 = std::min( x * 2, src.width - 1 ), x1 = std::min( x * 2 + 1, src.width - 1 );
+                    glm::vec4 sum = load( x0, y0, i - 1 ) + load( x1, y0, i - 1 ) + load( x0, y1, i - 1 ) +
+                                    load( x1, y1, i - 1 );
+                    store( x, y, i, sum * 0.25f );
+                }
+            }
+        }
+    }
+
+    void Texture2D::generateCompressedMips()
+    {
+        uint8_t texels[kBlockTexels * 4];
+        for( uint32_t i = 1; i < mips.size(); ++i )
+        {
+            // Мип i-1 только что записан: новая метка, чтобы не прочитать его старые блоки из кэша
+            contentStamp = nextContentStamp();
+            const MipLevel &src = mips[i - 1];
+            const MipLevel &dst = mips[i];
+            const size_t blockRows = ( dst.height + kTileSize - 1 ) / kTileSize;
+            for( size_t by = 0; by < blockRows; ++by )
+            {
+                for( size_t bx = 0; bx < dst.tilesX; ++bx )
+                {
+                    // Фильтр 2x2 по распакованному мипу i-1, затем пересжатие блока мипа i
+                    for( size_t t = 0; t < kBlockTexels; ++t )
+                    {
+                        const size_t x = std::min( bx * kTileSize + ( t & 3 ), dst.width - 1 );
+                        const size_t y = std::min( by * kTileSize + ( t >> 2 ), dst.height - 1 );
+                        const size_t x0 = std::min( x * 2, src.width - 1 ), x1 = std::min( x * 2 + 1, src.width - 1 );
+                        const size_t y0 = std::min( y * 2, src.height - 1 ), y1 = std::min( y * 2 + 1, src.height - 1 );
+                        glm::vec4 sum = load( x0, y0, i - 1 ) + load( x1, y0, i - 1 ) + load( x0, y1, i - 1 ) +
+                                        load( x1, y1, i - 1 );
+                        sum = glm::clamp( sum * 0.25f, 0.0f, 1.0f ) * 255.0f + 0.5f;
+                        for( int c = 0; c < 4; ++c )
+                            texels[t * 4 + c] = static_cast<uint8_t>( sum[c] );
+                    }
+                    uint8_t *block = storage.get() + dst.offset + ( by * dst.tilesX + bx ) * tileBytes;
+                    if( desc_.format == BufferFormat::BC1_UNORM )
+                        encodeBC1Block( texels, block );
+                    else
+                        encodeBC3Block( texels, block );
+                }
+            }
+        }
+        contentStamp = nextContentStamp();
+        ++contentVersion;
+    }
+
+    void Texture2D::resolveRenderSurface()
+    {
+        if( !surface )
+            return;
+        surface->resolve();
+        const MipLevel &m = mips[0];
+        for( size_t y = 0; y < m.height; ++y )
+        {
+            for( size_t x = 0; x < m.width; ++x )
+            {
+                const size_t index = surface->pixelIndex( x, y );
+                if( surface->hasColor() )
+                    store( x, y, 0, surface->loadColor( index ) );
+                else
+                    std::memcpy( storage.get() + texelOffset( m, x, y ), &surface->depthBuffer[index],
+                                 sizeof( float ) );
+            }
+        }
+        ++contentVersion;
+        if( mips.size() > 1 )
+            generateMips();
+    }
+
+    glm::vec4 Texture2D::sampleMip( const SamplerState &sampler, const glm::vec2 &uv, uint32_t mip ) const
+    {
+        const MipLevel &m = mips[mip];
+        const int w = static_cast<int>( m.width ), h = static_cast<int>( m.height );
+        const float fx = uv.x * static_cast<float>( w );
+        const float fy = uv.y * static_cast<float>( h );
+
+        if( sampler.filter == TextureFilter::Point )
+        {
+            int x = wrapCoord( static_cast<int>( std::floor( fx ) ), w, sampler.addressU );
+            int y = wrapCoord( static_cast<int>( std::floor( fy ) ), h, sampler.addressV );
+            return load( x, y, mip );
+        }
+
+        // Билинейная: центры текселей в (i + 0.5)
+        const float bx = fx - 0.5f, by = fy - 0.5f;
+        const float flx = std::floor( bx ), fly = std::floor( by );
+        const float tx = bx - flx, ty = by - fly;
+        const int x0 = wrapCoord( static_cast<int>( flx ), w, sampler.addressU );
+        const int x1 = wrapCoord( static_cast<int>( flx ) + 1, w, sampler.addressU );
+        const int y0 = wrapCoord( static_cast<int>( fly ), h, sampler.addressV );
+        const int y1 = wrapCoord( static_cast<int>( fly ) + 1, h, sampler.addressV );
+
+        glm::vec4 top = glm::mix( load( x0, y0, mip ), load( x1, y0, mip ), tx );
+        glm::vec4 bottom = glm::mix( load( x0, y1, mip ), load( x1, y1, mip ), tx );
+        return glm::mix( top, bottom, ty );
+    }
+
+    glm::vec4 Texture2D::sampleLevel( const SamplerState &sampler, const glm::vec2 &uv, float lod ) const
+    {
+        const float maxLevel = static_cast<float>( mips.size() - 1 );
+        lod = glm::clamp( lod + sampler.lodBias, 0.0f, std::min( sampler.maxLod, maxLevel ) );
+
+        if( sampler.filter != TextureFilter::Trilinear )
+            return sampleMip( sampler, uv, static_cast<uint32_t>( lod + 0.5f ) );
+
+        const uint32_t base = static_cast<uint32_t>( lod );
+        float t = lod - static_cast<float>( base );
+        // Смешиваем мипы только в узкой зоне вокруг середины
+        t = glm::clamp( ( t - 0.5f ) / kTrilinearBand + 0.5f, 0.0f, 1.0f );
+        if( t <= 0.0f || base + 1 >= mips.size() )
+            return sampleMip( sampler, uv, base );
+        if( t >= 1.0f )
+            return sampleMip( sampler, uv, base + 1 );
+        return glm::mix( sampleMip( sampler, uv, base ), sampleMip( sampler, uv, base + 1 ), t );
+    }
+
+    glm::vec4 Texture2D::sample( const SamplerState &sampler, const glm::vec2 &uv, const glm::vec2 &ddx,
+                                 const glm::vec2 &ddy ) const
+    {
+        // LOD = log2 наибольшего шага в текселях мипа 0; 0.5*log2(len^2) избавляет от sqrt
+        const glm::vec2 size( static_cast<float>( mips[0].width ), static_cast<float>( mips[0].height ) );
+        const glm::vec2 dx = ddx * size, dy = ddy * size;
+        const float rho2 = std::max( glm::dot( dx, dx ), glm::dot( dy, dy ) );
+        const float lod = rho2 > 0.0f ? 0.5f * std::log2( rho2 ) : 0.0f;
+        return sampleLevel( sampler, uv, lod );
+    }
+} // namespace swr
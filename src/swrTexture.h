@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "swrSurface.h"
+
+namespace swr
+{
+    // Forward decl BufferFormat (определён в swrDevice.h)
+    enum class BufferFormat;
+    // Forward decl device class
+    class Device;
+
+    // Способы использования текстуры (битовая маска)
+    enum TextureBindFlags : uint32_t
+    {
+        TextureBindShaderResource = 1u << 0, // Чтение в шейдере через сэмплер
+        TextureBindRenderTarget = 1u << 1,   // Цель рендеринга (OM)
+        TextureBindDepthStencil = 1u << 2,   // Цель рендеринга только глубины (OM), формат D32_FLOAT
+    };
+
+    struct TextureDesc
+    {
+        size_t width = 0;
+        size_t height = 0;
+        uint32_t mipLevels = 1; // 0 — полная цепочка до 1x1
+        BufferFormat format;    // R8G8B8A8_UNORM, R32G32B32A32_FLOAT, R16G16B16A16_FLOAT, D32_FLOAT или BC1/BC3_UNORM
+        uint32_t bindFlags = TextureBindShaderResource;
+        uint32_t sampleCount = 1; // MSAA цели рендеринга (1 или 4, у текстуры глубины — 1); тексели по одному сэмплу
+    };
+
+    enum class TextureFilter
+    {
+        Point,     // Ближайший тексель в ближайшем мипе
+        Bilinear,  // Билинейная в ближайшем мипе
+        Trilinear, // Билинейная с интерполяцией между двумя мипами
+    };
+
+    enum class TextureAddressMode
+    {
+        Wrap,
+        Clamp,
+    };
+
+    struct SamplerState
+    {
+        TextureFilter filter = TextureFilter::Bilinear;
+        TextureAddressMode addressU = TextureAddressMode::Wrap;
+        TextureAddressMode addressV = TextureAddressMode::Wrap;
+        float lodBias = 0.0f;
+        float maxLod = 1000.0f;
+    };
+
+    // 2D текстура с цепочкой мипов.
+    // Тексели хранятся тайлами 4x4 (внутри тайла — порядок Мортона, тайлы — построчно): для RGBA8 тайл
+    // занимает ровно одну кэш-линию, и все 4 текселя билинейной выборки чаще всего лежат в одной линии
+    class Texture2D
+    {
+      private:
+        Texture2D( const TextureDesc &desc );
+        friend class Device; // Разрешить Device создавать Texture2D
+
+      public:
+        static constexpr size_t kTileSize = 4;
+
+        const TextureDesc &desc() const
+        {
+            return desc_;
+        }
+        BufferFormat format() const
+        {
+            return desc_.format;
+        }
+        uint32_t mipLevels() const
+        {
+            return static_cast<uint32_t>( mips.size() );
+        }
+        size_t width( uint32_t mip = 0 ) const
+        {
+            return mips[mip].width;
+        }
+        size_t height( uint32_t mip = 0 ) const
+        {
+            return mips[mip].height;
+        }
+
+        // Сжатый формат (BC1/BC3): тайл 4x4 хранится как один блок, выборка распаковывает блоки на лету
+        bool isCompressed() const
+        {
+            return texelSize == 0;
+        }
+        // Память под все мипы, байт
+        size_t memorySize() const
+        {
+            return storageBytes;
+        }
+        // Тексели всех мипов во внутренней раскладке (memorySize() байт): захват и воспроизведение кадра
+        const void *rawData() const
+        {
+            return storage.get();
+        }
+        void uploadRawData( const void *data );
+
+        // Загрузка мипа из линейных строк в формате текстуры (rowPitch в байтах, 0 — плотная упаковка).
+        // Для сжатых форматов строка — ряд блоков 4x4 (см. compressImage)
+        void uploadData( const void *srcData, size_t rowPitch = 0, uint32_t mip = 0 );
+        // Построение мипов 1..N-1 из мипа 0 (фильтр 2x2); сжатые мипы пересжимаются
+        void generateMips();
+
+        // Чтение/запись одного текселя (без фильтрации). Запись в сжатую текстуру не поддерживается
+        glm::vec4 load( size_t x, size_t y, uint32_t mip = 0 ) const;
+        void store( size_t x, size_t y, uint32_t mip, const glm::vec4 &value );
+
+        // Фильтрованная выборка. ddx/ddy — производные uv по экранным x/y, по ним выбирается мип
+        glm::vec4 sample( const SamplerState &sampler, const glm::vec2 &uv, const glm::vec2 &ddx,
+                          const glm::vec2 &ddy ) const;
+        // Выборка с явным уровнем детализации
+        glm::vec4 sampleLevel( const SamplerState &sampler, const glm::vec2 &uv, float lod ) const;
+
+        // Поверхность для рендеринга в текстуру (nullptr без флагов TextureBindRenderTarget/DepthStencil).
+        // У текстуры глубины поверхность без цвета (SurfaceFormat::DepthOnly)
+        RenderSurface *renderSurface()
+        {
+            return surface.get();
+        }
+        // Перенос содержимого renderSurface() в мип 0 (и перестроение мипов, если их больше одного);
+        // у текстуры глубины переносится буфер глубины
+        void resolveRenderSurface();
+
+        // Счётчик изменений текселей: растёт при uploadData, uploadRawData, store, generateMips и
+        // resolveRenderSurface
+        uint64_t version() const
+        {
+            return contentVersion;
+        }
+
+      private:
+        struct MipLevel
+        {
+            size_t width;
+            size_t height;
+            size_t tilesX;
+            size_t offset; // Смещение мипа в storage, байт
+        };
+
+        size_t texelOffset( const MipLevel &m, size_t x, size_t y ) const
+        {
+            // Индекс внутри тайла 4x4 в порядке Мортона: биты x и y чередуются (x0 y0 x1 y1)
+            size_t lx = x & 3, ly = y & 3;
+            size_t morton = ( lx & 1 ) | ( ( ly & 1 ) << 1 ) | ( ( lx & 2 ) << 1 ) | ( ( ly & 2 ) << 2 );
+            size_t tile = ( y >> 2 ) * m.tilesX + ( x >> 2 );
+            return m.offset + ( tile * kTileSize * kTileSize + morton ) * texelSize;
+        }
+
+        glm::vec4 sampleMip( const SamplerState &sampler, const glm::vec2 &uv, uint32_t mip ) const;
+        // 16 текселей RGBA8 сжатого блока из кэша распакованных блоков потока
+        const uint8_t *decodedBlock( const uint8_t *block ) const;
+        void generateCompressedMips();
+
+        TextureDesc desc_;
+        size_t texelSize; // 0 для сжатых форматов
+        size_t tileBytes; // Байт на тайл 4x4 (блок сжатого формата)
+        size_t storageBytes = 0;
+        // Метка содержимого для кэша распакованных блоков; обновляется при каждой записи в тексели
+        uint64_t contentStamp;
+        uint64_t contentVersion = 0;
+        std::vector<MipLevel> mips;
+        std::shared_ptr<uint8_t> storage;
+        std::unique_ptr<RenderSurface> surface;
+    };
+} // namespace swr
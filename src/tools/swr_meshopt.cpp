@@ -0,0 +1,80 @@
+// Офлайн-оптимизация меша .swrm (или .obj): порядок треугольников под кэш вершин,
+// снижение перерисовки и локальность выборки вершин. Печатает ACMR/ATVR и overdraw до/после.
+//
+// Usage: swr_meshopt input.(swrm|obj) output.swrm [--no-cache] [--no-overdraw] [--no-fetch] [--threshold T]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "swrMeshOptimizer.h"
+
+namespace
+{
+    void printStats( const char *label, const swr::MeshData &mesh )
+    {
+        auto cache = swr::analyzeVertexCache( mesh.indices, mesh.vertexCount );
+        auto overdraw = swr::analyzeOverdraw( mesh.indices, swr::extractPositions( mesh ) );
+        std::cout << std::fixed << std::setprecision( 3 ) << label << ": ACMR " << cache.acmr << ", ATVR "
+                  << cache.atvr << ", overdraw " << overdraw.overdraw << " (" << overdraw.pixelsShaded << "/"
+                  << overdraw.pixelsCovered << " px)" << std::endl;
+    }
+} // unnamed namespace
+
+int main( int argc, char *argv[] )
+{
+    if( argc < 3 )
+    {
+        std::cerr << "Usage: swr_meshopt input.(swrm|obj) output.swrm [--no-cache] [--no-overdraw] [--no-fetch] "
+                     "[--threshold T]"
+                  << std::endl;
+        return 1;
+    }
+
+    swr::MeshOptimizeOptions options;
+    for( int i = 3; i < argc; ++i )
+    {
+        if( std::strcmp( argv[i], "--no-cache" ) == 0 )
+            options.vertexCache = false;
+        else if( std::strcmp( argv[i], "--no-overdraw" ) == 0 )
+            options.overdraw = false;
+        else if( std::strcmp( argv[i], "--no-fetch" ) == 0 )
+            options.vertexFetch = false;
+        else if( std::strcmp( argv[i], "--threshold" ) == 0 && i + 1 < argc )
+            options.overdrawThreshold = static_cast<float>( std::atof( argv[++i] ) );
+        else
+        {
+            std::cerr << "swr_meshopt: unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        const std::string input = argv[1];
+        swr::MeshData mesh = input.size() >= 4 && input.compare( input.size() - 4, 4, ".obj" ) == 0
+                                 ? swr::importObj( input )
+                                 : swr::loadMeshData( input );
+        std::cout << input << ": " << mesh.vertexCount << " vertices, " << mesh.indices.size() / 3 << " triangles"
+                  << std::endl;
+        printStats( "before", mesh );
+
+        auto t0 = std::chrono::steady_clock::now();
+        swr::optimizeMesh( mesh, options );
+        auto t1 = std::chrono::steady_clock::now();
+
+        printStats( "after ", mesh );
+        std::cout << "optimized in " << std::chrono::duration<double, std::milli>( t1 - t0 ).count() << " ms"
+                  << std::endl;
+        swr::saveMeshData( argv[2], mesh );
+    }
+    catch( const std::exception &e )
+    {
+        std::cerr << "swr_meshopt: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
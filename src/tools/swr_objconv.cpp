@@ -0,0 +1,38 @@
+// Конвертер Wavefront OBJ -> бинарный меш .swrm
+//
+// Usage: swr_objconv input.obj output.swrm
+
+#include <chrono>
+#include <iostream>
+
+#include "swrMesh.h"
+
+int main( int argc, char *argv[] )
+{
+    if( argc != 3 )
+    {
+        std::cerr << "Usage: swr_objconv input.obj output.swrm" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        swr::MeshData mesh = swr::importObj( argv[1] );
+        auto t1 = std::chrono::steady_clock::now();
+        swr::saveMeshData( argv[2], mesh );
+        auto t2 = std::chrono::steady_clock::now();
+
+        std::cout << argv[1] << ": " << mesh.vertexCount << " vertices, " << mesh.indices.size() / 3
+                  << " triangles" << std::endl;
+        std::cout << "import " << std::chrono::duration<double, std::milli>( t1 - t0 ).count() << " ms, write "
+                  << std::chrono::duration<double, std::milli>( t2 - t1 ).count() << " ms -> " << argv[2]
+                  << std::endl;
+    }
+    catch( const std::exception &e )
+    {
+        std::cerr << "swr_objconv: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Воспроизведение захваченного кадра (.swrc, Device::captureFrame / клавиша F12) без окна: кадр прогоняется
+// N раз на устройстве с настройками захвата, печатаются времена кадра и самые дорогие draw (среднее/минимум).
+// Шейдеры берутся из реестра по именам: в утилиту собраны сцены приложения.
+//
+// Usage: swr_replay capture.swrc [--iterations N] [--top K] [--no-visibility]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "swrCapture.h"
+#include "swrFrameStats.h"
+
+int main( int argc, char *argv[] )
+{
+    if( argc < 2 )
+    {
+        std::cerr << "Usage: swr_replay capture.swrc [--iterations N] [--top K] [--no-visibility]" << std::endl;
+        return 1;
+    }
+
+    int iterations = 100;
+    size_t top = 20;
+    bool noVisibility = false;
+    for( int i = 2; i < argc; ++i )
+    {
+        if( std::strcmp( argv[i], "--iterations" ) == 0 && i + 1 < argc )
+            iterations = std::max( std::atoi( argv[++i] ), 1 );
+        else if( std::strcmp( argv[i], "--top" ) == 0 && i + 1 < argc )
+            top = static_cast<size_t>( std::max( std::atoi( argv[++i] ), 0 ) );
+        else if( std::strcmp( argv[i], "--no-visibility" ) == 0 )
+            noVisibility = true;
+        else
+        {
+            std::cerr << "swr_replay: unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        swr::FrameReplay replay( argv[1] );
+        const swr::CaptureFileHeader &header = replay.header();
+        const std::vector<swr::FrameReplay::DrawInfo> &draws = replay.draws();
+        const size_t skipped = static_cast<size_t>(
+            std::count_if( draws.begin(), draws.end(), []( const auto &draw ) { return draw.skipped; } ) );
+        std::cout << argv[1] << ": " << header.frameWidth << "x" << header.frameHeight << ", " << header.commandCount
+                  << " commands, " << draws.size() << " draws";
+        if( skipped )
+            std::cout << " (" << skipped << " skipped: unnamed or unregistered shaders)";
+        std::cout << std::endl;
+
+        auto device = replay.createDevice();
+        if( noVisibility )
+            device->setVisibilityBuffer( false );
+        if( device->visibilityBuffer() )
+            std::cout << "visibility buffer: deferred shading is timed in the frame, not in draws" << std::endl;
+
+        // Прогревочный кадр: ресурсы создаются на устройстве, кольцо констант и арена выходят на рабочий размер
+        replay.replay( *device );
+
+        swr::FrameTimeStats frames;
+        frames.reserve( static_cast<size_t>( iterations ) );
+        std::vector<double> drawMs;
+        std::vector<double> drawTotal( draws.size(), 0.0 );
+        std::vector<double> drawMin( draws.size(), 0.0 );
+        for( int it = 0; it < iterations; ++it )
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            replay.replay( *device, &drawMs );
+            auto t1 = std::chrono::steady_clock::now();
+            frames.add( std::chrono::duration<double, std::milli>( t1 - t0 ).count() );
+            for( size_t d = 0; d < draws.size(); ++d )
+            {
+                drawTotal[d] += drawMs[d];
+                drawMin[d] = it == 0 ? drawMs[d] : std::min( drawMin[d], drawMs[d] );
+            }
+        }
+
+        frames.print( std::cout, "frame" );
+        const swr::PipelineStatistics &stats = device->pipelineStatistics();
+        std::cout << "per frame: " << stats.vsInvocations << " VS, " << stats.primitives << " primitives, "
+                  << stats.psInvocations << " PS invocations" << std::endl;
+
+        // Самые дорогие draw по суммарному времени
+        std::vector<size_t> order( draws.size() );
+        std::iota( order.begin(), order.end(), size_t( 0 ) );
+        std::stable_sort( order.begin(), order.end(),
+                          [&]( size_t a, size_t b ) { return drawTotal[a] > drawTotal[b]; } );
+        const double frameMean = frames.mean();
+        std::cout << std::fixed << std::setprecision( 3 ) << std::endl
+                  << "  draw   mean ms    min ms  frame %  shaders" << std::endl;
+        for( size_t k = 0; k < std::min( top, order.size() ); ++k )
+        {
+            const size_t d = order[k];
+            const swr::FrameReplay::DrawInfo &info = draws[d];
+            const double mean = drawTotal[d] / iterations;
+            const double share = frameMean > 0.0 ? mean / frameMean * 100.0 : 0.0;
+            std::cout << std::setw( 6 ) << d << std::setw( 10 ) << mean << std::setw( 10 ) << drawMin[d]
+                      << std::setw( 8 ) << std::setprecision( 1 ) << share << std::setprecision( 3 ) << "%  "
+                      << info.vertexShader << " / " << info.pixelShader << ", "
+                      << ( info.indexed ? "indexed " : "" ) << info.count << " x " << info.instanceCount
+                      << ( info.skipped ? " (skipped)" : "" ) << std::endl;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        std::cerr << "swr_replay: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}